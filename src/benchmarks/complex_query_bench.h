@@ -159,10 +159,19 @@ inline void run_multi_get_benchmark(std::unique_ptr<::Database>& db, const Compl
         threads.emplace_back([&, t]() {
             ::Collection& users_col = db->get_collection_by_idx(users_col_idx);
             TxnContext ctx = users_col.begin_transaction_context(t, true); 
-            size_t local_found = 0;
+            std::vector<std::string> key_storage;
             for(size_t i = t; i < batch_size; i+=num_threads) {
                 size_t user_id_to_query = i * (data.user_payloads.size() / batch_size);
-                if(users_col.get(ctx, "users:" + std::to_string(user_id_to_query))) {
+                key_storage.push_back("users:" + std::to_string(user_id_to_query));
+            }
+            std::vector<std::string_view> keys(key_storage.begin(), key_storage.end());
+            std::vector<std::optional<RecordData>> records;
+            users_col.get_critbit_tree().multi_get_simd(ctx, keys, records);
+            users_col.abort(ctx);
+
+            size_t local_found = 0;
+            for(const auto& record : records) {
+                if(record) {
                     local_found++;
                 }
             }
@@ -198,6 +207,7 @@ inline void run_intersection_benchmark(std::unique_ptr<::Database>& db, const Co
                     local_found++;
                 }
             }
+            thread_active_col.abort(ctx);
             
             intersection_size += local_found;
         });
@@ -231,7 +241,7 @@ inline void run_aggregation_benchmark(std::unique_ptr<::Database>& db, const Com
                     thread_local_totals[t][data.order_line_amounts[i].first] += amount;
                 }
             }
-            
+            thread_orders_col.abort(ctx);
         });
     }
     for(auto& th : threads) th.join();
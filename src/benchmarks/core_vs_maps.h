@@ -291,6 +291,7 @@ inline void run_transactional_stax_benchmark(BenchResults& results, const std::s
                     total_hits.fetch_add(1, std::memory_order_relaxed);
                     total_get_bytes.fetch_add(item.actual_stored_size_bytes, std::memory_order_relaxed);
                 }
+                col.abort(ctx);
             }
         });
     }
@@ -314,6 +315,7 @@ inline void run_transactional_stax_benchmark(BenchResults& results, const std::s
                 TxnContext ctx = col.begin_transaction_context(thread_idx, true);
                 auto res = col.get(ctx, item.miss_key);
                 if (res) miss_accumulator += 1;
+                col.abort(ctx);
             }
         });
     }
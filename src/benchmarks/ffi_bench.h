@@ -91,6 +91,7 @@ inline void run_ffi_style_benchmark(::Database* db) {
     }
 
     auto end_get = std::chrono::high_resolution_clock::now();
+    col.abort(get_ctx);
     
     auto get_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_get - start_get);
 
@@ -837,6 +837,7 @@ inline void run_graph_benchmark() {
             "Triangles: " + std::to_string(triangle_count)
         });
     }
+    db->abort(read_ctx);
 
     print_graph_results_table(results_table);
     print_graph_results_table(query_results); 
@@ -206,7 +206,7 @@ inline void run_db_mixed_workload(std::unique_ptr<::Database>& db, size_t num_th
                     failed_verifications.push_back({key, expected_value});
                 }
             }
-            
+            col.abort(ctx);
         });
     }
     for (auto& t : verification_threads) if (t.joinable()) t.join();
@@ -231,6 +231,7 @@ inline void run_db_mixed_workload(std::unique_ptr<::Database>& db, size_t num_th
                 std::cerr << "    [RE-VERIFY FAILED] Key: '" << key << "'. Expected: '" << expected_value << "'. Got: '" << (res ? std::string(res->value_view()) : "NOT_FOUND") << "'" << std::endl;
             }
         }
+        col.abort(re_verify_ctx);
         
         
         if (still_failed_count == 0) {
@@ -258,6 +258,7 @@ inline void run_throughput_suite(const std::string& suite_name, size_t num_items
                     //db->dump_state(std::cerr);
                 }
             }
+            col.abort(ctx);
         });
     }
     for (auto& t : get_threads) if(t.joinable()) t.join();
@@ -284,6 +285,7 @@ inline void run_throughput_suite(const std::string& suite_name, size_t num_items
                 auto res = col.get(ctx, item.miss_key);
                 if (res) miss_accumulator += 1; 
             }
+            col.abort(ctx);
         });
     }
     for (auto& t : get_nonexistent_threads) if(t.joinable()) t.join();
@@ -338,6 +340,7 @@ inline void run_throughput_suite(const std::string& suite_name, size_t num_items
                     verification_errors.fetch_add(1, std::memory_order_relaxed);
                 }
             }
+            col.abort(ctx);
         });
     }
     for (auto& t : verification_threads) if (t.joinable()) t.join();
@@ -91,12 +91,21 @@ public:
         TxnContext item_ctx = col.begin_transaction_context(0, false); 
         TransactionBatch item_batch;
         
+        std::vector<std::pair<std::string, std::string>> item_rows;
+        item_rows.reserve(NUM_ITEMS * 4);
         for(int i = 1; i <= NUM_ITEMS; ++i) {
-            col.insert(item_ctx, item_batch, item_key(i, "id"), std::to_string(i));
-            col.insert(item_ctx, item_batch, item_key(i, "im_id"), std::to_string(random.uniform_int(1, 10000)));
-            col.insert(item_ctx, item_batch, item_key(i, "name"), random.rand_astring(14, 24));
-            col.insert(item_ctx, item_batch, item_key(i, "price"), std::to_string(random.uniform_int(100, 10000) / 100.0));
+            item_rows.emplace_back(item_key(i, "id"), std::to_string(i));
+            item_rows.emplace_back(item_key(i, "im_id"), std::to_string(random.uniform_int(1, 10000)));
+            item_rows.emplace_back(item_key(i, "name"), random.rand_astring(14, 24));
+            item_rows.emplace_back(item_key(i, "price"), std::to_string(random.uniform_int(100, 10000) / 100.0));
         }
+        std::sort(item_rows.begin(), item_rows.end());
+        std::vector<CoreKVPair> item_pairs;
+        item_pairs.reserve(item_rows.size());
+        for (const auto& row : item_rows) {
+            item_pairs.push_back({row.first, row.second});
+        }
+        col.insert_batch(item_ctx, item_batch, item_pairs.data(), item_pairs.size());
         col.commit(item_ctx, item_batch);
         std::cout << "  - Items loaded." << std::endl;
 
@@ -62,6 +62,24 @@ static void clear_last_error() {
     last_error_message.clear();
 }
 
+// A read-only context on the calling thread's leased slot, ended when the
+// call returns or throws.
+class ScopedReadContext {
+public:
+    explicit ScopedReadContext(Database* db)
+        : db_(db), ctx_(db->begin_transaction_context(db->get_thread_slot(), true)) {}
+    ~ScopedReadContext() { db_->abort(ctx_); }
+
+    ScopedReadContext(const ScopedReadContext&) = delete;
+    ScopedReadContext& operator=(const ScopedReadContext&) = delete;
+
+    const TxnContext& get() const { return ctx_; }
+
+private:
+    Database* db_;
+    TxnContext ctx_;
+};
+
 
 StaxDB staxdb_init_path(const char* path, size_t num_threads, StaxDurabilityLevel durability_level_enum) {
     clear_last_error();
@@ -71,7 +89,14 @@ StaxDB staxdb_init_path(const char* path, size_t num_threads, StaxDurabilityLeve
             return NULL;
         }
         std::filesystem::path db_dir(path);
-        DurabilityLevel cpp_durability_level = (durability_level_enum == StaxDurability_SyncOnCommit) ? DurabilityLevel::SyncOnCommit : DurabilityLevel::NoSync;
+        DurabilityLevel cpp_durability_level = DurabilityLevel::NoSync;
+        if (durability_level_enum == StaxDurability_SyncOnCommit) {
+            cpp_durability_level = DurabilityLevel::SyncOnCommit;
+        } else if (durability_level_enum == StaxDurability_Wal) {
+            cpp_durability_level = DurabilityLevel::Wal;
+        } else if (durability_level_enum == StaxDurability_Periodic) {
+            cpp_durability_level = DurabilityLevel::Periodic;
+        }
 
         std::unique_ptr<Database> db_ptr;
         if (std::filesystem::exists(db_dir) && std::filesystem::exists(db_dir / "data.stax")) {
@@ -158,7 +183,7 @@ void staxdb_insert(StaxDB db, StaxCollection collection_idx, StaxSlice key, Stax
     if (!key.data && key.len > 0) { set_last_error("Key slice data is NULL."); return; }
     if (!value.data && value.len > 0) { set_last_error("Value slice data is NULL."); return; }
     try {
-        db->db->get_collection_by_idx(collection_idx).insert_sync_direct(to_string_view(key), to_string_view(value), 0);
+        db->db->get_collection_by_idx(collection_idx).insert_sync_direct(to_string_view(key), to_string_view(value), db->db->get_thread_slot());
     } catch (const std::exception& e) {
         set_last_error(e.what());
     }
@@ -169,7 +194,7 @@ void staxdb_remove(StaxDB db, StaxCollection collection_idx, StaxSlice key) {
     if (!db || !db->db) { set_last_error("Database handle is NULL."); return; }
     if (!key.data && key.len > 0) { set_last_error("Key slice data is NULL."); return; }
     try {
-        db->db->get_collection_by_idx(collection_idx).remove_sync_direct(to_string_view(key), 0);
+        db->db->get_collection_by_idx(collection_idx).remove_sync_direct(to_string_view(key), db->db->get_thread_slot());
     } catch (const std::exception& e) {
         set_last_error(e.what());
     }
@@ -188,8 +213,8 @@ StaxOptionalSlice staxdb_get(StaxDB db, StaxCollection collection_idx, StaxSlice
     }
     try {
         Collection& col = db->db->get_collection_by_idx(collection_idx);
-        TxnContext ctx = col.begin_transaction_context(0, true);
-        auto record = col.get(ctx, to_string_view(key));
+        ScopedReadContext read_ctx(db->db.get());
+        auto record = col.get(read_ctx.get(), to_string_view(key));
         if (record.has_value()) {
             value_buffer.assign(record->value_ptr, record->value_len);
             return {{value_buffer.data(), value_buffer.length()}, true};
@@ -210,11 +235,14 @@ void staxdb_insert_batch(StaxDB db, StaxCollection collection_idx, const StaxKVP
         Database* cpp_db = db->db.get();
         Collection& col = cpp_db->get_collection_by_idx(collection_idx);
         
-        TxnContext ctx = col.begin_transaction_context(0, false);
-        TransactionBatch batch;
+        std::vector<CoreKVPair> kv_pairs(num_pairs);
         for (size_t i = 0; i < num_pairs; ++i) {
-            col.insert(ctx, batch, to_string_view(pairs[i].key), to_string_view(pairs[i].value));
+            kv_pairs[i] = {to_string_view(pairs[i].key), to_string_view(pairs[i].value)};
         }
+
+        TxnContext ctx = col.begin_transaction_context(cpp_db->get_thread_slot(), false);
+        TransactionBatch batch;
+        col.insert_batch(ctx, batch, kv_pairs.data(), kv_pairs.size());
         col.commit(ctx, batch);
 
     } catch (const std::exception& e) {
@@ -233,7 +261,7 @@ StaxResultSet staxdb_execute_range_query(Database* db_instance, StaxCollection c
 
         auto kv_data = new StaxKVResultSetData_t();
         
-        TxnContext ctx = db_instance->begin_transaction_context(0, true);
+        ScopedReadContext read_ctx(db_instance);
         Collection& col = db_instance->get_collection_by_idx(collection_idx);
         
         std::string_view start_key = (options && options->start_key.data) ? to_string_view(options->start_key) : "";
@@ -243,7 +271,7 @@ StaxResultSet staxdb_execute_range_query(Database* db_instance, StaxCollection c
         }
 
         
-        for (auto cursor = col.seek(ctx, start_key, end_key); cursor->is_valid(); cursor->next()) {
+        for (auto cursor = col.seek(read_ctx.get(), start_key, end_key); cursor->is_valid(); cursor->next()) {
             std::string_view key_sv = cursor->key();
             DataView value_dv = cursor->value();
             
@@ -299,7 +327,7 @@ void staxdb_graph_insert_fact_string(StaxGraph graph, uint32_t obj_id, StaxSlice
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         std::string_view field_name_sv = to_string_view(field);
         uint32_t field_id = global_id_map.get_or_create_id(field_name_sv);
         txn.insert_fact_string(obj_id, field_id, field_name_sv, to_string_view(value));
@@ -313,7 +341,7 @@ void staxdb_graph_insert_fact_numeric(StaxGraph graph, uint32_t obj_id, StaxSlic
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         std::string_view field_name_sv = to_string_view(field);
         uint32_t field_id = global_id_map.get_or_create_id(field_name_sv);
         txn.insert_fact_numeric(obj_id, field_id, field_name_sv, value);
@@ -327,7 +355,7 @@ void staxdb_graph_insert_fact_geo(StaxGraph graph, uint32_t obj_id, StaxSlice fi
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         std::string_view field_name_sv = to_string_view(field);
         uint32_t field_id = global_id_map.get_or_create_id(field_name_sv);
         txn.insert_fact_geo(obj_id, field_id, field_name_sv, latitude, longitude);
@@ -341,7 +369,7 @@ void staxdb_graph_insert_relationship(StaxGraph graph, uint32_t source_id, StaxS
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         uint32_t rel_id = global_id_map.get_or_create_id(to_string_view(rel_type));
         txn.insert_fact(source_id, rel_id, target_id);
         txn.commit();
@@ -361,7 +389,7 @@ uint32_t staxdb_graph_insert_object(StaxGraph graph, const StaxObjectProperty* p
     if (!graph) { set_last_error("Graph handle is invalid."); return 0; }
     if (!properties && num_properties > 0) { set_last_error("Properties pointer is NULL for object insert."); return 0; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         DbGeneration* active_gen = graph->db_instance->get_active_generation();
         if (!active_gen) {
             set_last_error("No active database generation found.");
@@ -401,7 +429,7 @@ void staxdb_graph_update_object(StaxGraph graph, uint32_t obj_id, const StaxObje
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     if (!properties && num_properties > 0) { set_last_error("Properties pointer is NULL for object update."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         std::vector<StaxObjectProperty> props_vec(properties, properties + num_properties);
         txn.update_object(obj_id, props_vec);
         txn.commit();
@@ -419,7 +447,7 @@ StaxResultSet staxdb_graph_get_object(StaxGraph graph, uint32_t obj_id) {
     }
     try {
         auto kv_data = new StaxKVResultSetData_t();
-        TxnContext read_ctx = graph->db_instance->begin_transaction_context(0, true);
+        ScopedReadContext read_ctx(graph->db_instance);
         
         char prefix_buf[GraphTransaction::BINARY_U32_SIZE];
         size_t prefix_len = to_binary_key_buf(obj_id, prefix_buf, sizeof(prefix_buf));
@@ -434,7 +462,7 @@ StaxResultSet staxdb_graph_get_object(StaxGraph graph, uint32_t obj_id) {
         kv_data->kv_pairs.push_back({{reinterpret_cast<const char*>(key_offset), id_key_str.length()}, {reinterpret_cast<const char*>(val_offset), id_val_str.length()}});
 
 
-        for (auto cursor = graph->db_instance->get_ofv_collection()->seek(read_ctx, prefix); cursor->is_valid() && cursor->key().starts_with(prefix); cursor->next()) {
+        for (auto cursor = graph->db_instance->get_ofv_collection()->seek(read_ctx.get(), prefix); cursor->is_valid() && cursor->key().starts_with(prefix); cursor->next()) {
             std::string_view key_view = cursor->key();
             std::string_view value_payload = cursor->value();
             
@@ -521,8 +549,8 @@ StaxResultSet staxdb_graph_execute_plan(StaxGraph graph, uint32_t plan_id, const
 
     try {
         const auto& plan = graph->compiled_plans[plan_id];
-        TxnContext read_ctx = graph->db_instance->begin_transaction_context(0, true);
-        GraphReader reader(graph->db_instance, read_ctx);
+        ScopedReadContext read_ctx(graph->db_instance);
+        GraphReader reader(graph->db_instance, read_ctx.get());
         roaring_bitmap_t* current_results = roaring_bitmap_create();
         size_t param_idx = 0;
 
@@ -623,8 +651,8 @@ void staxdb_graph_update_fact_string(StaxGraph graph, uint32_t obj_id, StaxSlice
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
-        TxnContext read_ctx = {0, txn.get_read_snapshot_id(), 0};
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
+        TxnContext read_ctx = {0, txn.get_read_snapshot_id(), txn.get_thread_id()};
         GraphReader reader(graph->db_instance, read_ctx);
         std::string_view field_name_sv = to_string_view(field);
         uint32_t field_id = global_id_map.get_or_create_id(field_name_sv);
@@ -645,8 +673,8 @@ void staxdb_graph_update_fact_numeric(StaxGraph graph, uint32_t obj_id, StaxSlic
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
-        TxnContext read_ctx = {0, txn.get_read_snapshot_id(), 0};
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
+        TxnContext read_ctx = {0, txn.get_read_snapshot_id(), txn.get_thread_id()};
         GraphReader reader(graph->db_instance, read_ctx);
         std::string_view field_name_sv = to_string_view(field);
         uint32_t field_id = global_id_map.get_or_create_id(field_name_sv);
@@ -667,7 +695,7 @@ void staxdb_graph_delete_object(StaxGraph graph, uint32_t obj_id) {
     clear_last_error();
     if (!graph) { set_last_error("Graph handle is invalid."); return; }
     try {
-        GraphTransaction txn(graph->db_instance, 0);
+        GraphTransaction txn(graph->db_instance, graph->db_instance->get_thread_slot());
         txn.clear_object_facts(obj_id);
         txn.commit();
     } catch (const std::exception& e) {
@@ -714,9 +742,7 @@ StaxPageResult staxdb_resultset_get_page(StaxResultSet result_set, uint32_t page
             size_t start_index = (page.page_number - 1) * page_size;
 
             roaring_uint32_iterator_t* it = roaring_create_iterator(result_set->bitmap);
-            for(size_t i = 0; i < start_index; ++i) {
-                 if (it->has_next) roaring_advance_uint32_iterator(it); else break;
-            }
+            roaring_skip_uint32_iterator(it, start_index);
 
             page_kv_pairs.clear();
             page_data_buffer.clear();
@@ -60,7 +60,9 @@ typedef struct {
 
 typedef enum {
     StaxDurability_NoSync = 0,
-    StaxDurability_SyncOnCommit = 1
+    StaxDurability_SyncOnCommit = 1,
+    StaxDurability_Wal = 2,
+    StaxDurability_Periodic = 3
 } StaxDurabilityLevel;
 
 
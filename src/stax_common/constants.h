@@ -14,7 +14,20 @@
 #define MAX_COLLECTIONS_PER_DB_INITIAL 64
 
 #define NODE_ALLOCATOR_CHUNK_SIZE (16 * 1024)
+#define SPAN_NODE16_MIN_FANOUT 5
+#define SPAN_NODE256_MIN_FANOUT 48
 #define RECORD_ALLOCATOR_CHUNK_SIZE (1 * 1024 * 1024)
+#define PARALLEL_SCAN_MIN_KEYS_PER_PARTITION 16384
+#define RECLAIM_MAX_POOLED_BLOCK_SIZE 1024
+#define EPOCH_RECLAIM_BATCH_SIZE 256
+#define HASH_INDEX_MIN_CAPACITY (64 * 1024)
+#define HASH_INDEX_MAX_LOAD_PERCENT 75
+#define JUMP_TABLE_BITS 12
+#define SNAPSHOT_REGISTRY_ENTRIES_PER_SLOT 8
+#define COMMIT_WATERMARK_SLOTS_PER_SHARD 8
+#define DIRTY_RANGE_COALESCE_THRESHOLD 1024
+#define WAL_CHECKPOINT_INTERVAL_MS 1000
+#define WAL_CHECKPOINT_LOG_BYTES (64 * 1024 * 1024)
 
 #define TLAB_SIZE_BYTES_NODES NODE_ALLOCATOR_CHUNK_SIZE
 #define TLAB_SIZE_BYTES_RECORDS RECORD_ALLOCATOR_CHUNK_SIZE
@@ -31,6 +44,22 @@
 #define GRAPH_BATCH_FLUSH_THRESHOLD_KVS (size_t)(MAX_GRAPH_KV_PAIRS_PER_BATCH * 0.90)
 
 #define LIBRARIAN_WAKE_UP_INTERVAL_SECONDS 2
+#define LIBRARIAN_CPU_BUDGET_MS 50
+#define LIBRARIAN_IO_BUDGET_BYTES (32 * 1024 * 1024)
+#define PERIODIC_FLUSH_INTERVAL_MS 1000
+#define LIBRARIAN_VERSION_GC_INTERVAL_MS 5000
+#define LIBRARIAN_VERSION_GC_KEYS_PER_STEP 4096
+#define LIBRARIAN_STATISTICS_INTERVAL_MS 10000
+#define LIBRARIAN_PREFETCH_INTERVAL_MS 30000
+#define LIBRARIAN_PREFETCH_BYTES_PER_COLLECTION (1 * 1024 * 1024)
+#define LIBRARIAN_COMPACTION_CHECK_INTERVAL_MS 60000
+#define LIBRARIAN_COMPACTION_MIN_BYTES (256 * 1024 * 1024)
+#define LIBRARIAN_COMPACTION_LIVE_PERCENT 25
+#define ONLINE_COMPACTION_IO_BYTES_PER_SEC (64 * 1024 * 1024)
+#define ONLINE_COMPACTION_QUIESCE_TIMEOUT_MS 2000
+#define ONLINE_COMPACTION_CATCH_UP_ROUNDS 8
+#define ONLINE_COMPACTION_SWAP_BACKLOG_BYTES (1 * 1024 * 1024)
+#define ONLINE_COMPACTION_RETRY_BACKOFF_MS (10 * 60 * 1000)
 
 #define BENCHMARK_NUM_THREADS 8
 #define BENCHMARK_NUM_ENTRIES_TOTAL 1'000'000
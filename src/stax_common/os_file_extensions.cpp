@@ -37,6 +37,9 @@ namespace OSFileExtensions {
     OsFileHandleType open_file_for_reading_writing(const std::filesystem::path& path) {
         return open(path.c_str(), O_RDWR, 0644);
     }
+    OsFileHandleType open_or_create_file(const std::filesystem::path& path) {
+        return open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    }
     void close_file(OsFileHandleType handle) {
         if (handle != INVALID_OS_FILE_HANDLE) close(handle);
     }
@@ -76,6 +79,19 @@ namespace OSFileExtensions {
         return "";
     }
 
+    std::string sync_file_raw(OsFileHandleType handle) {
+#if defined(__APPLE__)
+        if (fsync(handle) == -1) {
+            return "fsync failed: " + std::string(strerror(errno));
+        }
+#else
+        if (fdatasync(handle) == -1) {
+            return "fdatasync failed: " + std::string(strerror(errno));
+        }
+#endif
+        return "";
+    }
+
     
     std::pair<void*, std::string> map_file_raw(OsFileHandleType fd, size_t offset, size_t length, bool is_writeable) {
         if (length == 0) return {nullptr, ""};
@@ -101,6 +117,11 @@ namespace OSFileExtensions {
         }
         return "";
     }
+
+    size_t get_page_size() {
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return page_size;
+    }
     
     
     size_t get_resident_memory_for_range(void* start_addr, size_t length) {
@@ -157,6 +178,9 @@ namespace OSFileExtensions {
     OsFileHandleType open_file_for_reading_writing(const std::filesystem::path& path) {
         return CreateFileA(path.string().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     }
+    OsFileHandleType open_or_create_file(const std::filesystem::path& path) {
+        return CreateFileA(path.string().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    }
     void close_file(OsFileHandleType handle) {
         if (handle != INVALID_OS_FILE_HANDLE) CloseHandle(handle);
     }
@@ -216,6 +240,13 @@ namespace OSFileExtensions {
         return "";
     }
 
+    std::string sync_file_raw(OsFileHandleType handle) {
+        if (!FlushFileBuffers(handle)) {
+            return "FlushFileBuffers failed: " + std::system_category().message(GetLastError());
+        }
+        return "";
+    }
+
     
     std::pair<void*, std::string> map_file_raw(OsFileHandleType hFile, size_t offset, size_t length, bool is_writeable) {
         if (length == 0) return {nullptr, ""};
@@ -256,6 +287,15 @@ namespace OSFileExtensions {
         }
         return "";
     }
+
+    size_t get_page_size() {
+        static const size_t page_size = [] {
+            SYSTEM_INFO sysInfo;
+            GetSystemInfo(&sysInfo);
+            return static_cast<size_t>(sysInfo.dwPageSize);
+        }();
+        return page_size;
+    }
     
     
     size_t get_resident_memory_for_range(void* start_addr, size_t length) {
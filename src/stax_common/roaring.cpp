@@ -660,6 +660,31 @@ void roaring_advance_uint32_iterator(roaring_uint32_iterator_t* it) {
     }
 }
 
+// Moves the iterator forward by count values, stepping over whole containers
+// by their cardinality instead of visiting every value in them.
+void roaring_skip_uint32_iterator(roaring_uint32_iterator_t* it, uint64_t count) {
+    if (!it) return;
+    const roaring_array_t* ra = &it->bitmap->high_low_container;
+    while (it->has_next && count > 0) {
+        const int64_t cardinality = roaring_container_get_cardinality(ra->containers[it->container_index]);
+        const uint64_t remaining_in_container = (uint64_t)(cardinality - it->inner_index);
+        if (count < remaining_in_container) {
+            it->inner_index += (int32_t)count;
+            return;
+        }
+        count -= remaining_in_container;
+        it->inner_index = 0;
+        it->container_index++;
+        while(it->container_index < ra->num_containers &&
+              roaring_container_get_cardinality(ra->containers[it->container_index]) == 0) {
+            it->container_index++;
+        }
+        if (it->container_index >= ra->num_containers) {
+            it->has_next = false;
+        }
+    }
+}
+
 bool roaring_bitmap_to_uint32_array(const roaring_bitmap_t *r, uint32_t *out) {
     if(!r || !out) return false;
     uint32_t pos = 0;
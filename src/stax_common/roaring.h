@@ -75,6 +75,7 @@ roaring_uint32_iterator_t* roaring_create_iterator(const roaring_bitmap_t* r);
 void roaring_free_iterator(roaring_uint32_iterator_t* it);
 uint32_t roaring_read_uint32(roaring_uint32_iterator_t* it, void* val);
 void roaring_advance_uint32_iterator(roaring_uint32_iterator_t* it);
+void roaring_skip_uint32_iterator(roaring_uint32_iterator_t* it, uint64_t count);
 
 
 bool roaring_bitmap_to_uint32_array(const roaring_bitmap_t *r, uint32_t *out);
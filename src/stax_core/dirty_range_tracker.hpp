@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <mutex>
+
+#include "stax_common/constants.h"
+#include "stax_common/spin_locks.h"
+#include "stax_core/epoch_manager.hpp"
+
+
+// Page ranges of the mapping written on behalf of each thread slot since the
+// last durable commit, as byte offsets from the start of the mapping, so a
+// commit can msync just those pages instead of the whole reservation. A
+// committed key can hang under nodes that another slot linked and has not
+// committed yet, so commits flush the ranges of every slot. Each slot's list
+// has its own lock, taken by its thread and by the flushing committer. The
+// maintenance slot keeps its own ranges, which its tasks flush themselves;
+// a tracker can follow that slot alone when commits are not synced.
+class DirtyRangeTracker
+{
+public:
+    using Range = std::pair<uint64_t, uint64_t>; // [begin, end)
+
+    explicit DirtyRangeTracker(size_t page_size, bool tracks_thread_slots = true)
+        : page_size_(page_size), page_mask_(~(static_cast<uint64_t>(page_size) - 1)), tracks_thread_slots_(tracks_thread_slots) {}
+
+    // Writes without a slot of their own (thread_id out of range) are not
+    // tracked; their owner flushes them.
+    void mark(size_t thread_id, uint64_t byte_offset, size_t size_bytes)
+    {
+        if (thread_id > MAINTENANCE_THREAD_SLOT || size_bytes == 0 || (thread_id != MAINTENANCE_THREAD_SLOT && !tracks_thread_slots_))
+            return;
+        const uint64_t begin = byte_offset & page_mask_;
+        const uint64_t end = (byte_offset + size_bytes + page_size_ - 1) & page_mask_;
+        SlotRanges &slot = slots_[thread_id];
+        std::lock_guard<SpinLock> lock(slot.lock);
+        std::vector<Range> &ranges = slot.ranges;
+        if (!ranges.empty() && begin <= ranges.back().second && end >= ranges.back().first)
+        {
+            ranges.back().first = (std::min)(ranges.back().first, begin);
+            ranges.back().second = (std::max)(ranges.back().second, end);
+            return;
+        }
+        ranges.emplace_back(begin, end);
+        if (ranges.size() >= DIRTY_RANGE_COALESCE_THRESHOLD)
+            coalesce(ranges);
+    }
+
+    // Hands the slot's ranges, sorted and merged, to out and starts a new set.
+    void take(size_t thread_id, std::vector<Range> &out);
+    // Appends the ranges of every thread slot to out, unsorted, and starts
+    // new sets. The maintenance slot's ranges stay.
+    void take_all(std::vector<Range> &out);
+
+    size_t get_page_size() const { return page_size_; }
+
+    // Sorts ranges and merges the ones that overlap or touch.
+    static void coalesce(std::vector<Range> &ranges);
+
+private:
+
+    struct alignas(64) SlotRanges
+    {
+        SpinLock lock;
+        std::vector<Range> ranges;
+    };
+
+    size_t page_size_;
+    uint64_t page_mask_;
+    bool tracks_thread_slots_;
+    std::array<SlotRanges, MAINTENANCE_THREAD_SLOT + 1> slots_;
+};
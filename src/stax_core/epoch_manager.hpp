@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <chrono>
+
+#include "stax_common/constants.h"
+#include "stax_common/spin_locks.h"
+
+
+// Slot of the background maintenance thread, which retires blocks outside
+// any transaction. It has no TLABs; what it reclaims goes to a shared list.
+constexpr size_t MAINTENANCE_THREAD_SLOT = MAX_CONCURRENT_THREADS;
+
+// Recycled arena blocks of one allocator, bucketed by exact size. Each thread
+// slot owns its own lists, so like the TLABs they need no locking as long as
+// a slot is driven by one thread at a time. Blocks pushed by the maintenance
+// slot are shared under a lock, and taken once a slot's own list runs dry.
+class FreeBlockPool
+{
+public:
+    static constexpr size_t GRANULARITY = 8;
+    static constexpr size_t NUM_SIZE_CLASSES = RECLAIM_MAX_POOLED_BLOCK_SIZE / GRANULARITY;
+
+    static constexpr bool is_pooled_size(size_t size_bytes)
+    {
+        return size_bytes > 0 && size_bytes <= RECLAIM_MAX_POOLED_BLOCK_SIZE && size_bytes % GRANULARITY == 0;
+    }
+
+    void push(size_t thread_id, uint64_t byte_offset, size_t size_bytes);
+
+    bool pop(size_t thread_id, size_t size_bytes, uint64_t &out_byte_offset)
+    {
+        if (!is_pooled_size(size_bytes))
+            return false;
+        if (SlotLists *lists = slots_[thread_id].get())
+        {
+            std::vector<uint64_t> &free_list = lists->by_size_class[size_bytes / GRANULARITY - 1];
+            if (!free_list.empty())
+            {
+                out_byte_offset = free_list.back();
+                free_list.pop_back();
+                pooled_bytes_.fetch_sub(size_bytes, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return shared_block_count_.load(std::memory_order_relaxed) != 0 && pop_shared(size_bytes, out_byte_offset);
+    }
+
+    uint64_t get_pooled_bytes() const { return pooled_bytes_.load(std::memory_order_relaxed); }
+
+private:
+    struct SlotLists
+    {
+        std::array<std::vector<uint64_t>, NUM_SIZE_CLASSES> by_size_class;
+    };
+    bool pop_shared(size_t size_bytes, uint64_t &out_byte_offset);
+
+    std::array<std::unique_ptr<SlotLists>, MAX_CONCURRENT_THREADS> slots_;
+    std::unique_ptr<SlotLists> shared_lists_;
+    SpinLock shared_lock_;
+    std::atomic<uint64_t> shared_block_count_{0};
+    std::atomic<uint64_t> pooled_bytes_{0};
+};
+
+
+// Epoch-based reclamation for one database. Readers pin the current epoch
+// for as long as they may hold pointers into the arena; a retired block goes
+// back to its pool once the global epoch has moved two steps past the epoch
+// it was retired in, at which point no pinned reader can still reach it.
+// Pins are counted per stripe rather than per thread, so a pin may be taken
+// from any thread (parallel scans share a TxnContext across threads).
+class EpochManager
+{
+public:
+    EpochManager();
+
+    uint64_t enter(size_t stripe)
+    {
+        std::atomic<uint64_t> *pin_count;
+        uint64_t epoch;
+        for (;;)
+        {
+            epoch = global_epoch_.load(std::memory_order_acquire);
+            pin_count = &pins_[epoch % 3][stripe % MAX_CONCURRENT_THREADS].count;
+            pin_count->fetch_add(1, std::memory_order_seq_cst);
+            if (global_epoch_.load(std::memory_order_seq_cst) == epoch)
+                return epoch;
+            pin_count->fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void exit(uint64_t epoch, size_t stripe)
+    {
+        pins_[epoch % 3][stripe % MAX_CONCURRENT_THREADS].count.fetch_sub(1, std::memory_order_release);
+    }
+
+    // The block must already be unreachable from the tree. Only the owner of
+    // thread_id (or MAINTENANCE_THREAD_SLOT) may retire on its behalf.
+    void retire(size_t thread_id, FreeBlockPool &pool, uint64_t byte_offset, size_t size_bytes);
+    void reclaim(size_t thread_id);
+
+    uint64_t get_global_epoch() const { return global_epoch_.load(std::memory_order_acquire); }
+
+    // Moves the epoch on until every pin taken before the call is released,
+    // or the timeout passes; returns whether they were.
+    bool wait_for_pins(std::chrono::milliseconds timeout);
+
+    // Stripe for callers that have no thread slot of their own.
+    static size_t current_thread_stripe();
+
+private:
+    bool try_advance();
+
+    struct alignas(64) PinCounter
+    {
+        std::atomic<uint64_t> count{0};
+    };
+
+    struct RetiredBlock
+    {
+        FreeBlockPool *pool;
+        uint64_t byte_offset;
+        size_t size_bytes;
+        uint64_t epoch;
+    };
+
+    struct alignas(64) RetireList
+    {
+        std::vector<RetiredBlock> blocks;
+    };
+
+    alignas(64) std::atomic<uint64_t> global_epoch_;
+    std::array<std::array<PinCounter, MAX_CONCURRENT_THREADS>, 3> pins_;
+    std::array<RetireList, MAX_CONCURRENT_THREADS + 1> retired_;
+};
+
+
+class EpochGuard
+{
+public:
+    EpochGuard() = default;
+    EpochGuard(EpochManager *manager, size_t stripe)
+        : manager_(manager), stripe_(stripe), epoch_(manager ? manager->enter(stripe) : 0) {}
+    ~EpochGuard() { release(); }
+
+    EpochGuard(EpochGuard &&other) noexcept
+        : manager_(std::exchange(other.manager_, nullptr)), stripe_(other.stripe_), epoch_(other.epoch_) {}
+    EpochGuard &operator=(EpochGuard &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            manager_ = std::exchange(other.manager_, nullptr);
+            stripe_ = other.stripe_;
+            epoch_ = other.epoch_;
+        }
+        return *this;
+    }
+
+    EpochGuard(const EpochGuard &) = delete;
+    EpochGuard &operator=(const EpochGuard &) = delete;
+
+    void release()
+    {
+        if (manager_)
+            manager_->exit(epoch_, stripe_);
+        manager_ = nullptr;
+    }
+
+private:
+    EpochManager *manager_ = nullptr;
+    size_t stripe_ = 0;
+    uint64_t epoch_ = 0;
+};
@@ -13,6 +13,7 @@
 #include "stax_common/constants.h"
 #include "stax_common/common_types.hpp"
 #include "stax_db/arena_structs.h" 
+#include "stax_core/epoch_manager.hpp"
 
 
 class Database; 
@@ -40,9 +41,11 @@ private:
         std::atomic<uint64_t> current_offset; 
     };
     std::array<ThreadLocalChunk, MAX_CONCURRENT_THREADS> thread_chunks_;
+    FreeBlockPool free_pool_;
 
     
     void request_new_chunk(size_t thread_id);
+    uint64_t allocate_bytes(size_t thread_id, size_t node_size);
     
     
     static constexpr size_t align_up(size_t size, size_t alignment) {
@@ -50,7 +53,6 @@ private:
     }
     
 public:
-    static thread_local std::vector<uint64_t> thread_local_free_list; 
     static constexpr uint64_t NIL_INDEX = std::numeric_limits<uint64_t>::max(); 
     
     
@@ -59,7 +61,13 @@ public:
     
     uint64_t allocate(size_t thread_id); 
     
-    void deallocate(uint64_t node_byte_offset); 
+    // Only for nodes that were never published; linked nodes go through the
+    // database's EpochManager instead.
+    void deallocate(size_t thread_id, uint64_t node_byte_offset); 
+    FreeBlockPool &get_free_pool() { return free_pool_; }
+
+    uint64_t allocate_span_node(size_t thread_id, bool wide, uint32_t bit_index);
+    void deallocate_span_node(size_t thread_id, uint64_t node_byte_offset, bool wide);
     
     
     STAX_ALWAYS_INLINE uint16_t get_bit_index(uint64_t node_byte_offset) const { 
@@ -74,12 +82,19 @@ public:
     STAX_ALWAYS_INLINE std::atomic<uint64_t>& get_right_child_ptr(uint64_t node_byte_offset) { 
         return reinterpret_cast<StaxTreeNode*>(mmap_base_addr_ + node_byte_offset)->right_child_ptr;
     }
+    STAX_ALWAYS_INLINE std::atomic<uint32_t>& get_live_leaf_count(uint64_t node_byte_offset) { 
+        return reinterpret_cast<StaxTreeNode*>(mmap_base_addr_ + node_byte_offset)->live_leaf_count;
+    }
     STAX_ALWAYS_INLINE const uint16_t* get_bit_index_ptr(uint64_t node_byte_offset) const { 
         return &(reinterpret_cast<const StaxTreeNode*>(mmap_base_addr_ + node_byte_offset)->bit_index);
     }
 
+    STAX_ALWAYS_INLINE std::atomic<uint64_t>& get_span_child_ptr(uint64_t node_byte_offset, uint32_t slot) { 
+        return reinterpret_cast<StaxSpanNode256*>(mmap_base_addr_ + node_byte_offset)->child_ptrs[slot];
+    }
+    STAX_ALWAYS_INLINE const void* get_node_address(uint64_t node_byte_offset) const { 
+        return mmap_base_addr_ + node_byte_offset;
+    }
+
     size_t get_total_occupied_size() const; 
 };
-
-template <typename T>
-thread_local std::vector<uint64_t> NodeAllocator<T>::thread_local_free_list;
\ No newline at end of file
@@ -1,11 +1,22 @@
 #include "stax_core/stax_tree.hpp"
+#include "stax_common/binary_utils.h"
+
+#include <bit>
 
 StaxTree::StaxTree(NodeAllocator<StaxTreeNode> &internal_alloc,
                    CollectionRecordAllocator &record_alloc,
-                   std::atomic<uint64_t> &root_ref)
+                   std::atomic<uint64_t> &root_ref,
+                   EpochManager *epoch_manager,
+                   const SnapshotRegistry *snapshot_registry,
+                   DirtyRangeTracker *dirty_range_tracker)
     : internal_node_allocator_(internal_alloc),
       record_allocator_(record_alloc),
-      root_ptr_(root_ref) {}
+      root_ptr_(root_ref),
+      epoch_manager_(epoch_manager),
+      snapshot_registry_(snapshot_registry),
+      dirty_range_tracker_(dirty_range_tracker),
+      jump_table_(std::make_unique<std::atomic<uint64_t>[]>(1ULL << JUMP_TABLE_BITS)),
+      order_statistics_enabled_(false) {}
 
 STAX_ALWAYS_INLINE bool StaxTree::get_bit(const char *s_data, size_t s_len, uint32_t bit_index) const
 {
@@ -28,6 +39,320 @@ STAX_ALWAYS_INLINE int StaxTree::count_leading_zeros(uint32_t x) const
 #endif
 }
 
+STAX_ALWAYS_INLINE void StaxTree::prefetch_for_read(const void *address) const
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_prefetch(static_cast<const char *>(address), _MM_HINT_T0);
+#elif defined(__aarch64__)
+    __builtin_prefetch(address, 0, 0);
+#endif
+}
+
+template <typename KeyTraits>
+STAX_ALWAYS_INLINE uint64_t StaxTree::key_hash(const char *key_data, size_t key_len) const
+{
+    if constexpr (KeyTraits::width != 0)
+        key_len = KeyTraits::width;
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ key_len;
+    size_t offset = 0;
+    for (; offset + 8 <= key_len; offset += 8)
+    {
+        uint64_t word;
+        memcpy(&word, key_data + offset, 8);
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    uint64_t tail = 0;
+    if (offset < key_len)
+        memcpy(&tail, key_data + offset, key_len - offset);
+    hash = (hash ^ tail) * 0x94D049BB133111EBULL;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+STAX_ALWAYS_INLINE uint64_t StaxTree::fingerprint_from_hash(uint64_t hash) const
+{
+    uint64_t fingerprint = hash >> 40;
+    return (fingerprint ? fingerprint : 1) << LEAF_FINGERPRINT_SHIFT;
+}
+
+template <typename KeyTraits>
+STAX_ALWAYS_INLINE uint64_t StaxTree::key_fingerprint(const char *key_data, size_t key_len) const
+{
+    return fingerprint_from_hash(key_hash<KeyTraits>(key_data, key_len));
+}
+
+STAX_ALWAYS_INLINE std::atomic<uint64_t> *StaxTree::child_link(uint64_t node_ptr, const char *key_data, size_t key_len) const
+{
+    if (node_ptr & SPAN_NODE_TAG_BIT)
+    {
+        const uint64_t node_offset = node_ptr & NODE_OFFSET_MASK;
+        const uint32_t slot = span_slot(key_data, key_len, internal_node_allocator_.get_bit_index(node_offset), (node_ptr & SPAN_NODE_WIDE_BIT) != 0);
+        return &internal_node_allocator_.get_span_child_ptr(node_offset, slot);
+    }
+    return get_bit(key_data, key_len, internal_node_allocator_.get_bit_index(node_ptr)) ? &internal_node_allocator_.get_right_child_ptr(node_ptr)
+                                                                                      : &internal_node_allocator_.get_left_child_ptr(node_ptr);
+}
+
+uint64_t StaxTree::link_offset(const std::atomic<uint64_t> *link) const
+{
+    return static_cast<uint64_t>(reinterpret_cast<const uint8_t *>(link) - static_cast<const uint8_t *>(internal_node_allocator_.get_node_address(0)));
+}
+
+std::atomic<uint64_t> *StaxTree::link_at(uint64_t byte_offset) const
+{
+    return reinterpret_cast<std::atomic<uint64_t> *>(const_cast<void *>(internal_node_allocator_.get_node_address(byte_offset)));
+}
+
+// Records and nodes are marked as they are allocated; this covers the
+// links and counters updated in place.
+STAX_ALWAYS_INLINE void StaxTree::mark_dirty(size_t thread_id, const void *address, size_t size_bytes)
+{
+    if (dirty_range_tracker_)
+    {
+        const uint8_t *arena_base = static_cast<const uint8_t *>(internal_node_allocator_.get_node_address(0));
+        dirty_range_tracker_->mark(thread_id, static_cast<uint64_t>(static_cast<const uint8_t *>(address) - arena_base), size_bytes);
+    }
+}
+
+// Once the index is past its load limit new keys are simply not indexed;
+// lookups that miss the index always fall back to the tree.
+void StaxTree::hash_index_insert(size_t thread_id, uint64_t hash, const std::atomic<uint64_t> *link)
+{
+    const uint64_t capacity = hash_index_->capacity;
+    if (hash_index_->used_slots.load(std::memory_order_relaxed) * 100 >= capacity * HASH_INDEX_MAX_LOAD_PERCENT)
+        return;
+
+    const uint64_t entry = ((hash >> HASH_INDEX_TAG_SHIFT) << HASH_INDEX_TAG_SHIFT) | link_offset(link);
+    for (uint64_t slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+    {
+        uint64_t expected = 0;
+        if (hash_index_slots_[slot].load(std::memory_order_relaxed) == 0 &&
+            hash_index_slots_[slot].compare_exchange_strong(expected, entry, std::memory_order_release, std::memory_order_relaxed))
+        {
+            hash_index_->used_slots.fetch_add(1, std::memory_order_relaxed);
+            mark_dirty(thread_id, &hash_index_slots_[slot], sizeof(uint64_t));
+            mark_dirty(thread_id, hash_index_, sizeof(HashIndexHeader));
+            return;
+        }
+    }
+}
+
+template <typename KeyTraits>
+uint64_t StaxTree::hash_index_lookup(const char *key_data, size_t key_len, uint64_t hash) const
+{
+    const uint64_t capacity = hash_index_->capacity;
+    const uint64_t tag = hash >> HASH_INDEX_TAG_SHIFT;
+    const uint64_t fingerprint = fingerprint_from_hash(hash);
+    for (uint64_t slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+    {
+        uint64_t entry = hash_index_slots_[slot].load(std::memory_order_acquire);
+        if (entry == 0)
+            return NIL_POINTER;
+        if ((entry >> HASH_INDEX_TAG_SHIFT) != tag)
+            continue;
+
+        std::atomic<uint64_t> *link = link_at(entry & HASH_INDEX_LINK_MASK);
+        uint64_t current_ptr = link->load(std::memory_order_acquire);
+        size_t steps_below_entry = 0;
+        while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+        {
+            link = child_link(current_ptr, key_data, key_len);
+            current_ptr = link->load(std::memory_order_acquire);
+            ++steps_below_entry;
+        }
+        if (current_ptr == NIL_POINTER || !leaf_may_match(current_ptr, fingerprint))
+            continue;
+
+        const char *stored_key_data;
+        uint32_t stored_key_len;
+        uint32_t stored_value_len;
+        record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK), &stored_key_data, stored_key_len, stored_value_len);
+        if (!stored_key_data || !keys_equal<KeyTraits>(stored_key_data, stored_key_len, key_data, key_len))
+            continue;
+
+        // Splits since the key was indexed pushed its leaf further down;
+        // point the entry at the leaf's current link again.
+        if (steps_below_entry > 1)
+            hash_index_slots_[slot].compare_exchange_strong(entry, (tag << HASH_INDEX_TAG_SHIFT) | link_offset(link), std::memory_order_relaxed);
+        return current_ptr;
+    }
+}
+
+void StaxTree::hash_index_subtree(size_t thread_id, std::atomic<uint64_t> *link)
+{
+    std::vector<std::atomic<uint64_t> *> pending_links{link};
+    while (!pending_links.empty())
+    {
+        std::atomic<uint64_t> *current_link = pending_links.back();
+        pending_links.pop_back();
+        const uint64_t current_ptr = current_link->load(std::memory_order_acquire);
+        if (current_ptr == NIL_POINTER)
+            continue;
+        if (current_ptr & POINTER_TAG_BIT)
+        {
+            const std::string_view key = record_allocator_.get_record_key_only(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK));
+            hash_index_insert(thread_id, key_hash(key.data(), key.length()), current_link);
+        }
+        else if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            const uint64_t node_offset = current_ptr & NODE_OFFSET_MASK;
+            for (uint32_t slot = 0; slot < span_node_fanout(current_ptr); ++slot)
+                pending_links.push_back(&internal_node_allocator_.get_span_child_ptr(node_offset, slot));
+        }
+        else
+        {
+            pending_links.push_back(&internal_node_allocator_.get_right_child_ptr(current_ptr));
+            pending_links.push_back(&internal_node_allocator_.get_left_child_ptr(current_ptr));
+        }
+    }
+}
+
+STAX_ALWAYS_INLINE uint32_t StaxTree::jump_slot(const char *key_data, size_t key_len) const
+{
+    uint32_t leading_bits = 0;
+    if (key_len > 0)
+        leading_bits = static_cast<uint32_t>(static_cast<uint8_t>(key_data[0])) << 8;
+    if (key_len > 1)
+        leading_bits |= static_cast<uint8_t>(key_data[1]);
+    return leading_bits >> (16 - JUMP_TABLE_BITS);
+}
+
+// Node to start a descent for key from, or NIL_POINTER for the root. Every
+// key sharing its leading bits with key passes through the returned node.
+uint64_t StaxTree::jump_table_start(const char *key_data, size_t key_len) const
+{
+    const uint64_t generation = jump_table_generation_.load(std::memory_order_acquire);
+    if (generation > JUMP_ENTRY_GENERATION_MASK)
+        return NIL_POINTER;
+
+    std::atomic<uint64_t> &entry = jump_table_[jump_slot(key_data, key_len)];
+    const uint64_t cached_entry = entry.load(std::memory_order_acquire);
+    if (((cached_entry >> JUMP_ENTRY_GENERATION_SHIFT) & JUMP_ENTRY_GENERATION_MASK) == generation)
+        return cached_entry & ~(JUMP_ENTRY_GENERATION_MASK << JUMP_ENTRY_GENERATION_SHIFT);
+
+    uint64_t deepest_node = NIL_POINTER;
+    uint64_t current_ptr = root_ptr_.load(std::memory_order_acquire);
+    uint64_t parent_ref;
+    while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT) &&
+           node_bit_index(current_ptr) + node_bits_tested(current_ptr) <= JUMP_TABLE_BITS)
+    {
+        deepest_node = current_ptr;
+        current_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+    }
+    entry.store(deepest_node | (generation << JUMP_ENTRY_GENERATION_SHIFT), std::memory_order_release);
+    return deepest_node;
+}
+
+void StaxTree::attach_hash_index(HashIndexHeader *index, bool populate)
+{
+    hash_index_ = index;
+    hash_index_slots_ = reinterpret_cast<std::atomic<uint64_t> *>(index + 1);
+    // Populated outside any transaction, so under no thread slot; the caller
+    // syncs the whole index.
+    if (populate)
+        hash_index_subtree(MAX_CONCURRENT_THREADS, &root_ptr_);
+}
+
+STAX_ALWAYS_INLINE bool StaxTree::leaf_may_match(uint64_t leaf_ptr, uint64_t fingerprint) const
+{
+    const uint64_t leaf_fingerprint = leaf_ptr & LEAF_FINGERPRINT_MASK;
+    return leaf_fingerprint == 0 || leaf_fingerprint == fingerprint;
+}
+
+STAX_ALWAYS_INLINE void StaxTree::prefetch_node(uint64_t node_ptr) const
+{
+    const char *node_address = static_cast<const char *>(internal_node_allocator_.get_node_address(node_ptr & NODE_OFFSET_MASK));
+    prefetch_for_read(node_address);
+    if ((node_ptr & (SPAN_NODE_TAG_BIT | SPAN_NODE_WIDE_BIT)) == SPAN_NODE_TAG_BIT)
+    {
+        prefetch_for_read(node_address + 64);
+        prefetch_for_read(node_address + 128);
+    }
+}
+
+STAX_ALWAYS_INLINE uint32_t StaxTree::span_slot(const char *s_data, size_t s_len, uint32_t start_bit, bool wide) const
+{
+    size_t byte_idx = start_bit / 8;
+    if (byte_idx >= s_len)
+        return 0;
+    const uint8_t byte = static_cast<uint8_t>(s_data[byte_idx]);
+    if (wide)
+        return byte;
+    return (start_bit % 8 == 0) ? (byte >> 4) : (byte & 0x0F);
+}
+
+STAX_ALWAYS_INLINE uint32_t StaxTree::node_bit_index(uint64_t node_ptr) const
+{
+    return internal_node_allocator_.get_bit_index(node_ptr & NODE_OFFSET_MASK);
+}
+
+STAX_ALWAYS_INLINE uint64_t StaxTree::next_child_ptr(uint64_t node_ptr, const char *key_data, size_t key_len, uint64_t &out_parent_ref, std::memory_order order) const
+{
+    if (node_ptr & SPAN_NODE_TAG_BIT)
+    {
+        const uint64_t node_offset = node_ptr & NODE_OFFSET_MASK;
+        const uint32_t slot = span_slot(key_data, key_len, internal_node_allocator_.get_bit_index(node_offset), (node_ptr & SPAN_NODE_WIDE_BIT) != 0);
+        out_parent_ref = node_ptr | (static_cast<uint64_t>(slot) << SPAN_SLOT_SHIFT);
+        return internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(order);
+    }
+
+    out_parent_ref = node_ptr;
+    bool bit = get_bit(key_data, key_len, internal_node_allocator_.get_bit_index(node_ptr));
+    return bit ? internal_node_allocator_.get_right_child_ptr(node_ptr).load(order) : internal_node_allocator_.get_left_child_ptr(node_ptr).load(order);
+}
+
+uint64_t StaxTree::next_occupied_span_slot(uint64_t span_ptr, uint32_t first_slot, uint64_t &out_parent_ref) const
+{
+    const uint64_t node_offset = span_ptr & NODE_OFFSET_MASK;
+    const uint32_t fanout = span_node_fanout(span_ptr);
+    for (uint32_t slot = first_slot; slot < fanout; ++slot)
+    {
+        uint64_t child_ptr = internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire);
+        if (child_ptr != NIL_POINTER)
+        {
+            out_parent_ref = span_ptr | (static_cast<uint64_t>(slot) << SPAN_SLOT_SHIFT);
+            return child_ptr;
+        }
+    }
+    out_parent_ref = span_ptr | (static_cast<uint64_t>(fanout - 1) << SPAN_SLOT_SHIFT);
+    return NIL_POINTER;
+}
+
+uint64_t StaxTree::prev_occupied_span_slot(uint64_t span_ptr, uint32_t end_slot, uint64_t &out_parent_ref) const
+{
+    const uint64_t node_offset = span_ptr & NODE_OFFSET_MASK;
+    for (uint32_t slot = end_slot; slot-- > 0;)
+    {
+        uint64_t child_ptr = internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire);
+        if (child_ptr != NIL_POINTER)
+        {
+            out_parent_ref = span_ptr | (static_cast<uint64_t>(slot) << SPAN_SLOT_SHIFT);
+            return child_ptr;
+        }
+    }
+    out_parent_ref = span_ptr;
+    return NIL_POINTER;
+}
+
+uint64_t StaxTree::leftmost_leaf(uint64_t subtree_ptr) const
+{
+    uint64_t current_ptr = subtree_ptr;
+    while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+    {
+        if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            uint64_t parent_ref;
+            current_ptr = next_occupied_span_slot(current_ptr, 0, parent_ref);
+        }
+        else
+        {
+            current_ptr = internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_acquire);
+        }
+    }
+    return current_ptr;
+}
+
 STAX_ALWAYS_INLINE int StaxTree::simd_memcmp(const char *s1, const char *s2, size_t n) const
 {
     size_t offset = 0;
@@ -172,6 +497,66 @@ found_diff_byte:
     return static_cast<uint32_t>((diff_byte_idx * 8) + (count_leading_zeros(static_cast<uint32_t>(diff)) - ((std::numeric_limits<unsigned int>::digits) - 8)));
 }
 
+template <typename KeyTraits>
+STAX_ALWAYS_INLINE bool StaxTree::keys_equal(const char *stored_key_data, size_t stored_key_len, const char *key_data, size_t key_len) const
+{
+    if constexpr (KeyTraits::width != 0)
+        return stored_key_len == KeyTraits::width && memcmp(stored_key_data, key_data, KeyTraits::width) == 0;
+    else
+        return stored_key_len == key_len && simd_memcmp(stored_key_data, key_data, key_len) == 0;
+}
+
+// Two keys of the same fixed width are compared as big-endian words, so the
+// first differing bit is a single count-leading-zeros.
+template <typename KeyTraits>
+STAX_ALWAYS_INLINE uint32_t StaxTree::critical_bit_against(const char *key_data, size_t key_len, const char *stored_key_data, size_t stored_key_len) const
+{
+    if constexpr (KeyTraits::width != 0)
+    {
+        if (stored_key_len == KeyTraits::width)
+        {
+            constexpr size_t high_bytes = (std::min)(KeyTraits::width, static_cast<size_t>(8));
+            uint64_t key_word = 0, stored_word = 0;
+            memcpy(&key_word, key_data, high_bytes);
+            memcpy(&stored_word, stored_key_data, high_bytes);
+            uint64_t diff = be64toh(key_word ^ stored_word);
+            if (diff != 0)
+                return static_cast<uint32_t>(std::countl_zero(diff));
+
+            if constexpr (KeyTraits::width > 8)
+            {
+                key_word = 0;
+                stored_word = 0;
+                memcpy(&key_word, key_data + 8, KeyTraits::width - 8);
+                memcpy(&stored_word, stored_key_data + 8, KeyTraits::width - 8);
+                diff = be64toh(key_word ^ stored_word);
+                if (diff != 0)
+                    return 64 + static_cast<uint32_t>(std::countl_zero(diff));
+            }
+            return (std::numeric_limits<uint32_t>::max)();
+        }
+    }
+    return find_critical_bit(key_data, key_len, stored_key_data, stored_key_len);
+}
+
+template <typename Fn>
+static STAX_ALWAYS_INLINE decltype(auto) dispatch_key_width(size_t key_len, Fn &&fn)
+{
+    switch (key_len)
+    {
+    case 9:
+        return fn(FixedWidthKey<9>{});
+    case 12:
+        return fn(FixedWidthKey<12>{});
+    case 13:
+        return fn(FixedWidthKey<13>{});
+    case 16:
+        return fn(FixedWidthKey<16>{});
+    default:
+        return fn(VariableWidthKey{});
+    }
+}
+
 std::atomic<uint64_t> *StaxTree::get_link_from_step(const TraversalStep &step)
 {
     if (step.parent_node_idx == PARENT_IS_ROOT)
@@ -179,6 +564,12 @@ std::atomic<uint64_t> *StaxTree::get_link_from_step(const TraversalStep &step)
         return &root_ptr_;
     }
 
+    if (step.parent_node_idx & SPAN_NODE_TAG_BIT)
+    {
+        const uint32_t slot = static_cast<uint32_t>((step.parent_node_idx & SPAN_SLOT_MASK) >> SPAN_SLOT_SHIFT);
+        return &internal_node_allocator_.get_span_child_ptr(step.parent_node_idx & NODE_OFFSET_MASK, slot);
+    }
+
     std::atomic<uint64_t> &left_child_ptr_ref = internal_node_allocator_.get_left_child_ptr(step.parent_node_idx);
     if (left_child_ptr_ref.load(std::memory_order_relaxed) == step.child_ptr)
     {
@@ -192,14 +583,243 @@ std::atomic<uint64_t> *StaxTree::get_link_from_step(const TraversalStep &step)
 
 void StaxTree::insert(const TxnContext &ctx, std::string_view key, std::string_view value, bool is_delete)
 {
-    thread_local PathBuffer path;
+    EpochGuard epoch_guard(epoch_manager_, ctx.thread_id);
+    std::unique_lock<std::mutex> order_statistics_lock(order_statistics_write_mutex_, std::defer_lock);
+    const bool maintain_counts = order_statistics_enabled_.load(std::memory_order_acquire);
+    if (maintain_counts)
+        order_statistics_lock.lock();
+
+    AppendHint *hint = get_append_hint(ctx.thread_id);
+    if (!hint)
+    {
+        thread_local PathBuffer path;
+        dispatch_key_width(key.length(), [&](auto key_traits)
+                           { insert_impl<decltype(key_traits)>(ctx, key, value, is_delete, path, 0, maintain_counts); });
+        return;
+    }
+
+    const size_t reusable_steps = append_hint_steps(*hint, key, maintain_counts);
+    dispatch_key_width(key.length(), [&](auto key_traits)
+                       { insert_impl<decltype(key_traits)>(ctx, key, value, is_delete, hint->path, reusable_steps, maintain_counts); });
+    hint->last_key.assign(key);
+    if (maintain_counts)
+        hint->counted_write_sequence = ++counted_write_sequence_;
+}
+
+StaxTree::AppendHint *StaxTree::get_append_hint(size_t thread_id)
+{
+    if (thread_id >= MAX_CONCURRENT_THREADS)
+        return nullptr;
+    std::unique_ptr<AppendHint> &hint = append_hints_[thread_id];
+    if (!hint)
+        hint = std::make_unique<AppendHint>();
+    return hint.get();
+}
+
+// The hint is only trusted while its leaf is still linked where the path
+// says; observed under the caller's epoch pin, that also keeps the leaf's
+// record from being recycled while the resumed insert reads its key.
+size_t StaxTree::append_hint_steps(AppendHint &hint, std::string_view key, bool maintain_counts)
+{
+    if (hint.path.size() == 0 || key <= hint.last_key)
+        return 0;
+    if (maintain_counts && hint.counted_write_sequence != counted_write_sequence_)
+        return 0;
+    const TraversalStep &leaf_step = hint.path.back();
+    if (get_link_from_step(leaf_step)->load(std::memory_order_acquire) != leaf_step.child_ptr)
+        return 0;
+    return shared_path_steps(hint.path, hint.last_key, key);
+}
+
+// Cuts the versions of a key that no snapshot can read any more. Snapshots
+// are never below the watermark, so none reads past the newest version at or
+// under it; if that version is a tombstone, ending the chain above it reads
+// the same. Each cut link is claimed by a CAS, so of several writers pruning
+// one chain exactly one retires each detached record.
+size_t StaxTree::prune_version_chain(size_t thread_id, uint32_t head_offset, bool prune_settled_head)
+{
+    const TxnID watermark = snapshot_registry_->get_watermark();
+    RecordData version = record_allocator_.get_record_data(head_offset);
+    // A head at or under the watermark was written by a context the registry
+    // does not know about, or has settled; writers leave its chain alone.
+    const bool head_is_settled = version.txn_id <= watermark;
+    if (head_is_settled && !prune_settled_head)
+        return 0;
+
+    uint32_t parent_offset = head_offset;
+    uint32_t version_offset = record_allocator_.get_prev_version_ref(head_offset).load(std::memory_order_acquire);
+    if (head_is_settled)
+    {
+        // Every snapshot sees the head, so only the version below it, which
+        // a rewrite of the head may still copy, is kept.
+        if (version_offset == CollectionRecordAllocator::NIL_RECORD_OFFSET)
+            return 0;
+        version = record_allocator_.get_record_data(version_offset);
+    }
+    while (!head_is_settled && version_offset != CollectionRecordAllocator::NIL_RECORD_OFFSET)
+    {
+        version = record_allocator_.get_record_data(version_offset);
+        if (version.txn_id <= watermark)
+            break;
+        parent_offset = version_offset;
+        version_offset = record_allocator_.get_prev_version_ref(version_offset).load(std::memory_order_acquire);
+    }
+    if (version_offset == CollectionRecordAllocator::NIL_RECORD_OFFSET)
+        return 0;
+
+    // The link below the head is not cut from here: a transaction that
+    // rewrites the head copies it into its new version.
+    uint32_t cut_offset = (version.is_deleted && parent_offset != head_offset) ? parent_offset : version_offset;
+    uint32_t detached_offset = record_allocator_.get_prev_version_ref(cut_offset).load(std::memory_order_acquire);
+    size_t versions_cut = 0;
+    while (detached_offset != CollectionRecordAllocator::NIL_RECORD_OFFSET)
+    {
+        uint32_t expected_offset = detached_offset;
+        if (!record_allocator_.get_prev_version_ref(cut_offset).compare_exchange_strong(expected_offset, CollectionRecordAllocator::NIL_RECORD_OFFSET, std::memory_order_acq_rel, std::memory_order_relaxed))
+            return versions_cut;
+        mark_dirty(thread_id, record_allocator_.get_record_address(cut_offset), CollectionRecordAllocator::HEADER_SIZE);
+        const RecordData detached = record_allocator_.get_record_data(detached_offset);
+        epoch_manager_->retire(thread_id, record_allocator_.get_free_pool(),
+                               static_cast<uint64_t>(detached_offset) * CollectionRecordAllocator::OFFSET_GRANULARITY,
+                               CollectionRecordAllocator::get_allocated_record_size(detached.key_len, detached.value_len));
+        ++versions_cut;
+        cut_offset = detached_offset;
+        detached_offset = record_allocator_.get_prev_version_ref(cut_offset).load(std::memory_order_acquire);
+    }
+    return versions_cut;
+}
+
+size_t StaxTree::prune_version_chains(size_t thread_id, std::string &resume_key, size_t max_keys)
+{
+    if (!epoch_manager_ || !snapshot_registry_)
+    {
+        resume_key.clear();
+        return 0;
+    }
+
+    EpochGuard epoch_guard = pin_epoch(thread_id);
+    std::stack<uint64_t, std::vector<uint64_t>> path_stack;
+    seek(resume_key, path_stack);
+    size_t versions_cut = 0;
+    for (size_t visited = 0; visited < max_keys && !path_stack.empty(); ++visited)
+    {
+        versions_cut += prune_version_chain(thread_id, static_cast<uint32_t>(path_stack.top() & POINTER_INDEX_MASK), true);
+        advance_path_to_next_leaf(path_stack);
+    }
+
+    resume_key.clear();
+    if (!path_stack.empty())
+    {
+        const char *key_data;
+        uint32_t key_len;
+        uint32_t value_len;
+        record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(path_stack.top() & POINTER_INDEX_MASK), &key_data, key_len, value_len);
+        if (key_data)
+            resume_key.assign(key_data, key_len);
+    }
+    return versions_cut;
+}
+
+size_t StaxTree::prefetch_top_levels(size_t thread_id, size_t max_bytes) const
+{
+    EpochGuard epoch_guard = pin_epoch(thread_id);
+    std::vector<uint64_t> frontier;
+    const uint64_t root = root_ptr_.load(std::memory_order_acquire);
+    if (root != NIL_POINTER && !(root & POINTER_TAG_BIT))
+        frontier.push_back(root);
+
+    size_t bytes_read = 0;
+    for (size_t next = 0; next < frontier.size(); ++next)
+    {
+        const uint64_t node_ptr = frontier[next];
+        const size_t node_size = !(node_ptr & SPAN_NODE_TAG_BIT)      ? sizeof(StaxTreeNode)
+                                 : (node_ptr & SPAN_NODE_WIDE_BIT) ? sizeof(StaxSpanNode256)
+                                                                   : sizeof(StaxSpanNode16);
+        if (bytes_read + node_size > max_bytes)
+            break;
+        bytes_read += node_size;
+
+        auto enqueue_child = [&](uint64_t child_ptr)
+        {
+            if (child_ptr != NIL_POINTER && !(child_ptr & POINTER_TAG_BIT))
+                frontier.push_back(child_ptr);
+        };
+        if (node_ptr & SPAN_NODE_TAG_BIT)
+        {
+            const uint32_t fanout = span_node_fanout(node_ptr);
+            for (uint32_t slot = 0; slot < fanout; ++slot)
+                enqueue_child(internal_node_allocator_.get_span_child_ptr(node_ptr & NODE_OFFSET_MASK, slot).load(std::memory_order_acquire));
+        }
+        else
+        {
+            enqueue_child(internal_node_allocator_.get_left_child_ptr(node_ptr).load(std::memory_order_acquire));
+            enqueue_child(internal_node_allocator_.get_right_child_ptr(node_ptr).load(std::memory_order_acquire));
+        }
+    }
+    return bytes_read;
+}
+
+// Counts the leading steps of the path that led to previous_key which key
+// would also take: every node on them tests bits below the first bit where
+// the two keys differ. The last counted step is where descent can resume.
+size_t StaxTree::shared_path_steps(PathBuffer &path, std::string_view previous_key, std::string_view key) const
+{
+    if (path.size() == 0)
+        return 0;
+
+    const uint32_t critical_bit = find_critical_bit(previous_key.data(), previous_key.length(), key.data(), key.length());
+    size_t step_index = 0;
+    for (; step_index + 1 < path.size(); ++step_index)
+    {
+        const uint64_t node_ptr = path[step_index].child_ptr;
+        if (node_ptr & POINTER_TAG_BIT)
+            break;
+        if (node_bit_index(node_ptr) + node_bits_tested(node_ptr) > critical_bit)
+            break;
+    }
+    return step_index + 1;
+}
+
+// With reusable_steps > 0, descent resumes from that many leading steps of
+// path instead of from the root. Those steps may be stale: every publish is
+// a CAS on the link it replaces, and a failed CAS retries from the root. On
+// success path is left describing where the key now lives. Callers that
+// maintain counts hold order_statistics_write_mutex_.
+template <typename KeyTraits>
+void StaxTree::insert_impl(const TxnContext &ctx, std::string_view key, std::string_view value, bool is_delete, PathBuffer &path, size_t reusable_steps, bool maintain_counts)
+{
     const char *key_data = key.data();
-    const size_t key_len = key.length();
+    const size_t key_len = KeyTraits::width != 0 ? KeyTraits::width : key.length();
+    const uint64_t hash = key_hash<KeyTraits>(key_data, key_len);
+    const uint64_t fingerprint = fingerprint_from_hash(hash);
+    const int64_t new_live_count = is_delete ? 0 : 1;
+    // Counts are adjusted along the whole path, so counted inserts always
+    // descend from the root.
+    bool may_start_below_root = !maintain_counts;
 
 retry_operation:
-    path.reset();
     uint64_t current_parent_idx = PARENT_IS_ROOT;
-    uint64_t current_ptr = root_ptr_.load(std::memory_order_acquire);
+    uint64_t current_ptr = NIL_POINTER;
+    if (reusable_steps > 0)
+    {
+        const TraversalStep resume_step = path[reusable_steps - 1];
+        path.truncate(reusable_steps - 1);
+        current_parent_idx = resume_step.parent_node_idx;
+        current_ptr = resume_step.child_ptr;
+        reusable_steps = 0;
+    }
+    else
+    {
+        path.reset();
+        const uint64_t start_node = may_start_below_root ? jump_table_start(key_data, key_len) : NIL_POINTER;
+        if (start_node != NIL_POINTER)
+            current_ptr = next_child_ptr(start_node, key_data, key_len, current_parent_idx, std::memory_order_acquire);
+        if (current_ptr == NIL_POINTER)
+        {
+            current_parent_idx = PARENT_IS_ROOT;
+            current_ptr = root_ptr_.load(std::memory_order_acquire);
+        }
+    }
 
     while (current_ptr != NIL_POINTER)
     {
@@ -214,9 +834,7 @@ retry_operation:
             break;
         }
 
-        current_parent_idx = current_ptr;
-        bool bit = get_bit(key_data, key_len, internal_node_allocator_.get_bit_index(current_ptr));
-        current_ptr = bit ? internal_node_allocator_.get_right_child_ptr(current_ptr).load(std::memory_order_acquire) : internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_acquire);
+        current_ptr = next_child_ptr(current_ptr, key_data, key_len, current_parent_idx, std::memory_order_acquire);
     }
 
     if (path.size() == 0)
@@ -224,47 +842,110 @@ retry_operation:
         uint32_t new_record_rel_offset;
         void *record_block_ptr = record_allocator_.reserve_record_space(ctx.thread_id, key_len, value.length(), new_record_rel_offset);
         record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx.txn_id, CollectionRecordAllocator::NIL_RECORD_OFFSET, key_data, value.data());
-        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | POINTER_TAG_BIT;
+        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | fingerprint | POINTER_TAG_BIT;
 
         uint64_t expected_root = NIL_POINTER;
         if (root_ptr_.compare_exchange_strong(expected_root, new_tagged_ptr, std::memory_order_release, std::memory_order_relaxed))
+        {
+            if (hash_index_)
+                hash_index_insert(ctx.thread_id, hash, &root_ptr_);
+            path.push({PARENT_IS_ROOT, new_tagged_ptr});
             return;
+        }
+        record_allocator_.release_record_space(ctx.thread_id, new_record_rel_offset, key_len, value.length());
         goto retry_operation;
     }
 
+    // Only span nodes have empty slots. The new key is then compared against
+    // any key stored below the span node to decide where it belongs.
+    const bool reached_empty_slot = (current_ptr == NIL_POINTER);
     TraversalStep &leaf_step = path.back();
-    uint32_t leaf_record_offset = leaf_step.child_ptr & POINTER_INDEX_MASK;
+    uint32_t leaf_record_offset = reached_empty_slot ? static_cast<uint32_t>(leftmost_leaf(leaf_step.child_ptr) & POINTER_INDEX_MASK)
+                                                     : static_cast<uint32_t>(leaf_step.child_ptr & POINTER_INDEX_MASK);
 
     const char *existing_key_data;
     uint32_t existing_key_len;
     uint32_t existing_value_len;
     record_allocator_.get_record_key_and_lengths(leaf_record_offset, &existing_key_data, existing_key_len, existing_value_len);
 
-    if (existing_key_data && existing_key_len == key_len && simd_memcmp(existing_key_data, key_data, key_len) == 0)
+    if (!reached_empty_slot && leaf_may_match(leaf_step.child_ptr, fingerprint) &&
+        existing_key_data && keys_equal<KeyTraits>(existing_key_data, existing_key_len, key_data, key_len))
     {
+        // A version written earlier by this same transaction is invisible to
+        // every snapshot once it is superseded, so it is unlinked and retired.
+        const RecordData existing_record = record_allocator_.get_record_data(leaf_record_offset);
+        const bool supersedes_own_version = epoch_manager_ && existing_record.txn_id == ctx.txn_id;
+        const uint32_t prev_version_offset = supersedes_own_version ? existing_record.prev_version_rel_offset : leaf_record_offset;
+
         uint32_t new_record_rel_offset;
         void *record_block_ptr = record_allocator_.reserve_record_space(ctx.thread_id, key_len, value.length(), new_record_rel_offset);
-        record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx.txn_id, leaf_record_offset, key_data, value.data());
-        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | POINTER_TAG_BIT;
+        record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx.txn_id, prev_version_offset, key_data, value.data());
+        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | fingerprint | POINTER_TAG_BIT;
 
         std::atomic<uint64_t> *link_to_modify = get_link_from_step(leaf_step);
         uint64_t expected_leaf_ptr = leaf_step.child_ptr;
         if (link_to_modify->compare_exchange_strong(expected_leaf_ptr, new_tagged_ptr, std::memory_order_release, std::memory_order_relaxed))
+        {
+            mark_dirty(ctx.thread_id, link_to_modify, sizeof(uint64_t));
+            if (maintain_counts)
+                add_live_count_delta(ctx.thread_id, path, path.size() - 1, new_live_count - static_cast<int64_t>(subtree_live_count(expected_leaf_ptr)));
+            if (supersedes_own_version)
+            {
+                epoch_manager_->retire(ctx.thread_id, record_allocator_.get_free_pool(),
+                                       static_cast<uint64_t>(leaf_record_offset) * CollectionRecordAllocator::OFFSET_GRANULARITY,
+                                       CollectionRecordAllocator::get_allocated_record_size(existing_key_len, existing_value_len));
+            }
+            if (epoch_manager_ && snapshot_registry_)
+                prune_version_chain(ctx.thread_id, new_record_rel_offset);
+            leaf_step.child_ptr = new_tagged_ptr;
             return;
+        }
+        record_allocator_.release_record_space(ctx.thread_id, new_record_rel_offset, key_len, value.length());
         goto retry_operation;
     }
     else
     {
-        uint32_t critical_bit = find_critical_bit(key_data, key_len, existing_key_data, existing_key_len);
+        uint32_t critical_bit = critical_bit_against<KeyTraits>(key_data, key_len, existing_key_data, existing_key_len);
+
+        // A path that starts below the root misses the nodes testing the
+        // leading bits; a key differing there has to be placed among them.
+        if (critical_bit < JUMP_TABLE_BITS && path[0].parent_node_idx != PARENT_IS_ROOT)
+        {
+            may_start_below_root = false;
+            goto retry_operation;
+        }
+
+        if (reached_empty_slot && critical_bit >= node_bit_index(leaf_step.child_ptr))
+        {
+            uint32_t new_record_rel_offset;
+            void *record_block_ptr = record_allocator_.reserve_record_space(ctx.thread_id, key_len, value.length(), new_record_rel_offset);
+            record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx.txn_id, CollectionRecordAllocator::NIL_RECORD_OFFSET, key_data, value.data());
+            uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | fingerprint | POINTER_TAG_BIT;
+
+            std::atomic<uint64_t> *link_to_modify = get_link_from_step({current_parent_idx, NIL_POINTER});
+            uint64_t expected_slot = NIL_POINTER;
+            if (link_to_modify->compare_exchange_strong(expected_slot, new_tagged_ptr, std::memory_order_release, std::memory_order_relaxed))
+            {
+                mark_dirty(ctx.thread_id, link_to_modify, sizeof(uint64_t));
+                if (maintain_counts)
+                    add_live_count_delta(ctx.thread_id, path, path.size(), new_live_count);
+                if (hash_index_)
+                    hash_index_insert(ctx.thread_id, hash, link_to_modify);
+                path.push({current_parent_idx, new_tagged_ptr});
+                return;
+            }
+            record_allocator_.release_record_space(ctx.thread_id, new_record_rel_offset, key_len, value.length());
+            goto retry_operation;
+        }
 
-        auto it = std::lower_bound(path.begin(), path.end() - 1, critical_bit,
+        auto it = std::lower_bound(path.begin(), reached_empty_slot ? path.end() : path.end() - 1, critical_bit,
                                    [&](const TraversalStep &step, uint32_t bit)
                                    {
                                        if (step.child_ptr & POINTER_TAG_BIT)
                                        {
                                            return true;
                                        }
-                                       return internal_node_allocator_.get_bit_index(step.child_ptr) < bit;
+                                       return node_bit_index(step.child_ptr) < bit;
                                    });
 
         size_t split_step_index = std::distance(path.begin(), it);
@@ -274,7 +955,7 @@ retry_operation:
         uint32_t new_record_rel_offset;
         void *record_block_ptr = record_allocator_.reserve_record_space(ctx.thread_id, key_len, value.length(), new_record_rel_offset);
         record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx.txn_id, CollectionRecordAllocator::NIL_RECORD_OFFSET, key_data, value.data());
-        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | POINTER_TAG_BIT;
+        uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | fingerprint | POINTER_TAG_BIT;
 
         bool existing_key_bit = get_bit(existing_key_data, existing_key_len, critical_bit);
 
@@ -294,116 +975,440 @@ retry_operation:
         internal_node_allocator_.set_bit_index(new_internal_node_idx, critical_bit);
         internal_node_allocator_.get_left_child_ptr(new_internal_node_idx).store(left_child, std::memory_order_relaxed);
         internal_node_allocator_.get_right_child_ptr(new_internal_node_idx).store(right_child, std::memory_order_relaxed);
+        if (maintain_counts)
+            internal_node_allocator_.get_live_leaf_count(new_internal_node_idx).store(static_cast<uint32_t>(subtree_live_count(split_step.child_ptr) + new_live_count), std::memory_order_relaxed);
 
         std::atomic<uint64_t> *link_to_modify = get_link_from_step(split_step);
         uint64_t expected_link_value = split_step.child_ptr;
         if (link_to_modify->compare_exchange_strong(expected_link_value, new_internal_node_idx, std::memory_order_release, std::memory_order_relaxed))
+        {
+            mark_dirty(ctx.thread_id, link_to_modify, sizeof(uint64_t));
+            if (maintain_counts)
+                add_live_count_delta(ctx.thread_id, path, split_step_index, new_live_count);
+            if (hash_index_)
+            {
+                hash_index_insert(ctx.thread_id, hash, existing_key_bit ? &internal_node_allocator_.get_left_child_ptr(new_internal_node_idx)
+                                                         : &internal_node_allocator_.get_right_child_ptr(new_internal_node_idx));
+            }
+            if (critical_bit < JUMP_TABLE_BITS)
+                jump_table_generation_.fetch_add(1, std::memory_order_release);
+            const uint64_t split_parent_idx = split_step.parent_node_idx;
+            path.truncate(split_step_index);
+            path.push({split_parent_idx, new_internal_node_idx});
+            path.push({new_internal_node_idx, new_tagged_ptr});
             return;
+        }
 
-        internal_node_allocator_.deallocate(new_internal_node_idx);
+        internal_node_allocator_.deallocate(ctx.thread_id, new_internal_node_idx);
+        record_allocator_.release_record_space(ctx.thread_id, new_record_rel_offset, key_len, value.length());
         goto retry_operation;
     }
 }
 
 
-void StaxTree::insert_batch(const TxnContext &ctx, const CoreKVPair *kv_pairs, size_t num_kvs, TransactionBatch &batch)
-{
-    if (num_kvs == 0)
-        return;
-
-    for (size_t i = 0; i < num_kvs; ++i)
-    {
-        insert(ctx, kv_pairs[i].key, kv_pairs[i].value, false);
-        batch.logical_item_count_delta++;
-        batch.live_record_bytes_delta += (kv_pairs[i].key.length() + kv_pairs[i].value.length() + CollectionRecordAllocator::HEADER_SIZE);
-    }
-}
+StaxTree::BulkLoader::BulkLoader(StaxTree &tree, const TxnContext &ctx)
+    : tree_(tree),
+      ctx_(ctx),
+      maintain_counts_(tree.has_order_statistics()),
+      pending_leaf_ptr_(NIL_POINTER),
+      last_key_data_(nullptr),
+      last_key_len_(0),
+      appended_count_(0) {}
 
-std::optional<RecordData> StaxTree::get(const TxnContext &ctx, std::string_view key) const
+void StaxTree::BulkLoader::append(std::string_view key, std::string_view value, bool is_delete)
 {
-    uint64_t current_ptr = root_ptr_.load(std::memory_order_relaxed);
     const char *key_data = key.data();
     const size_t key_len = key.length();
+    const uint64_t fingerprint = tree_.key_fingerprint(key_data, key_len);
+    uint32_t prev_version_offset = CollectionRecordAllocator::NIL_RECORD_OFFSET;
+    uint32_t critical_bit = (std::numeric_limits<uint32_t>::max)();
 
-    for (int i = 0; i < 256; ++i)
+    if (pending_leaf_ptr_ != NIL_POINTER)
     {
-        if ((current_ptr & POINTER_TAG_BIT) || current_ptr == NIL_POINTER)
+        critical_bit = tree_.find_critical_bit(last_key_data_, last_key_len_, key_data, key_len);
+        if (critical_bit == (std::numeric_limits<uint32_t>::max)())
         {
-            break;
+            prev_version_offset = static_cast<uint32_t>(pending_leaf_ptr_ & POINTER_INDEX_MASK);
         }
-
-        uint32_t bit_index0 = internal_node_allocator_.get_bit_index(current_ptr);
-        bool bit0 = get_bit(key_data, key_len, bit_index0);
-        uint64_t next_ptr0 = bit0 ? internal_node_allocator_.get_right_child_ptr(current_ptr).load(std::memory_order_relaxed)
-                                  : internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_relaxed);
-
-        if ((next_ptr0 & POINTER_TAG_BIT) || next_ptr0 == NIL_POINTER)
+        else if (!tree_.get_bit(key_data, key_len, critical_bit))
         {
-            current_ptr = next_ptr0;
-            break;
+            throw std::invalid_argument("StaxTree::BulkLoader: keys must be appended in ascending order.");
         }
+    }
 
-#if defined(__x86_64__) || defined(__i386__)
-        _mm_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr0), _MM_HINT_T0);
-#elif defined(__aarch64__)
-        __builtin_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr0), 0, 0);
-#endif
-
-        uint32_t bit_index1 = internal_node_allocator_.get_bit_index(next_ptr0);
-        bool bit1 = get_bit(key_data, key_len, bit_index1);
-        uint64_t next_ptr1 = bit1 ? internal_node_allocator_.get_right_child_ptr(next_ptr0).load(std::memory_order_relaxed)
-                                  : internal_node_allocator_.get_left_child_ptr(next_ptr0).load(std::memory_order_relaxed);
+    uint32_t new_record_rel_offset;
+    void *record_block_ptr = tree_.record_allocator_.reserve_record_space(ctx_.thread_id, key_len, value.length(), new_record_rel_offset);
+    tree_.record_allocator_.finalize_record_header_and_data(record_block_ptr, key_len, value.length(), is_delete, ctx_.txn_id, prev_version_offset, key_data, value.data());
+    uint64_t new_tagged_ptr = static_cast<uint64_t>(new_record_rel_offset) | fingerprint | POINTER_TAG_BIT;
 
-        if ((next_ptr1 & POINTER_TAG_BIT) || next_ptr1 == NIL_POINTER)
-        {
-            current_ptr = next_ptr1;
-            break;
-        }
+    uint32_t stored_value_len;
+    tree_.record_allocator_.get_record_key_and_lengths(new_record_rel_offset, &last_key_data_, last_key_len_, stored_value_len);
+    appended_count_++;
 
-#if defined(__x86_64__) || defined(__i386__)
-        _mm_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr1), _MM_HINT_T0);
-#elif defined(__aarch64__)
-        __builtin_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr1), 0, 0);
-#endif
+    if (pending_leaf_ptr_ == NIL_POINTER || prev_version_offset != CollectionRecordAllocator::NIL_RECORD_OFFSET)
+    {
+        pending_leaf_ptr_ = new_tagged_ptr;
+        return;
+    }
+    link_leaf(new_tagged_ptr, critical_bit);
+}
 
-        uint32_t bit_index2 = internal_node_allocator_.get_bit_index(next_ptr1);
-        bool bit2 = get_bit(key_data, key_len, bit_index2);
-        uint64_t next_ptr2 = bit2 ? internal_node_allocator_.get_right_child_ptr(next_ptr1).load(std::memory_order_relaxed)
-                                  : internal_node_allocator_.get_left_child_ptr(next_ptr1).load(std::memory_order_relaxed);
+void StaxTree::BulkLoader::append_record(uint32_t record_rel_offset)
+{
+    const char *key_data;
+    uint32_t key_len;
+    uint32_t value_len;
+    tree_.record_allocator_.get_record_key_and_lengths(record_rel_offset, &key_data, key_len, value_len);
+    const uint64_t new_tagged_ptr = static_cast<uint64_t>(record_rel_offset) | tree_.key_fingerprint(key_data, key_len) | POINTER_TAG_BIT;
+
+    uint32_t critical_bit = (std::numeric_limits<uint32_t>::max)();
+    if (pending_leaf_ptr_ != NIL_POINTER)
+    {
+        critical_bit = tree_.find_critical_bit(last_key_data_, last_key_len_, key_data, key_len);
+        if (critical_bit == (std::numeric_limits<uint32_t>::max)() || !tree_.get_bit(key_data, key_len, critical_bit))
+        {
+            throw std::invalid_argument("StaxTree::BulkLoader: appended records must have distinct keys in ascending order.");
+        }
+    }
+    last_key_data_ = key_data;
+    last_key_len_ = key_len;
+    appended_count_++;
 
-        if ((next_ptr2 & POINTER_TAG_BIT) || next_ptr2 == NIL_POINTER)
+    if (pending_leaf_ptr_ == NIL_POINTER)
+    {
+        pending_leaf_ptr_ = new_tagged_ptr;
+        return;
+    }
+    link_leaf(new_tagged_ptr, critical_bit);
+}
+
+void StaxTree::BulkLoader::link_leaf(uint64_t leaf_ptr, uint32_t critical_bit)
+{
+    // Nodes deeper than the new critical bit are complete: the rightmost leaf
+    // closes them and the resulting subtree becomes the new node's left child.
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    uint64_t completed_subtree = pending_leaf_ptr_;
+    while (!right_spine_.empty() && nodes.get_bit_index(right_spine_.back()) > critical_bit)
+    {
+        uint64_t node_idx = right_spine_.back();
+        right_spine_.pop_back();
+        nodes.get_right_child_ptr(node_idx).store(complete_subtree(completed_subtree, nodes.get_bit_index(node_idx)), std::memory_order_relaxed);
+        set_completed_count(node_idx);
+        completed_subtree = node_idx;
+    }
+
+    uint64_t new_internal_node_idx = allocate_binary_node();
+    nodes.set_bit_index(new_internal_node_idx, critical_bit);
+    nodes.get_left_child_ptr(new_internal_node_idx).store(complete_subtree(completed_subtree, critical_bit), std::memory_order_relaxed);
+    nodes.get_right_child_ptr(new_internal_node_idx).store(NIL_POINTER, std::memory_order_relaxed);
+    right_spine_.push_back(new_internal_node_idx);
+    pending_leaf_ptr_ = leaf_ptr;
+}
+
+bool StaxTree::BulkLoader::publish()
+{
+    if (pending_leaf_ptr_ == NIL_POINTER)
+        return true;
+
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    uint64_t completed_subtree = pending_leaf_ptr_;
+    while (!right_spine_.empty())
+    {
+        uint64_t node_idx = right_spine_.back();
+        right_spine_.pop_back();
+        nodes.get_right_child_ptr(node_idx).store(complete_subtree(completed_subtree, nodes.get_bit_index(node_idx)), std::memory_order_relaxed);
+        set_completed_count(node_idx);
+        completed_subtree = node_idx;
+    }
+    completed_subtree = complete_subtree(completed_subtree, (std::numeric_limits<uint32_t>::max)());
+    pending_leaf_ptr_ = NIL_POINTER;
+    last_key_data_ = nullptr;
+    last_key_len_ = 0;
+
+    for (uint64_t node_idx : recycled_nodes_)
+        nodes.deallocate(ctx_.thread_id, node_idx);
+    recycled_nodes_.clear();
+
+    uint64_t expected_root = NIL_POINTER;
+    if (!tree_.root_ptr_.compare_exchange_strong(expected_root, completed_subtree, std::memory_order_release, std::memory_order_relaxed))
+    {
+        release_subtree(completed_subtree);
+        return false;
+    }
+    tree_.jump_table_generation_.fetch_add(1, std::memory_order_release);
+    if (tree_.hash_index_)
+        tree_.hash_index_subtree(ctx_.thread_id, &tree_.root_ptr_);
+    return true;
+}
+
+// Hands back the nodes and records of a subtree that was never published.
+void StaxTree::BulkLoader::release_subtree(uint64_t subtree_ptr)
+{
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    std::vector<uint64_t> pending{subtree_ptr};
+    while (!pending.empty())
+    {
+        const uint64_t current_ptr = pending.back();
+        pending.pop_back();
+        if (current_ptr == NIL_POINTER)
+            continue;
+        if (current_ptr & POINTER_TAG_BIT)
         {
-            current_ptr = next_ptr2;
-            break;
+            const uint32_t record_offset = static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK);
+            const char *key_data;
+            uint32_t key_len;
+            uint32_t value_len;
+            tree_.record_allocator_.get_record_key_and_lengths(record_offset, &key_data, key_len, value_len);
+            tree_.record_allocator_.release_record_space(ctx_.thread_id, record_offset, key_len, value_len);
+        }
+        else if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            const uint64_t node_offset = current_ptr & NODE_OFFSET_MASK;
+            for (uint32_t slot = 0; slot < span_node_fanout(current_ptr); ++slot)
+                pending.push_back(nodes.get_span_child_ptr(node_offset, slot).load(std::memory_order_relaxed));
+            nodes.deallocate_span_node(ctx_.thread_id, node_offset, (current_ptr & SPAN_NODE_WIDE_BIT) != 0);
+        }
+        else
+        {
+            pending.push_back(nodes.get_left_child_ptr(current_ptr).load(std::memory_order_relaxed));
+            pending.push_back(nodes.get_right_child_ptr(current_ptr).load(std::memory_order_relaxed));
+            nodes.deallocate(ctx_.thread_id, current_ptr);
         }
+    }
+}
 
-#if defined(__x86_64__) || defined(__i386__)
-        _mm_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr2), _MM_HINT_T0);
-#elif defined(__aarch64__)
-        __builtin_prefetch(internal_node_allocator_.get_bit_index_ptr(next_ptr2), 0, 0);
-#endif
+void StaxTree::BulkLoader::set_completed_count(uint64_t node_idx)
+{
+    if (!maintain_counts_)
+        return;
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    const uint64_t live_count = tree_.subtree_live_count(nodes.get_left_child_ptr(node_idx).load(std::memory_order_relaxed)) +
+                                tree_.subtree_live_count(nodes.get_right_child_ptr(node_idx).load(std::memory_order_relaxed));
+    nodes.get_live_leaf_count(node_idx).store(static_cast<uint32_t>(live_count), std::memory_order_relaxed);
+}
 
-        uint32_t bit_index3 = internal_node_allocator_.get_bit_index(next_ptr2);
-        bool bit3 = get_bit(key_data, key_len, bit_index3);
-        current_ptr = bit3 ? internal_node_allocator_.get_right_child_ptr(next_ptr2).load(std::memory_order_relaxed)
-                           : internal_node_allocator_.get_left_child_ptr(next_ptr2).load(std::memory_order_relaxed);
+uint64_t StaxTree::BulkLoader::allocate_binary_node()
+{
+    if (!recycled_nodes_.empty())
+    {
+        uint64_t node_idx = recycled_nodes_.back();
+        recycled_nodes_.pop_back();
+        return node_idx;
     }
+    return tree_.internal_node_allocator_.allocate(ctx_.thread_id);
+}
 
-    if (current_ptr == NIL_POINTER)
-        return std::nullopt;
+// A finished subtree is packed once it is known to be the topmost node of its
+// key byte. Deeper bytes were packed when their own subtrees completed.
+uint64_t StaxTree::BulkLoader::complete_subtree(uint64_t subtree_ptr, uint32_t parent_bit_index)
+{
+    if (subtree_ptr & (POINTER_TAG_BIT | SPAN_NODE_TAG_BIT))
+        return subtree_ptr;
+    if ((tree_.internal_node_allocator_.get_bit_index(subtree_ptr) / 8) == (parent_bit_index / 8))
+        return subtree_ptr;
+    return collapse_byte_region(subtree_ptr);
+}
 
-    uint32_t record_rel_offset = current_ptr & POINTER_INDEX_MASK;
+uint64_t StaxTree::BulkLoader::collapse_byte_region(uint64_t subtree_ptr)
+{
+    const uint32_t start_bit = tree_.internal_node_allocator_.get_bit_index(subtree_ptr) & ~7u;
+    span_frontier_.clear();
+    span_interior_.clear();
+    collect_span_frontier(subtree_ptr, start_bit + 8);
+    if (span_frontier_.size() >= SPAN_NODE256_MIN_FANOUT)
+        return build_span_node(start_bit, true);
+    return collapse_nibble_region(subtree_ptr);
+}
 
-    const char *head_key_ptr;
-    uint32_t head_key_len;
-    uint32_t head_value_len;
-    record_allocator_.get_record_key_and_lengths(record_rel_offset, &head_key_ptr, head_key_len, head_value_len);
+uint64_t StaxTree::BulkLoader::collapse_nibble_region(uint64_t subtree_ptr)
+{
+    const uint32_t start_bit = tree_.internal_node_allocator_.get_bit_index(subtree_ptr) & ~3u;
+    if (start_bit % 8 == 0)
+        collapse_low_nibble_regions(subtree_ptr, start_bit + 4);
+
+    span_frontier_.clear();
+    span_interior_.clear();
+    collect_span_frontier(subtree_ptr, start_bit + 4);
+    if (span_frontier_.size() >= SPAN_NODE16_MIN_FANOUT)
+        return build_span_node(start_bit, false);
+    return subtree_ptr;
+}
 
-    if (head_key_ptr == nullptr || head_key_len != key_len || simd_memcmp(head_key_ptr, key_data, key_len) != 0)
+void StaxTree::BulkLoader::collapse_low_nibble_regions(uint64_t node_ptr, uint32_t limit_bit)
+{
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    for (std::atomic<uint64_t> *link : {&nodes.get_left_child_ptr(node_ptr), &nodes.get_right_child_ptr(node_ptr)})
     {
-        return std::nullopt;
+        uint64_t child_ptr = link->load(std::memory_order_relaxed);
+        if (child_ptr & (POINTER_TAG_BIT | SPAN_NODE_TAG_BIT))
+            continue;
+
+        uint32_t child_bit_index = nodes.get_bit_index(child_ptr);
+        if (child_bit_index < limit_bit)
+            collapse_low_nibble_regions(child_ptr, limit_bit);
+        else if (child_bit_index < limit_bit + 4)
+            link->store(collapse_nibble_region(child_ptr), std::memory_order_relaxed);
+    }
+}
+
+void StaxTree::BulkLoader::collect_span_frontier(uint64_t node_ptr, uint32_t limit_bit)
+{
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    if (!(node_ptr & (POINTER_TAG_BIT | SPAN_NODE_TAG_BIT)) && nodes.get_bit_index(node_ptr) < limit_bit)
+    {
+        span_interior_.push_back(node_ptr);
+        collect_span_frontier(nodes.get_left_child_ptr(node_ptr).load(std::memory_order_relaxed), limit_bit);
+        collect_span_frontier(nodes.get_right_child_ptr(node_ptr).load(std::memory_order_relaxed), limit_bit);
+        return;
+    }
+    span_frontier_.push_back(node_ptr);
+}
+
+// Every key below a frontier entry agrees on the bits of the span, so the
+// entry's leftmost key tells which slot it occupies.
+uint64_t StaxTree::BulkLoader::build_span_node(uint32_t start_bit, bool wide)
+{
+    NodeAllocator<StaxTreeNode> &nodes = tree_.internal_node_allocator_;
+    const uint64_t span_node_idx = nodes.allocate_span_node(ctx_.thread_id, wide, start_bit);
+    uint64_t live_count = 0;
+    for (uint64_t child_ptr : span_frontier_)
+    {
+        if (maintain_counts_)
+            live_count += tree_.subtree_live_count(child_ptr);
+        const char *reference_key_data;
+        uint32_t reference_key_len;
+        uint32_t reference_value_len;
+        const uint64_t reference_leaf = tree_.leftmost_leaf(child_ptr);
+        tree_.record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(reference_leaf & POINTER_INDEX_MASK), &reference_key_data, reference_key_len, reference_value_len);
+        const uint32_t slot = tree_.span_slot(reference_key_data, reference_key_len, start_bit, wide);
+        nodes.get_span_child_ptr(span_node_idx, slot).store(child_ptr, std::memory_order_relaxed);
     }
+    nodes.get_live_leaf_count(span_node_idx).store(static_cast<uint32_t>(live_count), std::memory_order_relaxed);
+    recycled_nodes_.insert(recycled_nodes_.end(), span_interior_.begin(), span_interior_.end());
 
+    return span_node_idx | SPAN_NODE_TAG_BIT | (wide ? SPAN_NODE_WIDE_BIT : 0);
+}
+
+bool StaxTree::bulk_load(const TxnContext &ctx, const CoreKVPair *kv_pairs, size_t num_kvs, TransactionBatch &batch)
+{
+    if (num_kvs == 0 || root_ptr_.load(std::memory_order_acquire) != NIL_POINTER)
+        return false;
+
+    for (size_t i = 1; i < num_kvs; ++i)
+    {
+        if (kv_pairs[i].key < kv_pairs[i - 1].key)
+            return false;
+    }
+
+    BulkLoader loader(*this, ctx);
+    int64_t live_bytes = 0;
+    for (size_t i = 0; i < num_kvs; ++i)
+    {
+        loader.append(kv_pairs[i].key, kv_pairs[i].value);
+        live_bytes += (kv_pairs[i].key.length() + kv_pairs[i].value.length() + CollectionRecordAllocator::HEADER_SIZE);
+    }
+    if (!loader.publish())
+        return false;
+
+    batch.logical_item_count_delta += static_cast<int64_t>(num_kvs);
+    batch.live_record_bytes_delta += live_bytes;
+    return true;
+}
+
+void StaxTree::insert_batch(const TxnContext &ctx, const CoreKVPair *kv_pairs, size_t num_kvs, TransactionBatch &batch)
+{
+    if (num_kvs == 0)
+        return;
+
+    // Sorted input lets consecutive inserts share most of their descent. The
+    // sort is stable so a repeated key still ends with its last value.
+    thread_local std::vector<CoreKVPair> sorted_pairs;
+    const bool already_sorted = std::is_sorted(kv_pairs, kv_pairs + num_kvs, [](const CoreKVPair &a, const CoreKVPair &b)
+                                               { return a.key < b.key; });
+    if (!already_sorted)
+    {
+        sorted_pairs.assign(kv_pairs, kv_pairs + num_kvs);
+        std::stable_sort(sorted_pairs.begin(), sorted_pairs.end(), [](const CoreKVPair &a, const CoreKVPair &b)
+                         { return a.key < b.key; });
+        kv_pairs = sorted_pairs.data();
+    }
+
+    if (bulk_load(ctx, kv_pairs, num_kvs, batch))
+        return;
+
+    // Counted batches hold the write mutex throughout, so nobody else can
+    // change the nodes on the reused path between two of its inserts.
+    EpochGuard epoch_guard(epoch_manager_, ctx.thread_id);
+    std::unique_lock<std::mutex> order_statistics_lock(order_statistics_write_mutex_, std::defer_lock);
+    const bool maintain_counts = order_statistics_enabled_.load(std::memory_order_acquire);
+    if (maintain_counts)
+        order_statistics_lock.lock();
+
+    thread_local PathBuffer fallback_path;
+    AppendHint *hint = get_append_hint(ctx.thread_id);
+    PathBuffer &path = hint ? hint->path : fallback_path;
+    size_t reusable_steps = hint ? append_hint_steps(*hint, kv_pairs[0].key, maintain_counts) : 0;
+    for (size_t i = 0; i < num_kvs; ++i)
+    {
+        const std::string_view key = kv_pairs[i].key;
+        if (i > 0)
+            reusable_steps = shared_path_steps(path, kv_pairs[i - 1].key, key);
+        dispatch_key_width(key.length(), [&](auto key_traits)
+                           { insert_impl<decltype(key_traits)>(ctx, key, kv_pairs[i].value, false, path, reusable_steps, maintain_counts); });
+        batch.logical_item_count_delta++;
+        batch.live_record_bytes_delta += (key.length() + kv_pairs[i].value.length() + CollectionRecordAllocator::HEADER_SIZE);
+    }
+    if (hint)
+    {
+        hint->last_key.assign(kv_pairs[num_kvs - 1].key);
+        if (maintain_counts)
+            hint->counted_write_sequence = ++counted_write_sequence_;
+    }
+}
+
+std::optional<RecordData> StaxTree::get(const TxnContext &ctx, std::string_view key, bool keeps_tombstones) const
+{
+    EpochGuard epoch_guard(epoch_manager_, ctx.thread_id);
+    return dispatch_key_width(key.length(), [&](auto key_traits)
+                              { return get_impl<decltype(key_traits)>(ctx, key, keeps_tombstones); });
+}
+
+template <typename KeyTraits>
+std::optional<RecordData> StaxTree::get_impl(const TxnContext &ctx, std::string_view key, bool keeps_tombstones) const
+{
+    const char *key_data = key.data();
+    const size_t key_len = KeyTraits::width != 0 ? KeyTraits::width : key.length();
+    const uint64_t hash = key_hash<KeyTraits>(key_data, key_len);
+
+    uint64_t current_ptr = hash_index_ ? hash_index_lookup<KeyTraits>(key_data, key_len, hash) : NIL_POINTER;
+    if (current_ptr == NIL_POINTER)
+    {
+        current_ptr = jump_table_start(key_data, key_len);
+        if (current_ptr == NIL_POINTER)
+            current_ptr = root_ptr_.load(std::memory_order_relaxed);
+        uint64_t parent_ref;
+        while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+        {
+            current_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_relaxed);
+            if (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+                prefetch_node(current_ptr);
+        }
+
+        if (current_ptr == NIL_POINTER || !leaf_may_match(current_ptr, fingerprint_from_hash(hash)))
+            return std::nullopt;
+
+        const char *head_key_ptr;
+        uint32_t head_key_len;
+        uint32_t head_value_len;
+        record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK), &head_key_ptr, head_key_len, head_value_len);
+
+        if (head_key_ptr == nullptr || !keys_equal<KeyTraits>(head_key_ptr, head_key_len, key_data, key_len))
+        {
+            return std::nullopt;
+        }
+    }
+
+    uint32_t record_rel_offset = current_ptr & POINTER_INDEX_MASK;
     uint32_t current_version_offset = record_rel_offset;
 
     if (current_version_offset != CollectionRecordAllocator::NIL_RECORD_OFFSET)
@@ -433,7 +1438,7 @@ std::optional<RecordData> StaxTree::get(const TxnContext &ctx, std::string_view
 
         if (record.txn_id <= ctx.read_snapshot_id)
         {
-            if (record.is_deleted)
+            if (record.is_deleted && !keeps_tombstones)
                 return std::nullopt;
             return record;
         }
@@ -445,25 +1450,104 @@ std::optional<RecordData> StaxTree::get(const TxnContext &ctx, std::string_view
 
 void StaxTree::multi_get_simd(const TxnContext &ctx, const std::vector<std::string_view> &keys, std::vector<std::optional<RecordData>> &results) const
 {
-    size_t n = keys.size();
+    EpochGuard epoch_guard(epoch_manager_, ctx.thread_id);
+    const size_t n = keys.size();
     results.resize(n);
-    size_t i = 0;
 
-#if defined(__AVX2__)
-    const size_t simd_width = 8;
-    if (n >= simd_width)
-    {
-    }
-#elif defined(__aarch64__)
-    const size_t simd_width = 4;
-    if (n >= simd_width)
-    {
-    }
-#endif
+    uint64_t lane_ptr[MULTI_GET_GROUP_SIZE];
+    uint32_t lane_version[MULTI_GET_GROUP_SIZE];
+    uint8_t active_lanes[MULTI_GET_GROUP_SIZE];
 
-    for (; i < n; ++i)
+    for (size_t group_start = 0; group_start < n; group_start += MULTI_GET_GROUP_SIZE)
     {
-        results[i] = get(ctx, keys[i]);
+        const size_t group_size = (std::min)(MULTI_GET_GROUP_SIZE, n - group_start);
+        const std::string_view *group_keys = keys.data() + group_start;
+        std::optional<RecordData> *group_results = results.data() + group_start;
+
+        const uint64_t root = root_ptr_.load(std::memory_order_relaxed);
+        size_t num_active = 0;
+        for (size_t lane = 0; lane < group_size; ++lane)
+        {
+            group_results[lane].reset();
+            const uint64_t start_node = jump_table_start(group_keys[lane].data(), group_keys[lane].length());
+            lane_ptr[lane] = start_node != NIL_POINTER ? start_node : root;
+            if (lane_ptr[lane] != NIL_POINTER && !(lane_ptr[lane] & POINTER_TAG_BIT))
+                active_lanes[num_active++] = static_cast<uint8_t>(lane);
+        }
+
+        // Every lane descends one level per round. The child of each lane is prefetched before any
+        // lane dereferences it in the next round, so the misses of the whole group overlap.
+        while (num_active > 0)
+        {
+            size_t still_active = 0;
+            for (size_t k = 0; k < num_active; ++k)
+            {
+                const uint8_t lane = active_lanes[k];
+                uint64_t parent_ref;
+                uint64_t next_ptr = next_child_ptr(lane_ptr[lane], group_keys[lane].data(), group_keys[lane].length(), parent_ref, std::memory_order_relaxed);
+                lane_ptr[lane] = next_ptr;
+
+                if (next_ptr == NIL_POINTER)
+                    continue;
+                if (next_ptr & POINTER_TAG_BIT)
+                {
+                    if (!leaf_may_match(next_ptr, key_fingerprint(group_keys[lane].data(), group_keys[lane].length())))
+                    {
+                        lane_ptr[lane] = NIL_POINTER;
+                        continue;
+                    }
+                    prefetch_for_read(record_allocator_.get_record_address(static_cast<uint32_t>(next_ptr & POINTER_INDEX_MASK)));
+                    continue;
+                }
+                prefetch_node(next_ptr);
+                active_lanes[still_active++] = lane;
+            }
+            num_active = still_active;
+        }
+
+        for (size_t lane = 0; lane < group_size; ++lane)
+        {
+            if (lane_ptr[lane] == NIL_POINTER)
+                continue;
+
+            const uint32_t record_rel_offset = static_cast<uint32_t>(lane_ptr[lane] & POINTER_INDEX_MASK);
+            const char *head_key_ptr;
+            uint32_t head_key_len;
+            uint32_t head_value_len;
+            record_allocator_.get_record_key_and_lengths(record_rel_offset, &head_key_ptr, head_key_len, head_value_len);
+
+            const std::string_view key = group_keys[lane];
+            if (head_key_ptr == nullptr || head_key_len != key.length() || simd_memcmp(head_key_ptr, key.data(), key.length()) != 0)
+                continue;
+
+            lane_version[lane] = record_rel_offset;
+            active_lanes[num_active++] = static_cast<uint8_t>(lane);
+        }
+
+        // The version chains are walked the same way: one hop per lane per round.
+        while (num_active > 0)
+        {
+            size_t still_active = 0;
+            for (size_t k = 0; k < num_active; ++k)
+            {
+                const uint8_t lane = active_lanes[k];
+                RecordData record = record_allocator_.get_record_data(lane_version[lane]);
+
+                if (record.txn_id <= ctx.read_snapshot_id)
+                {
+                    if (!record.is_deleted)
+                        group_results[lane] = record;
+                    continue;
+                }
+                if (record.prev_version_rel_offset == CollectionRecordAllocator::NIL_RECORD_OFFSET)
+                    continue;
+
+                lane_version[lane] = record.prev_version_rel_offset;
+                prefetch_for_read(record_allocator_.get_record_address(record.prev_version_rel_offset));
+                active_lanes[still_active++] = lane;
+            }
+            num_active = still_active;
+        }
     }
 }
 
@@ -474,24 +1558,350 @@ void StaxTree::remove(const TxnContext &ctx, std::string_view key)
 
 void StaxTree::seek(std::string_view start_key, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
 {
-    uint64_t current_ptr = root_ptr_.load(std::memory_order_relaxed);
-    if (current_ptr == NIL_POINTER)
+    const uint64_t root = root_ptr_.load(std::memory_order_acquire);
+    if (root == NIL_POINTER)
         return;
     const char *key_data = start_key.data();
     const size_t key_len = start_key.length();
 
+    // The leaf reached by following the key's bits shares the longest prefix
+    // with it; their critical bit says where the successor path leaves the
+    // key's own path.
+    uint64_t current_ptr = jump_table_start(key_data, key_len);
+    if (current_ptr == NIL_POINTER)
+        current_ptr = root;
+    uint64_t parent_ref;
+    while (!(current_ptr & POINTER_TAG_BIT))
+    {
+        uint64_t next_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+        if (next_ptr == NIL_POINTER)
+        {
+            current_ptr = leftmost_leaf(current_ptr);
+            break;
+        }
+        current_ptr = next_ptr;
+    }
+
+    const char *closest_key_data;
+    uint32_t closest_key_len, closest_value_len;
+    record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK), &closest_key_data, closest_key_len, closest_value_len);
+    const uint32_t critical_bit = find_critical_bit(key_data, key_len, closest_key_data, closest_key_len);
+    const bool key_follows_critical = (critical_bit != (std::numeric_limits<uint32_t>::max)()) && get_bit(key_data, key_len, critical_bit);
+
+    current_ptr = root;
+    while (!(current_ptr & POINTER_TAG_BIT) && node_bit_index(current_ptr) <= critical_bit)
+    {
+        uint64_t next_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+        if (next_ptr == NIL_POINTER)
+        {
+            // The key differs inside this span node and its own slot is empty:
+            // the successor is in the next occupied slot, or after the node.
+            const uint32_t key_slot = static_cast<uint32_t>((parent_ref & SPAN_SLOT_MASK) >> SPAN_SLOT_SHIFT);
+            next_ptr = next_occupied_span_slot(current_ptr, key_slot + 1, parent_ref);
+            path_stack.push(parent_ref);
+            if (next_ptr == NIL_POINTER)
+                advance_path_to_next_leaf(path_stack);
+            else
+                push_leftmost_path(next_ptr, path_stack);
+            return;
+        }
+        path_stack.push(parent_ref);
+        current_ptr = next_ptr;
+    }
+
+    // Every key below current_ptr is on the same side of the critical bit.
+    if (key_follows_critical)
+    {
+        path_stack.push(current_ptr);
+        advance_path_to_next_leaf(path_stack);
+        return;
+    }
+    push_leftmost_path(current_ptr, path_stack);
+}
+
+void StaxTree::push_leftmost_path(uint64_t subtree_ptr, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    uint64_t current_ptr = subtree_ptr;
     while (current_ptr != NIL_POINTER)
     {
+        if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            uint64_t parent_ref;
+            uint64_t child_ptr = next_occupied_span_slot(current_ptr, 0, parent_ref);
+            path_stack.push(parent_ref);
+            current_ptr = child_ptr;
+            continue;
+        }
         path_stack.push(current_ptr);
         if (current_ptr & POINTER_TAG_BIT)
             break;
+        current_ptr = internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_acquire);
+    }
+}
+
+// The top of the stack is the subtree just visited (a leaf, or a node whose
+// keys are all known to be too small); binary parents are recorded by
+// offset, span parents with the slot that was followed.
+void StaxTree::advance_path_to_next_leaf(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    if (path_stack.empty())
+        return;
+    uint64_t visited_ptr = path_stack.top();
+    if (visited_ptr & SPAN_NODE_TAG_BIT)
+        visited_ptr &= ~SPAN_SLOT_MASK;
+    path_stack.pop();
 
-        uint32_t bit_index = internal_node_allocator_.get_bit_index(current_ptr);
-        bool bit = get_bit(key_data, key_len, bit_index);
-        uint64_t next_ptr = bit ? internal_node_allocator_.get_right_child_ptr(current_ptr).load(std::memory_order_relaxed) : internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_relaxed);
+    while (!path_stack.empty())
+    {
+        uint64_t parent_pointer = path_stack.top();
 
+        if (parent_pointer & SPAN_NODE_TAG_BIT)
+        {
+            uint32_t next_slot = static_cast<uint32_t>((parent_pointer & SPAN_SLOT_MASK) >> SPAN_SLOT_SHIFT) + 1;
+            uint64_t parent_ref;
+            uint64_t next_subtree_root = next_occupied_span_slot(parent_pointer & ~SPAN_SLOT_MASK, next_slot, parent_ref);
+            if (next_subtree_root != NIL_POINTER)
+            {
+                path_stack.top() = parent_ref;
+                push_leftmost_path(next_subtree_root, path_stack);
+                return;
+            }
+        }
+        else if (internal_node_allocator_.get_left_child_ptr(parent_pointer).load(std::memory_order_acquire) == visited_ptr)
+        {
+            push_leftmost_path(internal_node_allocator_.get_right_child_ptr(parent_pointer).load(std::memory_order_acquire), path_stack);
+            return;
+        }
+        visited_ptr = (parent_pointer & SPAN_NODE_TAG_BIT) ? (parent_pointer & ~SPAN_SLOT_MASK) : parent_pointer;
+        path_stack.pop();
+    }
+}
+
+void StaxTree::seek_for_prev(std::string_view key, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    const uint64_t root = root_ptr_.load(std::memory_order_acquire);
+    if (root == NIL_POINTER)
+        return;
+    const char *key_data = key.data();
+    const size_t key_len = key.length();
+
+    uint64_t current_ptr = jump_table_start(key_data, key_len);
+    if (current_ptr == NIL_POINTER)
+        current_ptr = root;
+    uint64_t parent_ref;
+    while (!(current_ptr & POINTER_TAG_BIT))
+    {
+        uint64_t next_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+        if (next_ptr == NIL_POINTER)
+        {
+            current_ptr = leftmost_leaf(current_ptr);
+            break;
+        }
+        current_ptr = next_ptr;
+    }
+
+    const char *closest_key_data;
+    uint32_t closest_key_len, closest_value_len;
+    record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK), &closest_key_data, closest_key_len, closest_value_len);
+    const uint32_t critical_bit = find_critical_bit(key_data, key_len, closest_key_data, closest_key_len);
+    const bool key_follows_critical = (critical_bit != (std::numeric_limits<uint32_t>::max)()) && get_bit(key_data, key_len, critical_bit);
+
+    current_ptr = root;
+    while (!(current_ptr & POINTER_TAG_BIT) && node_bit_index(current_ptr) <= critical_bit)
+    {
+        uint64_t next_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+        if (next_ptr == NIL_POINTER)
+        {
+            const uint32_t key_slot = static_cast<uint32_t>((parent_ref & SPAN_SLOT_MASK) >> SPAN_SLOT_SHIFT);
+            next_ptr = prev_occupied_span_slot(current_ptr, key_slot, parent_ref);
+            path_stack.push(parent_ref);
+            if (next_ptr == NIL_POINTER)
+                retreat_path_to_prev_leaf(path_stack);
+            else
+                push_rightmost_path(next_ptr, path_stack);
+            return;
+        }
+        path_stack.push(parent_ref);
         current_ptr = next_ptr;
     }
+
+    if (key_follows_critical || critical_bit == (std::numeric_limits<uint32_t>::max)())
+    {
+        push_rightmost_path(current_ptr, path_stack);
+        return;
+    }
+    path_stack.push(current_ptr);
+    retreat_path_to_prev_leaf(path_stack);
+}
+
+void StaxTree::seek_last(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    push_rightmost_path(root_ptr_.load(std::memory_order_acquire), path_stack);
+}
+
+void StaxTree::push_rightmost_path(uint64_t subtree_ptr, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    uint64_t current_ptr = subtree_ptr;
+    while (current_ptr != NIL_POINTER)
+    {
+        if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            uint64_t parent_ref;
+            uint64_t child_ptr = prev_occupied_span_slot(current_ptr, span_node_fanout(current_ptr), parent_ref);
+            path_stack.push(parent_ref);
+            current_ptr = child_ptr;
+            continue;
+        }
+        path_stack.push(current_ptr);
+        if (current_ptr & POINTER_TAG_BIT)
+            break;
+        current_ptr = internal_node_allocator_.get_right_child_ptr(current_ptr).load(std::memory_order_acquire);
+    }
+}
+
+// Mirror of advance_path_to_next_leaf: the top of the stack is a subtree
+// whose keys are all known to be too large.
+void StaxTree::retreat_path_to_prev_leaf(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const
+{
+    if (path_stack.empty())
+        return;
+    uint64_t visited_ptr = path_stack.top();
+    if (visited_ptr & SPAN_NODE_TAG_BIT)
+        visited_ptr &= ~SPAN_SLOT_MASK;
+    path_stack.pop();
+
+    while (!path_stack.empty())
+    {
+        uint64_t parent_pointer = path_stack.top();
+
+        if (parent_pointer & SPAN_NODE_TAG_BIT)
+        {
+            uint32_t current_slot = static_cast<uint32_t>((parent_pointer & SPAN_SLOT_MASK) >> SPAN_SLOT_SHIFT);
+            uint64_t parent_ref;
+            uint64_t prev_subtree_root = prev_occupied_span_slot(parent_pointer & ~SPAN_SLOT_MASK, current_slot, parent_ref);
+            if (prev_subtree_root != NIL_POINTER)
+            {
+                path_stack.top() = parent_ref;
+                push_rightmost_path(prev_subtree_root, path_stack);
+                return;
+            }
+        }
+        else if (internal_node_allocator_.get_right_child_ptr(parent_pointer).load(std::memory_order_acquire) == visited_ptr)
+        {
+            push_rightmost_path(internal_node_allocator_.get_left_child_ptr(parent_pointer).load(std::memory_order_acquire), path_stack);
+            return;
+        }
+        visited_ptr = (parent_pointer & SPAN_NODE_TAG_BIT) ? (parent_pointer & ~SPAN_SLOT_MASK) : parent_pointer;
+        path_stack.pop();
+    }
+}
+
+void StaxTree::partition_key_space(std::string_view start_key, std::optional<std::string_view> end_key, size_t max_partitions, std::vector<std::string> &boundaries) const
+{
+    EpochGuard epoch_guard(epoch_manager_, EpochManager::current_thread_stripe());
+    boundaries.clear();
+    const uint64_t root = root_ptr_.load(std::memory_order_acquire);
+    if (max_partitions < 2 || root == NIL_POINTER)
+        return;
+
+    auto leaf_key = [this](uint64_t leaf_ptr)
+    {
+        const char *key_data;
+        uint32_t key_len, value_len;
+        record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(leaf_ptr & POINTER_INDEX_MASK), &key_data, key_len, value_len);
+        return std::string_view(key_data, key_len);
+    };
+
+    // With counts available the split points can be placed exactly.
+    if (has_order_statistics())
+    {
+        const uint64_t first_rank = rank(start_key);
+        const uint64_t last_rank = end_key ? rank(*end_key) : subtree_live_count(root);
+        if (last_rank <= first_rank)
+            return;
+        for (size_t p = 1; p < max_partitions; ++p)
+        {
+            std::optional<RecordData> record = select(first_rank + (last_rank - first_rank) * p / max_partitions);
+            if (!record)
+                continue;
+            std::string_view key = record->key_view();
+            if (key > start_key && (boundaries.empty() || key > boundaries.back()))
+                boundaries.emplace_back(key);
+        }
+        return;
+    }
+
+    // Otherwise expand the top levels breadth-first, keeping the subtrees in
+    // key order and dropping the ones that lie entirely outside the range.
+    std::vector<uint64_t> frontier{root};
+    std::vector<std::string_view> frontier_keys;
+    std::vector<uint64_t> expanded;
+    while (true)
+    {
+        frontier_keys.clear();
+        for (uint64_t subtree_ptr : frontier)
+            frontier_keys.push_back(leaf_key(leftmost_leaf(subtree_ptr)));
+
+        expanded.clear();
+        for (size_t i = 0; i < frontier.size(); ++i)
+        {
+            if (i + 1 < frontier.size() && frontier_keys[i + 1] <= start_key)
+                continue;
+            if (end_key && frontier_keys[i] >= *end_key)
+                break;
+            expanded.push_back(frontier[i]);
+        }
+        frontier.swap(expanded);
+        if (frontier.size() >= max_partitions)
+            break;
+
+        bool grew = false;
+        expanded.clear();
+        for (uint64_t subtree_ptr : frontier)
+        {
+            if (subtree_ptr & POINTER_TAG_BIT)
+            {
+                expanded.push_back(subtree_ptr);
+                continue;
+            }
+            grew = true;
+            const uint64_t node_offset = subtree_ptr & NODE_OFFSET_MASK;
+            if (subtree_ptr & SPAN_NODE_TAG_BIT)
+            {
+                const uint32_t fanout = span_node_fanout(subtree_ptr);
+                for (uint32_t slot = 0; slot < fanout; ++slot)
+                {
+                    uint64_t child_ptr = internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire);
+                    if (child_ptr != NIL_POINTER)
+                        expanded.push_back(child_ptr);
+                }
+            }
+            else
+            {
+                expanded.push_back(internal_node_allocator_.get_left_child_ptr(node_offset).load(std::memory_order_acquire));
+                expanded.push_back(internal_node_allocator_.get_right_child_ptr(node_offset).load(std::memory_order_acquire));
+            }
+        }
+        if (!grew)
+            break;
+        frontier.swap(expanded);
+    }
+
+    // The first subtree opens the range, so its leftmost key is no split point.
+    std::vector<std::string_view> candidates;
+    for (size_t i = 1; i < frontier.size(); ++i)
+    {
+        std::string_view key = leaf_key(leftmost_leaf(frontier[i]));
+        if (key > start_key && (!end_key || key < *end_key))
+            candidates.push_back(key);
+    }
+    if (candidates.size() < max_partitions)
+    {
+        boundaries.assign(candidates.begin(), candidates.end());
+        return;
+    }
+    for (size_t p = 1; p < max_partitions; ++p)
+        boundaries.emplace_back(candidates[(p * (candidates.size() + 1)) / max_partitions - 1]);
 }
 
 void StaxTree::find_leaf_nodes_recursive(uint64_t current_ptr, std::string_view prefix, std::vector<uint64_t> &leaf_nodes) const
@@ -514,6 +1924,17 @@ void StaxTree::find_leaf_nodes_recursive(uint64_t current_ptr, std::string_view
         return;
     }
 
+    if (current_ptr & SPAN_NODE_TAG_BIT)
+    {
+        const uint64_t node_offset = current_ptr & NODE_OFFSET_MASK;
+        const uint32_t fanout = span_node_fanout(current_ptr);
+        for (uint32_t slot = 0; slot < fanout; ++slot)
+        {
+            find_leaf_nodes_recursive(internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire), prefix, leaf_nodes);
+        }
+        return;
+    }
+
     uint32_t bit_index = internal_node_allocator_.get_bit_index(current_ptr);
     size_t byte_idx = bit_index / 8;
 
@@ -543,7 +1964,7 @@ void StaxTree::find_leaf_nodes_in_range(std::string_view prefix, std::vector<uin
 
     while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
     {
-        uint32_t bit_index = internal_node_allocator_.get_bit_index(current_ptr);
+        uint32_t bit_index = node_bit_index(current_ptr);
         size_t byte_idx = bit_index / 8;
 
         if (byte_idx >= prefix.length())
@@ -552,9 +1973,219 @@ void StaxTree::find_leaf_nodes_in_range(std::string_view prefix, std::vector<uin
             break;
         }
 
-        bool bit = get_bit(prefix.data(), prefix.length(), bit_index);
-        current_ptr = bit ? internal_node_allocator_.get_right_child_ptr(current_ptr).load(std::memory_order_acquire) : internal_node_allocator_.get_left_child_ptr(current_ptr).load(std::memory_order_acquire);
+        uint64_t parent_ref;
+        current_ptr = next_child_ptr(current_ptr, prefix.data(), prefix.length(), parent_ref, std::memory_order_acquire);
     }
 
     find_leaf_nodes_recursive(current_ptr, prefix, leaf_nodes);
-}
\ No newline at end of file
+}
+uint64_t StaxTree::subtree_live_count(uint64_t subtree_ptr) const
+{
+    if (subtree_ptr == NIL_POINTER)
+        return 0;
+    if (subtree_ptr & POINTER_TAG_BIT)
+        return record_allocator_.get_record_data(static_cast<uint32_t>(subtree_ptr & POINTER_INDEX_MASK)).is_deleted ? 0 : 1;
+    return internal_node_allocator_.get_live_leaf_count(subtree_ptr & NODE_OFFSET_MASK).load(std::memory_order_acquire);
+}
+
+uint64_t StaxTree::recount_subtree(uint64_t subtree_ptr)
+{
+    if (subtree_ptr == NIL_POINTER || (subtree_ptr & POINTER_TAG_BIT))
+        return subtree_live_count(subtree_ptr);
+
+    const uint64_t node_offset = subtree_ptr & NODE_OFFSET_MASK;
+    uint64_t live_count = 0;
+    if (subtree_ptr & SPAN_NODE_TAG_BIT)
+    {
+        const uint32_t fanout = span_node_fanout(subtree_ptr);
+        for (uint32_t slot = 0; slot < fanout; ++slot)
+            live_count += recount_subtree(internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire));
+    }
+    else
+    {
+        live_count += recount_subtree(internal_node_allocator_.get_left_child_ptr(node_offset).load(std::memory_order_acquire));
+        live_count += recount_subtree(internal_node_allocator_.get_right_child_ptr(node_offset).load(std::memory_order_acquire));
+    }
+    internal_node_allocator_.get_live_leaf_count(node_offset).store(static_cast<uint32_t>(live_count), std::memory_order_release);
+    return live_count;
+}
+
+// The first num_steps entries of a traversal path lead to the nodes above the
+// modified link; each of them gains (or loses) the changed live key.
+void StaxTree::add_live_count_delta(size_t thread_id, PathBuffer &path, size_t num_steps, int64_t delta)
+{
+    if (delta == 0)
+        return;
+    for (size_t i = 0; i < num_steps; ++i)
+    {
+        const uint64_t node_ptr = path[i].child_ptr;
+        if (node_ptr & POINTER_TAG_BIT)
+            continue;
+        std::atomic<uint32_t> &live_count = internal_node_allocator_.get_live_leaf_count(node_ptr & NODE_OFFSET_MASK);
+        live_count.fetch_add(static_cast<uint32_t>(delta), std::memory_order_acq_rel);
+        mark_dirty(thread_id, &live_count, sizeof(uint32_t));
+    }
+}
+
+void StaxTree::require_order_statistics() const
+{
+    if (!order_statistics_enabled_.load(std::memory_order_acquire))
+        throw std::runtime_error("StaxTree: order statistics are not enabled for this collection.");
+}
+
+void StaxTree::enable_order_statistics()
+{
+    std::lock_guard<std::mutex> lock(order_statistics_write_mutex_);
+    recount_subtree(root_ptr_.load(std::memory_order_acquire));
+    order_statistics_enabled_.store(true, std::memory_order_release);
+}
+
+uint64_t StaxTree::count_prefix(std::string_view prefix) const
+{
+    require_order_statistics();
+    EpochGuard epoch_guard(epoch_manager_, EpochManager::current_thread_stripe());
+
+    uint64_t current_ptr = root_ptr_.load(std::memory_order_acquire);
+    while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+    {
+        if (node_bit_index(current_ptr) / 8 >= prefix.length())
+            break;
+        uint64_t parent_ref;
+        current_ptr = next_child_ptr(current_ptr, prefix.data(), prefix.length(), parent_ref, std::memory_order_acquire);
+    }
+    if (current_ptr == NIL_POINTER)
+        return 0;
+
+    // Every key below the stopping point shares the bits tested so far, so a
+    // single key decides whether the whole subtree matches the prefix.
+    const char *key_ptr;
+    uint32_t key_len, value_len;
+    record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(leftmost_leaf(current_ptr) & POINTER_INDEX_MASK), &key_ptr, key_len, value_len);
+    if (!key_ptr || !std::string_view(key_ptr, key_len).starts_with(prefix))
+        return 0;
+    return subtree_live_count(current_ptr);
+}
+
+uint64_t StaxTree::count_range(std::string_view start_key, std::string_view end_key) const
+{
+    const uint64_t end_rank = rank(end_key);
+    const uint64_t start_rank = rank(start_key);
+    return end_rank > start_rank ? end_rank - start_rank : 0;
+}
+
+uint64_t StaxTree::rank(std::string_view key) const
+{
+    require_order_statistics();
+    EpochGuard epoch_guard(epoch_manager_, EpochManager::current_thread_stripe());
+
+    const uint64_t root = root_ptr_.load(std::memory_order_acquire);
+    if (root == NIL_POINTER)
+        return 0;
+    const char *key_data = key.data();
+    const size_t key_len = key.length();
+
+    // Find the stored key sharing the longest prefix with the probe, then
+    // walk the same path again adding up everything ordered before it.
+    uint64_t current_ptr = root;
+    uint64_t parent_ref;
+    while (!(current_ptr & POINTER_TAG_BIT))
+    {
+        uint64_t next_ptr = next_child_ptr(current_ptr, key_data, key_len, parent_ref, std::memory_order_acquire);
+        if (next_ptr == NIL_POINTER)
+        {
+            current_ptr = leftmost_leaf(current_ptr);
+            break;
+        }
+        current_ptr = next_ptr;
+    }
+
+    const char *closest_key_data;
+    uint32_t closest_key_len, closest_value_len;
+    record_allocator_.get_record_key_and_lengths(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK), &closest_key_data, closest_key_len, closest_value_len);
+    const uint32_t critical_bit = find_critical_bit(key_data, key_len, closest_key_data, closest_key_len);
+    const bool key_follows_critical = (critical_bit != (std::numeric_limits<uint32_t>::max)()) && get_bit(key_data, key_len, critical_bit);
+
+    uint64_t keys_before = 0;
+    current_ptr = root;
+    while (current_ptr != NIL_POINTER)
+    {
+        if (current_ptr & POINTER_TAG_BIT)
+            return keys_before + (key_follows_critical ? subtree_live_count(current_ptr) : 0);
+
+        const uint32_t bit_index = node_bit_index(current_ptr);
+        if (bit_index > critical_bit)
+            return keys_before + (key_follows_critical ? subtree_live_count(current_ptr) : 0);
+
+        const uint64_t node_offset = current_ptr & NODE_OFFSET_MASK;
+        if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            const uint32_t key_slot = span_slot(key_data, key_len, bit_index, (current_ptr & SPAN_NODE_WIDE_BIT) != 0);
+            for (uint32_t slot = 0; slot < key_slot; ++slot)
+                keys_before += subtree_live_count(internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire));
+            current_ptr = internal_node_allocator_.get_span_child_ptr(node_offset, key_slot).load(std::memory_order_acquire);
+        }
+        else if (get_bit(key_data, key_len, bit_index))
+        {
+            keys_before += subtree_live_count(internal_node_allocator_.get_left_child_ptr(node_offset).load(std::memory_order_acquire));
+            current_ptr = internal_node_allocator_.get_right_child_ptr(node_offset).load(std::memory_order_acquire);
+        }
+        else
+        {
+            current_ptr = internal_node_allocator_.get_left_child_ptr(node_offset).load(std::memory_order_acquire);
+        }
+    }
+    return keys_before;
+}
+
+std::optional<RecordData> StaxTree::select(uint64_t index) const
+{
+    require_order_statistics();
+    EpochGuard epoch_guard(epoch_manager_, EpochManager::current_thread_stripe());
+
+    uint64_t current_ptr = root_ptr_.load(std::memory_order_acquire);
+    if (index >= subtree_live_count(current_ptr))
+        return std::nullopt;
+
+    while (current_ptr != NIL_POINTER && !(current_ptr & POINTER_TAG_BIT))
+    {
+        const uint64_t node_offset = current_ptr & NODE_OFFSET_MASK;
+        uint64_t next_ptr = NIL_POINTER;
+        if (current_ptr & SPAN_NODE_TAG_BIT)
+        {
+            const uint32_t fanout = span_node_fanout(current_ptr);
+            for (uint32_t slot = 0; slot < fanout; ++slot)
+            {
+                uint64_t child_ptr = internal_node_allocator_.get_span_child_ptr(node_offset, slot).load(std::memory_order_acquire);
+                uint64_t child_count = subtree_live_count(child_ptr);
+                if (index < child_count)
+                {
+                    next_ptr = child_ptr;
+                    break;
+                }
+                index -= child_count;
+            }
+        }
+        else
+        {
+            uint64_t left_ptr = internal_node_allocator_.get_left_child_ptr(node_offset).load(std::memory_order_acquire);
+            uint64_t left_count = subtree_live_count(left_ptr);
+            if (index < left_count)
+            {
+                next_ptr = left_ptr;
+            }
+            else
+            {
+                index -= left_count;
+                next_ptr = internal_node_allocator_.get_right_child_ptr(node_offset).load(std::memory_order_acquire);
+            }
+        }
+        current_ptr = next_ptr;
+    }
+
+    if (current_ptr == NIL_POINTER)
+        return std::nullopt;
+    RecordData record = record_allocator_.get_record_data(static_cast<uint32_t>(current_ptr & POINTER_INDEX_MASK));
+    if (record.is_deleted)
+        return std::nullopt;
+    return record;
+}
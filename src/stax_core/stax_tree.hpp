@@ -5,6 +5,7 @@
 #include <optional>
 #include <algorithm>
 #include <new>
+#include <string>
 #include <string_view>
 #include <atomic>
 #include <stack>
@@ -15,6 +16,8 @@
 #include <limits>
 #include <memory>
 #include <iterator>
+#include <mutex>
+#include <array>
 
 #if defined(__x86_64__) || defined(__i386__)
 #include <immintrin.h>
@@ -33,11 +36,30 @@
 #include "stax_common/common_types.hpp"
 #include "stax_common/constants.h"
 #include "stax_tx/transaction.h"
+#include "stax_tx/snapshot_registry.hpp"
+#include "stax_core/dirty_range_tracker.hpp"
 
 constexpr uint64_t POINTER_TAG_BIT = 1ULL << 63;
-constexpr uint64_t POINTER_INDEX_MASK = ~(POINTER_TAG_BIT);
+constexpr uint64_t POINTER_INDEX_MASK = 0xFFFFFFFFULL;
 constexpr uint64_t NIL_POINTER = 0;
 
+// Leaf pointers carry a 24-bit fingerprint of their key above the record
+// offset. Zero means "unknown" (leaves written before fingerprints existed).
+constexpr uint64_t LEAF_FINGERPRINT_SHIFT = 32;
+constexpr uint64_t LEAF_FINGERPRINT_MASK = 0xFFFFFFULL << LEAF_FINGERPRINT_SHIFT;
+
+// Internal pointers to span nodes carry a tag (and a width bit for the
+// 256-way variant). Traversal paths and cursors park the slot they followed
+// in the otherwise unused bits above the node offset.
+constexpr uint64_t SPAN_NODE_TAG_BIT = 1ULL << 62;
+constexpr uint64_t SPAN_NODE_WIDE_BIT = 1ULL << 61;
+constexpr uint64_t SPAN_SLOT_SHIFT = 48;
+constexpr uint64_t SPAN_SLOT_MASK = 0xFFULL << SPAN_SLOT_SHIFT;
+constexpr uint64_t NODE_OFFSET_MASK = (1ULL << SPAN_SLOT_SHIFT) - 1;
+
+constexpr uint32_t span_node_fanout(uint64_t span_ptr) { return (span_ptr & SPAN_NODE_WIDE_BIT) ? 256 : 16; }
+constexpr uint32_t node_bits_tested(uint64_t node_ptr) { return (node_ptr & SPAN_NODE_TAG_BIT) ? ((node_ptr & SPAN_NODE_WIDE_BIT) ? 8 : 4) : 1; }
+
 #if defined(_MSC_VER)
 #define STAX_ALWAYS_INLINE __forceinline
 #elif defined(__GNUC__) || defined(__clang__)
@@ -46,6 +68,21 @@ constexpr uint64_t NIL_POINTER = 0;
 #define STAX_ALWAYS_INLINE inline
 #endif
 
+// Key shapes the hot paths are compiled for. The graph collections only use
+// a handful of fixed big-endian widths, for which bounds, comparisons and the
+// critical bit reduce to a few word operations; everything else is generic.
+struct VariableWidthKey
+{
+    static constexpr size_t width = 0;
+};
+
+template <size_t Width>
+struct FixedWidthKey
+{
+    static_assert(Width > 0 && Width <= 16, "Fixed-width keys must fit in two machine words.");
+    static constexpr size_t width = Width;
+};
+
 class StaxTree
 {
 private:
@@ -55,6 +92,14 @@ private:
     NodeAllocator<StaxTreeNode> &internal_node_allocator_;
     CollectionRecordAllocator &record_allocator_;
     std::atomic<uint64_t> &root_ptr_;
+    EpochManager *epoch_manager_;
+    const SnapshotRegistry *snapshot_registry_;
+    DirtyRangeTracker *dirty_range_tracker_;
+
+    // In order-statistic mode every internal node carries the number of live
+    // keys below it, and writers are serialized to keep those counts exact.
+    std::atomic<bool> order_statistics_enabled_;
+    std::mutex order_statistics_write_mutex_;
 
     struct TraversalStep
     {
@@ -63,6 +108,7 @@ private:
     };
     static_assert(sizeof(TraversalStep) == 16, "Compact TraversalStep must be 16 bytes");
     static constexpr uint64_t PARENT_IS_ROOT = (std::numeric_limits<uint64_t>::max)();
+    static constexpr size_t MULTI_GET_GROUP_SIZE = 16;
 
     class PathBuffer
     {
@@ -100,33 +146,204 @@ private:
             capacity_ = new_capacity;
         }
         void reset() { size_ = 0; }
+        void truncate(size_t new_size) { size_ = (std::min)(size_, new_size); }
         size_t size() const { return size_; }
         TraversalStep &operator[](size_t index) { return buffer_[index]; }
         TraversalStep &back() { return buffer_[size_ - 1]; }
     };
 
+    // Path and key of a thread slot's previous insert. A key above last_key
+    // (the append pattern of time-series and order-id collections) resumes
+    // its descent from this path instead of the root.
+    struct AppendHint
+    {
+        PathBuffer path;
+        std::string last_key;
+        uint64_t counted_write_sequence = 0;
+    };
+    std::array<std::unique_ptr<AppendHint>, MAX_CONCURRENT_THREADS> append_hints_;
+    // Bumped by every counted insert (under order_statistics_write_mutex_),
+    // so a hint can tell whether another writer has changed the tree since.
+    uint64_t counted_write_sequence_ = 0;
+
+    // Optional hash index over the keys. Links only ever change from a leaf
+    // to a newer version of the same key or to a node above it, so a link
+    // that once held a key's leaf still leads to it by descending with the
+    // key's bits. Indexing the link rather than the leaf needs no index
+    // update when a key gets a new version.
+    HashIndexHeader *hash_index_ = nullptr;
+    std::atomic<uint64_t> *hash_index_slots_ = nullptr;
+    static constexpr uint64_t HASH_INDEX_TAG_SHIFT = 48;
+    static constexpr uint64_t HASH_INDEX_LINK_MASK = (1ULL << HASH_INDEX_TAG_SHIFT) - 1;
+
+    // Direct-mapped by the first JUMP_TABLE_BITS bits of a key: the deepest
+    // node on that prefix's path that tests no bit past it, so descents skip
+    // the top levels. Entries carry the generation they were filled in. Only
+    // a split publishing a node that tests a prefix bit (or a bulk publish)
+    // bumps it, and the next descent refills a stale entry. At most
+    // 2^JUMP_TABLE_BITS nodes can test prefix bits, so the stamp cannot wrap.
+    static_assert(JUMP_TABLE_BITS <= 16, "jump table is indexed by the first two key bytes");
+    static constexpr uint64_t JUMP_ENTRY_GENERATION_SHIFT = 48;
+    static constexpr uint64_t JUMP_ENTRY_GENERATION_MASK = 0x1FFFULL;
+    std::unique_ptr<std::atomic<uint64_t>[]> jump_table_;
+    std::atomic<uint64_t> jump_table_generation_{1};
+
     STAX_ALWAYS_INLINE bool get_bit(const char *s_data, size_t s_len, uint32_t bit_index) const;
     STAX_ALWAYS_INLINE int count_leading_zeros(uint32_t x) const;
     STAX_ALWAYS_INLINE int simd_memcmp(const char *s1, const char *s2, size_t n) const;
+    STAX_ALWAYS_INLINE void prefetch_for_read(const void *address) const;
+    template <typename KeyTraits = VariableWidthKey>
+    STAX_ALWAYS_INLINE uint64_t key_hash(const char *key_data, size_t key_len) const;
+    STAX_ALWAYS_INLINE uint64_t fingerprint_from_hash(uint64_t hash) const;
+    template <typename KeyTraits = VariableWidthKey>
+    STAX_ALWAYS_INLINE uint64_t key_fingerprint(const char *key_data, size_t key_len) const;
+    template <typename KeyTraits>
+    STAX_ALWAYS_INLINE bool keys_equal(const char *stored_key_data, size_t stored_key_len, const char *key_data, size_t key_len) const;
+    template <typename KeyTraits>
+    STAX_ALWAYS_INLINE uint32_t critical_bit_against(const char *key_data, size_t key_len, const char *stored_key_data, size_t stored_key_len) const;
+    template <typename KeyTraits>
+    void insert_impl(const TxnContext &ctx, std::string_view key, std::string_view value, bool is_delete, PathBuffer &path, size_t reusable_steps, bool maintain_counts);
+    size_t shared_path_steps(PathBuffer &path, std::string_view previous_key, std::string_view key) const;
+    AppendHint *get_append_hint(size_t thread_id);
+    size_t append_hint_steps(AppendHint &hint, std::string_view key, bool maintain_counts);
+
+    size_t prune_version_chain(size_t thread_id, uint32_t head_offset, bool prune_settled_head = false);
+
+    STAX_ALWAYS_INLINE std::atomic<uint64_t> *child_link(uint64_t node_ptr, const char *key_data, size_t key_len) const;
+    uint64_t link_offset(const std::atomic<uint64_t> *link) const;
+    std::atomic<uint64_t> *link_at(uint64_t byte_offset) const;
+    STAX_ALWAYS_INLINE void mark_dirty(size_t thread_id, const void *address, size_t size_bytes);
+    void hash_index_insert(size_t thread_id, uint64_t hash, const std::atomic<uint64_t> *link);
+    void hash_index_subtree(size_t thread_id, std::atomic<uint64_t> *link);
+    template <typename KeyTraits>
+    uint64_t hash_index_lookup(const char *key_data, size_t key_len, uint64_t hash) const;
+
+    STAX_ALWAYS_INLINE uint32_t jump_slot(const char *key_data, size_t key_len) const;
+    uint64_t jump_table_start(const char *key_data, size_t key_len) const;
+    template <typename KeyTraits>
+    std::optional<RecordData> get_impl(const TxnContext &ctx, std::string_view key, bool keeps_tombstones) const;
+    STAX_ALWAYS_INLINE bool leaf_may_match(uint64_t leaf_ptr, uint64_t fingerprint) const;
+    STAX_ALWAYS_INLINE void prefetch_node(uint64_t node_ptr) const;
+    STAX_ALWAYS_INLINE uint32_t span_slot(const char *s_data, size_t s_len, uint32_t start_bit, bool wide) const;
+    STAX_ALWAYS_INLINE uint32_t node_bit_index(uint64_t node_ptr) const;
+    STAX_ALWAYS_INLINE uint64_t next_child_ptr(uint64_t node_ptr, const char *key_data, size_t key_len, uint64_t &out_parent_ref, std::memory_order order) const;
+    uint64_t next_occupied_span_slot(uint64_t span_ptr, uint32_t first_slot, uint64_t &out_parent_ref) const;
+    uint64_t prev_occupied_span_slot(uint64_t span_ptr, uint32_t end_slot, uint64_t &out_parent_ref) const;
+    uint64_t leftmost_leaf(uint64_t subtree_ptr) const;
     uint32_t find_critical_bit(const char *s1_data, size_t len1, const char *s2_data, size_t len2) const;
     std::atomic<uint64_t> *get_link_from_step(const TraversalStep &step);
     void find_leaf_nodes_recursive(uint64_t current_ptr, std::string_view prefix, std::vector<uint64_t> &leaf_nodes) const;
+    void push_leftmost_path(uint64_t subtree_ptr, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    void advance_path_to_next_leaf(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    void push_rightmost_path(uint64_t subtree_ptr, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    void retreat_path_to_prev_leaf(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    uint64_t subtree_live_count(uint64_t subtree_ptr) const;
+    uint64_t recount_subtree(uint64_t subtree_ptr);
+    void add_live_count_delta(size_t thread_id, PathBuffer &path, size_t num_steps, int64_t delta);
+    void require_order_statistics() const;
 
 public:
-    
+    // Builds a subtree bottom-up from keys appended in ascending order and
+    // publishes it with a single CAS on an empty root. Repeated keys become
+    // newer versions of the previous record, as with consecutive inserts.
+    // Dense regions of the finished tree are packed into span nodes that test
+    // a whole nibble (16-way) or byte (256-way) of the key in one step.
+    class BulkLoader
+    {
+    public:
+        BulkLoader(StaxTree &tree, const TxnContext &ctx);
+        BulkLoader(const BulkLoader &) = delete;
+        BulkLoader &operator=(const BulkLoader &) = delete;
+
+        void append(std::string_view key, std::string_view value, bool is_delete = false);
+        // Links a record already written to the tree's record allocator, e.g.
+        // by another thread. Its key must be above every key appended so far.
+        void append_record(uint32_t record_rel_offset);
+        bool publish();
+        size_t size() const { return appended_count_; }
+
+    private:
+        void link_leaf(uint64_t leaf_ptr, uint32_t critical_bit);
+        uint64_t allocate_binary_node();
+        uint64_t complete_subtree(uint64_t subtree_ptr, uint32_t parent_bit_index);
+        uint64_t collapse_byte_region(uint64_t subtree_ptr);
+        uint64_t collapse_nibble_region(uint64_t subtree_ptr);
+        void collapse_low_nibble_regions(uint64_t node_ptr, uint32_t limit_bit);
+        void collect_span_frontier(uint64_t node_ptr, uint32_t limit_bit);
+        uint64_t build_span_node(uint32_t start_bit, bool wide);
+        void set_completed_count(uint64_t node_idx);
+        void release_subtree(uint64_t subtree_ptr);
+
+        StaxTree &tree_;
+        TxnContext ctx_;
+        bool maintain_counts_;
+        std::vector<uint64_t> right_spine_;
+        std::vector<uint64_t> recycled_nodes_;
+        std::vector<uint64_t> span_frontier_;
+        std::vector<uint64_t> span_interior_;
+        uint64_t pending_leaf_ptr_;
+        const char *last_key_data_;
+        uint32_t last_key_len_;
+        size_t appended_count_;
+    };
+
     StaxTree(NodeAllocator<StaxTreeNode> &internal_alloc,
              CollectionRecordAllocator &record_alloc,
-             std::atomic<uint64_t> &root_ref);
+             std::atomic<uint64_t> &root_ref,
+             EpochManager *epoch_manager = nullptr,
+             const SnapshotRegistry *snapshot_registry = nullptr,
+             DirtyRangeTracker *dirty_range_tracker = nullptr);
+
+    // Readers that keep RecordData or path stacks from this tree beyond a
+    // single call (cursors, callers of get/select) hold one of these.
+    EpochGuard pin_epoch(size_t thread_id) const { return EpochGuard(epoch_manager_, thread_id); }
+    EpochManager *get_epoch_manager() const { return epoch_manager_; }
 
     void insert(const TxnContext &ctx, std::string_view key, std::string_view value, bool is_delete = false);
 
     void insert_batch(const TxnContext &ctx, const CoreKVPair *kv_pairs, size_t num_kvs, TransactionBatch &batch);
-    std::optional<RecordData> get(const TxnContext &ctx, std::string_view key) const;
+    bool bulk_load(const TxnContext &ctx, const CoreKVPair *kv_pairs, size_t num_kvs, TransactionBatch &batch);
+    // With keeps_tombstones a visible tombstone is returned rather than nothing.
+    std::optional<RecordData> get(const TxnContext &ctx, std::string_view key, bool keeps_tombstones = false) const;
     void remove(const TxnContext &ctx, std::string_view key);
+    // Positions path_stack on the first leaf whose key is >= start_key, or
+    // leaves it empty when there is none.
     void seek(std::string_view start_key, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    // Positions path_stack on the last leaf whose key is <= key (or the last
+    // leaf of the tree), or leaves it empty when there is none.
+    void seek_for_prev(std::string_view key, std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    void seek_last(std::stack<uint64_t, std::vector<uint64_t>> &path_stack) const;
+    // Splits [start_key, end_key) into at most max_partitions sub-ranges by
+    // expanding the top of the tree; writes the inner boundary keys in order.
+    void partition_key_space(std::string_view start_key, std::optional<std::string_view> end_key, size_t max_partitions, std::vector<std::string> &boundaries) const;
     void find_leaf_nodes_in_range(std::string_view prefix, std::vector<uint64_t> &leaf_nodes) const;
+
+    // For the maintenance thread, outside any transaction. Prunes the version
+    // chains of up to max_keys keys from resume_key on, including chains
+    // whose head no writer will touch again. resume_key is left on the next
+    // key to visit, or cleared once the last key has been visited. Returns
+    // the number of versions cut.
+    size_t prune_version_chains(size_t thread_id, std::string &resume_key, size_t max_keys);
+    // Reads the internal nodes nearest the root, breadth first, until the
+    // next one would take more than max_bytes, so the pages every descent
+    // crosses are resident. Returns the bytes read.
+    size_t prefetch_top_levels(size_t thread_id, size_t max_bytes) const;
     void multi_get_simd(const TxnContext &ctx, const std::vector<std::string_view> &keys, std::vector<std::optional<RecordData>> &results) const;
 
+    // Counts follow the newest version of every key, like seek_raw cursors.
+    // They throw std::runtime_error unless order statistics are enabled.
+    void enable_order_statistics();
+    // Serves point gets from an open-addressing index in the arena before
+    // falling back to a descent. With populate, every key already in the tree
+    // is indexed. Like enable_order_statistics, call it before writers start.
+    void attach_hash_index(HashIndexHeader *index, bool populate);
+    bool has_hash_index() const { return hash_index_ != nullptr; }
+    bool has_order_statistics() const { return order_statistics_enabled_.load(std::memory_order_acquire); }
+    uint64_t count_prefix(std::string_view prefix) const;
+    uint64_t count_range(std::string_view start_key, std::string_view end_key) const;
+    uint64_t rank(std::string_view key) const;
+    std::optional<RecordData> select(uint64_t index) const;
+
     RecordData get_record_data_by_offset(uint32_t rel_offset) const
     {
         return record_allocator_.get_record_data(rel_offset);
@@ -12,6 +12,7 @@
 #include <vector>  
 #include "stax_common/constants.h"
 #include "stax_common/common_types.hpp"
+#include "stax_core/epoch_manager.hpp"
 
 
 class Database;
@@ -60,10 +61,12 @@ private:
 
     std::array<ThreadLocalBuffer, MAX_CONCURRENT_THREADS> thread_tlabs_;
     size_t num_threads_configured_for_db_;
+    FreeBlockPool free_pool_;
 
     static constexpr uint32_t OFFSET_GRANULARITY = 8;
     
     static constexpr size_t FIXED_HEADER_SIZE = 24;
+    static constexpr size_t PREV_VERSION_FIELD_OFFSET = 20;
     static_assert(FIXED_HEADER_SIZE % OFFSET_GRANULARITY == 0, "Fixed header size must be a multiple of granularity for alignment.");
     
     void allocate_new_tlab(size_t thread_id, size_t requested_record_size);
@@ -82,6 +85,9 @@ public:
     }
 
     void *reserve_record_space(size_t thread_id, size_t key_len, size_t value_len, uint32_t &out_record_rel_offset);
+    // Hands back a record that was never linked into a tree, e.g. after a lost CAS.
+    void release_record_space(size_t thread_id, uint32_t rel_offset, size_t key_len, size_t value_len);
+    FreeBlockPool &get_free_pool() noexcept { return free_pool_; }
 
     
     STAX_ALWAYS_INLINE void finalize_record_header_and_data(void *record_base_ptr, size_t key_len, size_t value_len, bool is_delete, TxnID txn_id, uint32_t prev_version_rel_offset, const char *key_data, const char *value_data) noexcept {
@@ -145,6 +151,12 @@ public:
         return record_data;
     }
     
+    // Version chains are cut in place while readers walk them.
+    STAX_ALWAYS_INLINE std::atomic_ref<uint32_t> get_prev_version_ref(uint32_t rel_offset) const noexcept {
+        uint64_t byte_offset = static_cast<uint64_t>(rel_offset) * OFFSET_GRANULARITY;
+        return std::atomic_ref<uint32_t>(*reinterpret_cast<uint32_t *>(mmap_base_addr_ + byte_offset + PREV_VERSION_FIELD_OFFSET));
+    }
+
     STAX_ALWAYS_INLINE void *get_record_address(uint32_t relative_offset) const noexcept {
         uint64_t byte_offset = static_cast<uint64_t>(relative_offset) * OFFSET_GRANULARITY;
         return static_cast<void *>(mmap_base_addr_ + byte_offset);
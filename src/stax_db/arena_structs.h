@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <atomic>
 #include <type_traits>
 
@@ -14,7 +15,9 @@ struct StaxTreeNode
 
     uint16_t bit_index;
 
-    uint8_t padding[6];
+    uint8_t padding[2];
+
+    std::atomic<uint32_t> live_leaf_count;
 
     std::atomic<uint64_t> left_child_ptr;
     std::atomic<uint64_t> right_child_ptr;
@@ -22,6 +25,34 @@ struct StaxTreeNode
 static_assert(sizeof(StaxTreeNode) == 24, "StaxTreeNode must be 24 bytes for cache alignment.");
 static_assert(alignof(StaxTreeNode) == 8, "StaxTreeNode must be 8-byte aligned.");
 
+struct StaxSpanNode16
+{
+
+    uint16_t bit_index;
+
+    uint8_t padding[2];
+
+    std::atomic<uint32_t> live_leaf_count;
+
+    std::atomic<uint64_t> child_ptrs[16];
+};
+static_assert(sizeof(StaxSpanNode16) == 136, "StaxSpanNode16 must be 136 bytes.");
+
+struct StaxSpanNode256
+{
+
+    uint16_t bit_index;
+
+    uint8_t padding[2];
+
+    std::atomic<uint32_t> live_leaf_count;
+
+    std::atomic<uint64_t> child_ptrs[256];
+};
+static_assert(sizeof(StaxSpanNode256) == 2056, "StaxSpanNode256 must be 2056 bytes.");
+static_assert(offsetof(StaxSpanNode16, child_ptrs) == offsetof(StaxSpanNode256, child_ptrs), "Span node layouts must share a header.");
+static_assert(offsetof(StaxSpanNode256, live_leaf_count) == offsetof(StaxTreeNode, live_leaf_count), "All tree nodes must keep their live leaf count at the same offset.");
+
 struct CollectionEntry
 {
     std::atomic<uint64_t> root_node_ptr;
@@ -32,6 +63,27 @@ struct CollectionEntry
 };
 static_assert(sizeof(CollectionEntry) == 32, "CollectionEntry must be 32 bytes");
 
+// Header of a collection's optional hash index; capacity slots of
+// std::atomic<uint64_t> follow it. A slot holds a 16-bit key hash tag above
+// the arena offset of a tree link that leads to the key's leaf.
+struct HashIndexHeader
+{
+    uint64_t capacity;
+    std::atomic<uint64_t> used_slots;
+    uint64_t reserved[6];
+};
+static_assert(sizeof(HashIndexHeader) == 64, "HashIndexHeader must be 64 bytes");
+
+// A collection's counters as of the last write-ahead log checkpoint. Replay
+// starts from these, not from the entry, whose page may have been written
+// back with deltas the log replays again.
+struct CheckpointedCounts
+{
+    uint64_t logical_item_count;
+    uint64_t live_record_bytes;
+};
+static_assert(sizeof(CheckpointedCounts) == 16, "CheckpointedCounts must be 16 bytes");
+
 struct FileHeader
 {
     uint64_t magic;
@@ -47,9 +99,15 @@ struct FileHeader
     std::atomic<uint32_t> collection_array_count;
     uint32_t collection_array_capacity;
 
-    uint64_t reserved_pointers[9];
+    std::atomic<uint64_t> order_statistics_collection_mask;
+
+    uint64_t reserved_pointers[8];
+
+    std::atomic<uint64_t> hash_index_offsets[MAX_COLLECTIONS_PER_DB_INITIAL];
+
+    CheckpointedCounts checkpointed_counts[MAX_COLLECTIONS_PER_DB_INITIAL];
 
-    uint8_t final_padding_bytes[8060];
+    uint8_t final_padding_bytes[6524];
 };
 static_assert(sizeof(FileHeader) == 8192, "FileHeader must be 8192 bytes");
 static_assert(std::is_standard_layout<FileHeader>::value, "FileHeader must be standard layout");
@@ -4,6 +4,7 @@
 #include "stax_tx/db_cursor.hpp"
 #include "stax_graph/graph_engine.h"
 #include "stax_db/statistics.h"
+#include "stax_db/write_ahead_log.h"
 #include <stdexcept>
 #include <new>
 #include <filesystem>
@@ -13,7 +14,9 @@
 #include <chrono>
 #include <mutex>
 #include <algorithm>
-#include <unordered_map>
+#include <exception>
+#include <bit>
+#include <cstring>
 
 #include "stax_common/roaring.h"
 
@@ -28,10 +31,22 @@ void DbGeneration::unmap_and_close()
     owned_record_allocators.clear();
     internal_node_allocator.reset();
 
+    unmap_file();
+
+    if (lock_file_handle != INVALID_OS_FILE_HANDLE)
+    {
+        OSFileExtensions::unlock_file(lock_file_handle);
+        lock_file_handle = INVALID_OS_FILE_HANDLE;
+    }
+}
+
+void DbGeneration::unmap_file()
+{
     if (file_header && mmap_base)
     {
         OSFileExtensions::flush_file_range_raw(mmap_base, mmap_size);
     }
+    file_header = nullptr;
     if (mmap_base)
     {
         OSFileExtensions::unmap_file_raw(mmap_base, mmap_size);
@@ -42,12 +57,6 @@ void DbGeneration::unmap_and_close()
         OSFileExtensions::close_file(file_handle);
         file_handle = INVALID_OS_FILE_HANDLE;
     }
-
-    if (lock_file_handle != INVALID_OS_FILE_HANDLE)
-    {
-        OSFileExtensions::unlock_file(lock_file_handle);
-        lock_file_handle = INVALID_OS_FILE_HANDLE;
-    }
 }
 
 CollectionEntry &DbGeneration::get_collection_entry_ref(uint32_t idx) const
@@ -60,7 +69,7 @@ CollectionEntry &DbGeneration::get_collection_entry_ref(uint32_t idx) const
 }
 
 MergedCursorImpl::MergedCursorImpl(Database *db, const TxnContext &ctx, uint32_t collection_idx, std::string_view start_key_view, std::optional<std::string_view> end_key)
-    : db_(db), ctx_(ctx)
+    : db_(db), ctx_(ctx), collection_idx_(collection_idx)
 {
     if (end_key)
     {
@@ -69,37 +78,129 @@ MergedCursorImpl::MergedCursorImpl(Database *db, const TxnContext &ctx, uint32_t
         end_key_view_ = end_key_buffer_;
     }
 
+    position_forward(start_key_view, false);
+    merge_next_visible(pq_, false);
+}
+
+MergedCursorImpl::MergedCursorImpl(Database *db, const TxnContext &ctx, uint32_t collection_idx, ReverseSeek seek, std::optional<std::string_view> start_key)
+    : db_(db), ctx_(ctx), collection_idx_(collection_idx), reverse_(true)
+{
+    if (start_key)
+    {
+        has_start_key_ = true;
+        start_key_buffer_ = std::string(*start_key);
+        start_key_view_ = start_key_buffer_;
+    }
+
+    position_reverse(seek.last_key, false);
+    merge_next_visible(reverse_pq_, true);
+}
+
+void MergedCursorImpl::position_forward(std::string_view start_key, bool skip_start_key)
+{
+    reverse_pq_ = {};
+    pq_ = {};
+    const std::optional<std::string_view> end_key = has_end_key_ ? std::optional<std::string_view>(end_key_view_) : std::nullopt;
+
+    EpochGuard epoch_guard(db_->get_epoch_manager(), ctx_.thread_id);
     const auto &generations = db_->get_generations();
+    // A newer generation's tombstone must reach the merge to shadow older ones.
+    const bool keeps_tombstones = generations.size() > 1;
     for (size_t i = 0; i < generations.size(); ++i)
     {
-        if (collection_idx < generations[i]->owned_collections.size() && generations[i]->owned_collections[collection_idx])
+        Collection *col = i == 0 ? db_->get_active_collection(collection_idx_) : nullptr;
+        if (i != 0 && collection_idx_ < generations[i]->owned_collections.size())
+            col = generations[i]->owned_collections[collection_idx_].get();
+        if (col)
         {
-            Collection &col = *generations[i]->owned_collections[collection_idx];
-            DBCursor generation_cursor(db, ctx, &col.get_critbit_tree(), start_key_view, end_key, false);
+            DBCursor generation_cursor(db_, ctx_, &col->get_critbit_tree(), start_key, end_key, false, keeps_tombstones);
+            if (skip_start_key && generation_cursor.is_valid() && generation_cursor.key() == start_key)
+            {
+                generation_cursor.next();
+            }
             if (generation_cursor.is_valid())
             {
                 pq_.push({std::move(generation_cursor), i});
             }
         }
     }
-    advance();
+}
+
+void MergedCursorImpl::position_reverse(std::optional<std::string_view> last_key, bool skip_last_key)
+{
+    pq_ = {};
+    reverse_pq_ = {};
+    const std::optional<std::string_view> start_key = has_start_key_ ? std::optional<std::string_view>(start_key_view_) : std::nullopt;
+
+    EpochGuard epoch_guard(db_->get_epoch_manager(), ctx_.thread_id);
+    const auto &generations = db_->get_generations();
+    const bool keeps_tombstones = generations.size() > 1;
+    for (size_t i = 0; i < generations.size(); ++i)
+    {
+        Collection *col = i == 0 ? db_->get_active_collection(collection_idx_) : nullptr;
+        if (i != 0 && collection_idx_ < generations[i]->owned_collections.size())
+            col = generations[i]->owned_collections[collection_idx_].get();
+        if (col)
+        {
+            DBCursor generation_cursor(db_, ctx_, &col->get_critbit_tree(), ReverseSeek{last_key}, start_key, false, keeps_tombstones);
+            if (skip_last_key && last_key && generation_cursor.is_valid() && generation_cursor.key() == *last_key)
+            {
+                generation_cursor.prev();
+            }
+            if (generation_cursor.is_valid())
+            {
+                reverse_pq_.push({std::move(generation_cursor), i});
+            }
+        }
+    }
 }
 
 void MergedCursorImpl::advance()
+{
+    if (reverse_)
+    {
+        if (!is_valid_)
+            return;
+        // Changing direction re-seeks every generation just past the current key.
+        reverse_ = false;
+        position_forward(last_key_view_, true);
+    }
+    merge_next_visible(pq_, false);
+}
+
+void MergedCursorImpl::retreat()
+{
+    if (!reverse_)
+    {
+        if (!is_valid_)
+            return;
+        reverse_ = true;
+        position_reverse(last_key_view_, true);
+    }
+    merge_next_visible(reverse_pq_, true);
+}
+
+template <typename Queue>
+void MergedCursorImpl::merge_next_visible(Queue &queue, bool reverse)
 {
     while (true)
     {
-        if (pq_.empty())
+        if (queue.empty())
         {
             is_valid_ = false;
             return;
         }
 
-        MergeCursorState top_state = std::move(const_cast<MergeCursorState &>(pq_.top()));
-        pq_.pop();
+        MergeCursorState top_state = std::move(const_cast<MergeCursorState &>(queue.top()));
+        queue.pop();
         std::string_view candidate_key = top_state.cursor.key();
 
-        if (has_end_key_ && candidate_key >= end_key_view_)
+        if (!reverse && has_end_key_ && candidate_key >= end_key_view_)
+        {
+            is_valid_ = false;
+            return;
+        }
+        if (reverse && has_start_key_ && candidate_key < start_key_view_)
         {
             is_valid_ = false;
             return;
@@ -108,10 +209,10 @@ void MergedCursorImpl::advance()
         std::vector<MergeCursorState> candidate_versions;
         candidate_versions.push_back(std::move(top_state));
 
-        while (!pq_.empty() && pq_.top().cursor.key() == candidate_key)
+        while (!queue.empty() && queue.top().cursor.key() == candidate_key)
         {
-            candidate_versions.push_back(std::move(const_cast<MergeCursorState &>(pq_.top())));
-            pq_.pop();
+            candidate_versions.push_back(std::move(const_cast<MergeCursorState &>(queue.top())));
+            queue.pop();
         }
 
         RecordData best_visible_record;
@@ -140,10 +241,13 @@ void MergedCursorImpl::advance()
                 current_record_to_check = tree_ptr->get_record_data_by_offset(current_record_to_check.prev_version_rel_offset);
             }
 
-            candidate.cursor.next();
+            if (reverse)
+                candidate.cursor.prev();
+            else
+                candidate.cursor.next();
             if (candidate.cursor.is_valid())
             {
-                pq_.push(std::move(candidate));
+                queue.push(std::move(candidate));
             }
         }
 
@@ -163,8 +267,11 @@ DBCursor::DBCursor() : impl_(nullptr), ctx_(inert_context) {}
 DBCursor::DBCursor(Database *db, const TxnContext &ctx, uint32_t collection_idx, std::string_view start_key, std::optional<std::string_view> end_key)
     : impl_(std::make_unique<MergedCursorImpl>(db, ctx, collection_idx, start_key, end_key)), ctx_(ctx) {}
 
+DBCursor::DBCursor(Database *db, const TxnContext &ctx, uint32_t collection_idx, ReverseSeek seek, std::optional<std::string_view> start_key)
+    : impl_(std::make_unique<MergedCursorImpl>(db, ctx, collection_idx, seek, start_key)), ctx_(ctx) {}
+
 DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, std::optional<std::string_view> end_key, bool raw_mode)
-    : db_(db), ctx_(ctx), tree_(tree), is_valid_(false), raw_mode_(raw_mode)
+    : db_(db), ctx_(ctx), tree_(tree), epoch_guard_(tree->pin_epoch(ctx.thread_id)), is_valid_(false), raw_mode_(raw_mode)
 {
     if (end_key)
     {
@@ -180,8 +287,8 @@ DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, std::opt
     }
 }
 
-DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, std::string_view start_key, std::optional<std::string_view> end_key, bool raw_mode)
-    : db_(db), ctx_(ctx), tree_(tree), is_valid_(false), raw_mode_(raw_mode)
+DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, std::string_view start_key, std::optional<std::string_view> end_key, bool raw_mode, bool keeps_tombstones)
+    : db_(db), ctx_(ctx), tree_(tree), epoch_guard_(tree->pin_epoch(ctx.thread_id)), is_valid_(false), raw_mode_(raw_mode), keeps_tombstones_(keeps_tombstones)
 {
     if (end_key)
     {
@@ -209,6 +316,32 @@ DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, std::str
     }
 }
 
+DBCursor::DBCursor(Database *db, const TxnContext &ctx, StaxTree *tree, ReverseSeek seek, std::optional<std::string_view> start_key, bool raw_mode, bool keeps_tombstones)
+    : db_(db), ctx_(ctx), tree_(tree), epoch_guard_(tree->pin_epoch(ctx.thread_id)), is_valid_(false), raw_mode_(raw_mode), keeps_tombstones_(keeps_tombstones)
+{
+    if (start_key)
+    {
+        has_start_key_ = true;
+        start_key_buffer_ = std::string(*start_key);
+        start_key_view_ = start_key_buffer_;
+    }
+    if (seek.last_key)
+        tree_->seek_for_prev(*seek.last_key, path_stack_);
+    else
+        tree_->seek_last(path_stack_);
+
+    validate_current_leaf();
+
+    while (!is_valid_ && !path_stack_.empty()) {
+        prev();
+    }
+
+    if (is_valid_ && has_start_key_ && key() < start_key_view_)
+    {
+        is_valid_ = false;
+    }
+}
+
 DBCursor::~DBCursor() = default;
 
 bool DBCursor::is_valid() const
@@ -241,34 +374,46 @@ void DBCursor::advance_to_next_physical_leaf()
         is_valid_ = false;
         return;
     }
-    uint64_t current_leaf_pointer = path_stack_.top();
-    path_stack_.pop();
+    tree_->advance_path_to_next_leaf(path_stack_);
+}
+
+void DBCursor::retreat_to_prev_physical_leaf()
+{
+    if (path_stack_.empty())
+    {
+        is_valid_ = false;
+        return;
+    }
+    tree_->retreat_path_to_prev_leaf(path_stack_);
+}
 
-    uint64_t next_subtree_root = NIL_POINTER;
-    while (!path_stack_.empty())
+void DBCursor::prev()
+{
+    if (impl_)
     {
-        uint64_t parent_pointer = path_stack_.top();
+        impl_->retreat();
+        return;
+    }
 
-        uint64_t left_child_val = tree_->internal_node_allocator_.get_left_child_ptr(parent_pointer).load(std::memory_order_acquire);
+    while (true)
+    {
+        retreat_to_prev_physical_leaf();
 
-        if (left_child_val == current_leaf_pointer)
+        if (path_stack_.empty())
         {
-            next_subtree_root = tree_->internal_node_allocator_.get_right_child_ptr(parent_pointer).load(std::memory_order_acquire);
-            break;
+            is_valid_ = false;
+            return;
         }
-        current_leaf_pointer = parent_pointer;
-        path_stack_.pop();
-    }
 
-    if (next_subtree_root != NIL_POINTER)
-    {
-        uint64_t pointer_to_push = next_subtree_root;
-        while (pointer_to_push != NIL_POINTER)
+        validate_current_leaf();
+
+        if (is_valid_)
         {
-            path_stack_.push(pointer_to_push);
-            if (pointer_to_push & POINTER_TAG_BIT)
-                break;
-            pointer_to_push = tree_->internal_node_allocator_.get_left_child_ptr(pointer_to_push).load(std::memory_order_acquire);
+            if (has_start_key_ && key() < start_key_view_)
+            {
+                is_valid_ = false;
+            }
+            return;
         }
     }
 }
@@ -338,7 +483,7 @@ void DBCursor::validate_current_leaf()
             current_record_data_ = record;
             current_key_ptr_ = record.key_ptr;
             current_key_len_ = record.key_len;
-            is_valid_ = !current_record_data_.is_deleted;
+            is_valid_ = keeps_tombstones_ || !current_record_data_.is_deleted;
             return;
         }
         version_relative_offset_for_mvcc = record.prev_version_rel_offset;
@@ -348,61 +493,55 @@ void DBCursor::validate_current_leaf()
 }
 
 thread_local HybridTimestampGenerator::ThreadTxnIDGenerator HybridTimestampGenerator::tls_generator_;
+std::atomic<uint64_t> HybridTimestampGenerator::next_instance_id_{1};
 
-HybridTimestampGenerator::HybridTimestampGenerator() : last_generated_id_(0) {}
+HybridTimestampGenerator::HybridTimestampGenerator()
+    : last_generated_id_(0), instance_id_(next_instance_id_.fetch_add(1, std::memory_order_relaxed)) {}
 
+// A batch is one fetch_add on the shared counter. The clock only ever moves
+// the counter forward, at most once a millisecond, so ids keep tracking wall
+// time without a retry loop on every batch.
 TxnID HybridTimestampGenerator::get_next_id()
 {
-    TxnID batch_start_id;
-    TxnID next_id;
-
-    if (tls_generator_.current_local_id_ < tls_generator_.local_id_end_)
+    ThreadTxnIDGenerator &local = tls_generator_;
+    if (local.owner_instance_id_ == instance_id_ && local.current_local_id_ < local.local_id_end_)
     {
-        next_id = tls_generator_.current_local_id_;
-        tls_generator_.current_local_id_++;
-        return next_id;
+        return local.current_local_id_++;
     }
-    else
-    {
-        uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                              std::chrono::system_clock::now().time_since_epoch())
-                              .count();
-
-        TxnID expected_global_id = last_generated_id_.load(std::memory_order_acquire);
 
-        while (true)
-        {
-            TxnID new_proposed_global_id;
-            TxnID expected_ts_part = expected_global_id >> 16;
-
-            if (now_ms > expected_ts_part)
-            {
-                new_proposed_global_id = (now_ms << 16);
-            }
-            else
-            {
-                new_proposed_global_id = expected_global_id + 1;
-            }
+    const uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+    const TxnID clock_floor = static_cast<TxnID>(now_ms) << 16;
+    TxnID observed_id = last_generated_id_.load(std::memory_order_relaxed);
+    if (observed_id < clock_floor)
+    {
+        last_generated_id_.compare_exchange_strong(observed_id, clock_floor, std::memory_order_relaxed);
+    }
 
-            batch_start_id = new_proposed_global_id;
-            if (last_generated_id_.compare_exchange_weak(expected_global_id, batch_start_id + BATCH_SIZE, std::memory_order_release, std::memory_order_acquire))
-            {
-                tls_generator_.current_local_id_ = batch_start_id;
-                tls_generator_.local_id_end_ = batch_start_id + BATCH_SIZE;
+    const TxnID batch_start_id = last_generated_id_.fetch_add(BATCH_SIZE, std::memory_order_relaxed);
+    local.owner_instance_id_ = instance_id_;
+    local.current_local_id_ = batch_start_id + 1;
+    local.local_id_end_ = batch_start_id + BATCH_SIZE;
+    return batch_start_id;
+}
 
-                next_id = tls_generator_.current_local_id_;
-                tls_generator_.current_local_id_++;
-                return next_id;
-            }
-            now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         std::chrono::system_clock::now().time_since_epoch())
-                         .count();
-        }
+void HybridTimestampGenerator::advance_past(TxnID id)
+{
+    TxnID observed_id = last_generated_id_.load(std::memory_order_relaxed);
+    while (observed_id <= id && !last_generated_id_.compare_exchange_weak(observed_id, id + 1, std::memory_order_relaxed))
+    {
     }
 }
 
 Database::Database(const std::filesystem::path &base_dir, size_t num_threads, DurabilityLevel level)
     : timestamp_generator_(std::make_unique<HybridTimestampGenerator>()),
+      epoch_manager_(std::make_unique<EpochManager>()),
+      snapshot_registry_(std::make_unique<SnapshotRegistry>()),
+      commit_watermark_(num_threads),
+      thread_slot_registry_(std::make_shared<ThreadSlotRegistry>(num_threads)),
+      dirty_range_tracker_(level != DurabilityLevel::NoSync ? std::make_unique<DirtyRangeTracker>(OSFileExtensions::get_page_size(), level == DurabilityLevel::SyncOnCommit) : nullptr),
+      librarian_(std::make_unique<Librarian>(std::chrono::seconds(LIBRARIAN_WAKE_UP_INTERVAL_SECONDS), std::chrono::milliseconds(LIBRARIAN_CPU_BUDGET_MS), LIBRARIAN_IO_BUDGET_BYTES)),
       base_directory_(base_dir),
       num_threads_(num_threads),
       durability_level_(level)
@@ -412,10 +551,76 @@ Database::Database(const std::filesystem::path &base_dir, size_t num_threads, Du
 
 Database::~Database()
 {
+    online_compaction_cancelled_.store(true, std::memory_order_relaxed);
+    librarian_->stop();
+    if (online_compaction_thread_.joinable())
+        online_compaction_thread_.join();
+    persist_last_committed_txn_id();
+    if (write_ahead_log_)
+    {
+        std::string err = checkpoint_write_ahead_log();
+        if (!err.empty())
+            std::cerr << "Warning: Final checkpoint failed, the write-ahead log is kept for replay: " << err << std::endl;
+    }
+
+    release_retired_generations(false);
     UniqueSpinLockGuard lock(generations_lock_);
+    active_generation_.store(nullptr, std::memory_order_release);
+    for (std::atomic<Collection *> &collection : collections_by_idx_)
+        collection.store(nullptr, std::memory_order_relaxed);
     generations_.clear();
 }
 
+namespace
+{
+    // The slots the calling thread has leased, one per database it used.
+    // They go back to their registries when the thread exits.
+    struct ThreadSlotLeases
+    {
+        struct Lease
+        {
+            std::weak_ptr<ThreadSlotRegistry> registry;
+            const ThreadSlotRegistry *registry_address;
+            size_t slot;
+        };
+
+        std::vector<Lease> leases;
+
+        ~ThreadSlotLeases()
+        {
+            for (const Lease &lease : leases)
+            {
+                if (std::shared_ptr<ThreadSlotRegistry> registry = lease.registry.lock())
+                    registry->release(lease.slot);
+            }
+        }
+    };
+
+    thread_local ThreadSlotLeases tls_thread_slot_leases;
+}
+
+size_t Database::get_thread_slot()
+{
+    std::vector<ThreadSlotLeases::Lease> &leases = tls_thread_slot_leases.leases;
+    for (auto it = leases.begin(); it != leases.end();)
+    {
+        // Leases on closed databases are dropped first, so a new registry at
+        // a reused address is not mistaken for the old one.
+        if (it->registry.expired())
+        {
+            it = leases.erase(it);
+            continue;
+        }
+        if (it->registry_address == thread_slot_registry_.get())
+            return it->slot;
+        ++it;
+    }
+
+    const size_t slot = thread_slot_registry_->acquire();
+    leases.push_back({thread_slot_registry_, thread_slot_registry_.get(), slot});
+    return slot;
+}
+
 uint64_t Database::hash_name(std::string_view name)
 {
     uint64_t hash = 14695981039346656037ULL;
@@ -427,11 +632,15 @@ uint64_t Database::hash_name(std::string_view name)
     return hash;
 }
 
+// For commits made outside the thread slots (group flushes, recovery); these
+// go straight to the file header as well.
 void Database::update_last_committed_txn_id(TxnID id)
 {
-    if (generations_.empty())
+    commit_watermark_.publish_shared(id);
+    DbGeneration *active_gen_ptr = get_active_generation();
+    if (!active_gen_ptr)
         return;
-    DbGeneration &active_gen = *generations_.front();
+    DbGeneration &active_gen = *active_gen_ptr;
     if (active_gen.file_header)
     {
         TxnID observed_max_id = active_gen.file_header->last_committed_txn_id.load(std::memory_order_acquire);
@@ -449,12 +658,14 @@ void Database::update_last_committed_txn_id(TxnID id)
 
 TxnID Database::get_last_committed_txn_id() const
 {
-    if (generations_.empty())
-        return 0;
-    const DbGeneration &active_gen = *generations_.front();
-    if (!active_gen.file_header)
-        return 0;
-    return active_gen.file_header->last_committed_txn_id.load(std::memory_order_acquire);
+    return commit_watermark_.get();
+}
+
+void Database::persist_last_committed_txn_id()
+{
+    DbGeneration *active_gen = get_active_generation();
+    if (active_gen && active_gen->file_header)
+        update_last_committed_txn_id(commit_watermark_.get());
 }
 
 TxnID Database::get_next_txn_id()
@@ -470,6 +681,8 @@ std::unique_ptr<Database> Database::create_new(const std::filesystem::path &db_d
         std::filesystem::create_directories(db_directory);
     }
     db->open_generation(db_directory, file_name, true);
+    db->open_write_ahead_log();
+    db->start_librarian();
     return db;
 }
 
@@ -477,6 +690,18 @@ std::unique_ptr<Database> Database::open_existing(const std::filesystem::path &d
 {
     auto db = std::make_unique<Database>(db_directory, num_threads, level);
 
+    // An online compaction cut short leaves its partial build, and one cut
+    // short mid-swap may leave the replaced file as the only copy.
+    std::filesystem::remove_all(db_directory / "compaction");
+    const std::filesystem::path retired_path = db_directory / "data.stax.retired";
+    if (std::filesystem::exists(retired_path))
+    {
+        if (std::filesystem::exists(db_directory / "data.stax"))
+            std::filesystem::remove(retired_path);
+        else
+            std::filesystem::rename(retired_path, db_directory / "data.stax");
+    }
+
     std::vector<std::filesystem::path> gen_paths;
     if (std::filesystem::exists(db_directory / "data.stax"))
     {
@@ -498,6 +723,8 @@ std::unique_ptr<Database> Database::open_existing(const std::filesystem::path &d
     if (gen_paths.empty())
     {
         db->open_generation(db_directory, "data.stax", true);
+        db->open_write_ahead_log();
+        db->start_librarian();
         return db;
     }
 
@@ -513,6 +740,8 @@ std::unique_ptr<Database> Database::open_existing(const std::filesystem::path &d
         std::cerr << "Warning: Multiple database generations found. A previous compaction may have been interrupted." << std::endl;
     }
 
+    db->open_write_ahead_log();
+    db->start_librarian();
     return db;
 }
 
@@ -531,19 +760,37 @@ void Database::drop(const std::filesystem::path& db_directory) {
 
 void Database::open_generation(const std::filesystem::path &db_directory, const std::filesystem::path &file_name, bool is_new)
 {
-    auto gen = std::make_unique<DbGeneration>();
-    gen->path = db_directory / file_name;
-
-    std::filesystem::path lock_path = gen->path;
+    const std::filesystem::path path = db_directory / file_name;
+    std::filesystem::path lock_path = path;
     lock_path += ".lock";
-    gen->lock_file_handle = OSFileExtensions::lock_file(lock_path);
-    if (gen->lock_file_handle == INVALID_OS_FILE_HANDLE)
+    OsFileHandleType lock_file_handle = OSFileExtensions::lock_file(lock_path);
+    if (lock_file_handle == INVALID_OS_FILE_HANDLE)
     {
         throw std::runtime_error("Failed to acquire lock for database file: " + lock_path.string());
     }
 
-    bool file_actually_exists = std::filesystem::exists(gen->path);
-    is_new = !file_actually_exists;
+    auto gen = map_generation(path, lock_file_handle);
+
+    UniqueSpinLockGuard lock(generations_lock_);
+    if (generations_.empty())
+    {
+        const TxnID last_committed_id = gen->file_header->last_committed_txn_id.load(std::memory_order_acquire);
+        commit_watermark_.publish_shared(last_committed_id);
+        timestamp_generator_->advance_past(last_committed_id);
+        for (size_t i = 0; i < gen->owned_collections.size() && i < collections_by_idx_.size(); ++i)
+            collections_by_idx_[i].store(gen->owned_collections[i].get(), std::memory_order_release);
+        active_generation_.store(gen.get(), std::memory_order_release);
+    }
+    generations_.push_back(std::move(gen));
+}
+
+std::unique_ptr<DbGeneration> Database::map_generation(const std::filesystem::path &path, OsFileHandleType lock_file_handle)
+{
+    auto gen = std::make_unique<DbGeneration>();
+    gen->path = path;
+    gen->lock_file_handle = lock_file_handle;
+
+    const bool is_new = !std::filesystem::exists(gen->path);
 
     if (is_new)
     {
@@ -604,6 +851,9 @@ void Database::open_generation(const std::filesystem::path &db_directory, const
         gen->file_header->collection_array_offset = sizeof(FileHeader);
         gen->file_header->collection_array_count.store(0);
         gen->file_header->collection_array_capacity = MAX_COLLECTIONS_PER_DB_INITIAL;
+        gen->file_header->order_statistics_collection_mask.store(0);
+        for (auto &hash_index_offset : gen->file_header->hash_index_offsets)
+            hash_index_offset.store(0, std::memory_order_relaxed);
 
         gen->file_header->global_alloc_offset.store(gen->file_header->collection_array_offset + collection_metadata_region_size);
     }
@@ -634,12 +884,15 @@ void Database::open_generation(const std::filesystem::path &db_directory, const
         gen->owned_collections.emplace_back(
             std::make_unique<Collection>(this, gen.get(), i, *gen->owned_record_allocators[i]));
     }
-
-    UniqueSpinLockGuard lock(generations_lock_);
-    generations_.push_back(std::move(gen));
+    return gen;
 }
 
 uint32_t Database::get_collection(std::string_view name)
+{
+    return get_collection_for_hash(static_cast<uint32_t>(hash_name(name)));
+}
+
+uint32_t Database::get_collection_for_hash(uint32_t name_hash_val)
 {
     UniqueSpinLockGuard lock(generations_lock_);
     if (generations_.empty())
@@ -648,8 +901,6 @@ uint32_t Database::get_collection(std::string_view name)
     }
     DbGeneration &active_gen = *generations_.front();
 
-    uint32_t name_hash_val = static_cast<uint32_t>(hash_name(name));
-
     for (;;)
     {
         uint32_t observed_count = active_gen.file_header->collection_array_count.load(std::memory_order_acquire);
@@ -680,22 +931,36 @@ uint32_t Database::get_collection(std::string_view name)
         if (active_gen.file_header->collection_array_count.compare_exchange_weak(expected_count_for_cas, observed_count + 1))
         {
             uint32_t new_index = observed_count;
-            CollectionEntry &new_entry = active_gen.get_collection_entry_ref(new_index);
-
-            new_entry.name_hash = name_hash_val;
-            new_entry.root_node_ptr.store(0, std::memory_order_relaxed);
-            new_entry.logical_item_count.store(0, std::memory_order_relaxed);
-            new_entry.live_record_bytes.store(0, std::memory_order_relaxed);
-            new_entry.object_id_counter.store(1, std::memory_order_relaxed);
-
-            active_gen.owned_record_allocators[new_index] = std::make_unique<CollectionRecordAllocator>(this, active_gen.mmap_base, num_threads_);
-            active_gen.owned_collections[new_index] = std::make_unique<Collection>(this, &active_gen, new_index, *active_gen.owned_record_allocators[new_index]);
+            init_collection(active_gen, new_index, name_hash_val);
+            collections_by_idx_[new_index].store(active_gen.owned_collections[new_index].get(), std::memory_order_release);
 
+            // Log frames name collections by index, so the entry has to be on
+            // disk before anything is logged against it.
+            if (durability_level_ == DurabilityLevel::Wal)
+                sync_generation(active_gen);
             return new_index;
         }
     }
 }
 
+void Database::init_collection(DbGeneration &gen, uint32_t idx, uint32_t name_hash)
+{
+    CollectionEntry &new_entry = gen.get_collection_entry_ref(idx);
+    new_entry.name_hash = name_hash;
+    new_entry.root_node_ptr.store(0, std::memory_order_relaxed);
+    new_entry.logical_item_count.store(0, std::memory_order_relaxed);
+    new_entry.live_record_bytes.store(0, std::memory_order_relaxed);
+    new_entry.object_id_counter.store(1, std::memory_order_relaxed);
+
+    if (idx >= gen.owned_collections.size())
+    {
+        gen.owned_collections.resize(idx + 1);
+        gen.owned_record_allocators.resize(idx + 1);
+    }
+    gen.owned_record_allocators[idx] = std::make_unique<CollectionRecordAllocator>(this, gen.mmap_base, num_threads_);
+    gen.owned_collections[idx] = std::make_unique<Collection>(this, &gen, idx, *gen.owned_record_allocators[idx]);
+}
+
 uint64_t Database::allocate_data_chunk(size_t size_bytes)
 {
     if (generations_.empty())
@@ -714,18 +979,23 @@ uint64_t Database::allocate_data_chunk(size_t size_bytes)
     return chunk_start_offset;
 }
 
+Collection *Database::get_active_collection(uint32_t collection_idx)
+{
+    return collection_idx < collections_by_idx_.size() ? collections_by_idx_[collection_idx].load(std::memory_order_acquire) : nullptr;
+}
+
 Collection &Database::get_collection_by_idx(uint32_t collection_idx)
 {
-    if (generations_.empty())
+    if (!get_active_generation())
     {
         throw std::runtime_error("Database is not open.");
     }
-    DbGeneration &active_gen = *generations_.front();
-    if (collection_idx >= active_gen.owned_collections.size() || !active_gen.owned_collections[collection_idx])
+    Collection *collection = get_active_collection(collection_idx);
+    if (!collection)
     {
         throw std::out_of_range("Collection index out of valid range or collection not initialized.");
     }
-    return *active_gen.owned_collections[collection_idx];
+    return *collection;
 }
 
 Collection *Database::get_ofv_collection()
@@ -742,15 +1012,16 @@ Collection *Database::get_fvo_collection()
 
 const std::filesystem::path &Database::get_db_path() const
 {
-    if (generations_.empty())
+    const DbGeneration *active_gen = active_generation_.load(std::memory_order_acquire);
+    if (!active_gen)
     {
         static const std::filesystem::path empty_path;
         return empty_path;
     }
-    return generations_.front()->path;
+    return active_gen->path;
 }
 
-void Database::compact(const std::filesystem::path &db_directory, size_t num_threads, bool flatten)
+void Database::compact(const std::filesystem::path &db_directory, size_t num_threads, bool flatten, bool bulk_build)
 {
     std::cout << "Starting compaction process for directory: " << db_directory
               << " (Flatten: " << (flatten ? "Yes" : "No") << ")" << std::endl;
@@ -779,39 +1050,24 @@ void Database::compact(const std::filesystem::path &db_directory, size_t num_thr
     for (uint32_t i = 0; i < source_collection_count; ++i)
     {
         uint32_t collection_name_hash_from_source = source_db->generations_.front()->get_collection_entry_ref(i).name_hash;
-        std::string collection_name_placeholder = "collection_hash_" + std::to_string(collection_name_hash_from_source);
 
         Collection &source_collection = *source_db->generations_.front()->owned_collections[i];
-        uint32_t dest_collection_idx = compacted_db->get_collection(collection_name_placeholder);
+        uint32_t dest_collection_idx = compacted_db->get_collection_for_hash(collection_name_hash_from_source);
         Collection &dest_collection = compacted_db->get_collection_by_idx(dest_collection_idx);
+        if (source_collection.get_critbit_tree().has_hash_index())
+            dest_collection.enable_hash_index(source_db->generations_.front()->get_collection_entry_ref(i).logical_item_count.load(std::memory_order_relaxed));
 
         TxnContext compaction_read_ctx = source_db->begin_transaction_context(0, true);
         TxnContext compaction_write_ctx = compacted_db->begin_transaction_context(0, false);
         TransactionBatch write_batch;
 
-        if (flatten)
-        {
-            std::unordered_map<std::string, RecordData> latest_versions;
-            for (auto cursor = source_collection.seek_first(compaction_read_ctx); cursor->is_valid(); cursor->next())
-            {
-                latest_versions[std::string(cursor->key())] = cursor->current_record_data_;
-            }
-            for (const auto &pair : latest_versions)
-            {
-                if (!pair.second.is_deleted)
-                {
-                    dest_collection.insert(compaction_write_ctx, write_batch, pair.first, pair.second.value_view());
-                }
-            }
-        }
-        else
-        {
-            for (auto cursor = source_collection.seek_first(compaction_read_ctx); cursor->is_valid(); cursor->next())
-            {
-                dest_collection.insert(compaction_write_ctx, write_batch, cursor->key(), static_cast<std::string_view>(cursor->value()));
-            }
-        }
+        // The merged cursors stream every generation's records in key order.
+        // Flattening bulk builds from a single stream, which keeps nothing per
+        // record, where the partitioned bulk path keeps an offset for each.
+        const size_t copy_workers = flatten && bulk_build ? 1 : num_threads;
+        copy_collection(source_collection, compaction_read_ctx, dest_collection, compaction_write_ctx.txn_id, copy_workers, bulk_build, write_batch);
         compacted_db->commit(compaction_write_ctx, dest_collection_idx, write_batch);
+        source_db->abort(compaction_read_ctx);
     }
 
     TxnID final_compacted_db_txn_id = compacted_db->get_last_committed_txn_id();
@@ -819,6 +1075,7 @@ void Database::compact(const std::filesystem::path &db_directory, size_t num_thr
     if (compacted_gen && compacted_gen->file_header)
     {
         compacted_gen->file_header->last_committed_txn_id.store(final_compacted_db_txn_id, std::memory_order_release);
+        compacted_gen->file_header->order_statistics_collection_mask.store(source_db->generations_.front()->file_header->order_statistics_collection_mask.load(std::memory_order_acquire), std::memory_order_release);
     }
 
     compacted_db.reset();
@@ -842,73 +1099,1012 @@ void Database::compact(const std::filesystem::path &db_directory, size_t num_thr
     std::filesystem::remove(temp_path, ec);
     if (ec)
         std::cerr << "Warning: Failed to clean up temporary file '" << temp_path << "': " << ec.message() << std::endl;
-}
 
-StaxStats::DatabaseStatisticsCollector Database::get_statistics_collector()
-{
-    return StaxStats::DatabaseStatisticsCollector(this);
+    // The new file holds no tombstones, so the older generations it merged
+    // would otherwise bring back the values those tombstones shadowed.
+    if (flatten)
+    {
+        for (int i = 0;; ++i)
+        {
+            std::filesystem::path old_gen_path = db_directory / ("data.stax_g" + std::to_string(i));
+            if (!std::filesystem::exists(old_gen_path))
+                break;
+            std::filesystem::remove(old_gen_path, ec);
+            if (ec)
+                throw std::runtime_error("Failed to remove flattened generation '" + old_gen_path.string() + "': " + ec.message());
+        }
+    }
 }
 
-TxnContext Database::begin_transaction_context(size_t thread_id, bool is_read_only)
+// With several workers and bulk_build, the partitions write their records
+// side by side and keep only their offsets, 4 bytes a record; one pass then
+// links them into the tree in key order, partition after partition.
+bool Database::copy_collection(Collection &source, const TxnContext &read_ctx, Collection &dest, TxnID load_txn_id, size_t num_workers, bool bulk_build,
+                               TransactionBatch &totals, const std::function<bool(size_t record_bytes)> &keep_going)
 {
-    if (is_read_only)
+    StaxTree &dest_tree = dest.get_critbit_tree();
+    const TxnContext load_ctx{load_txn_id, load_txn_id, 0};
+    num_workers = std::clamp<size_t>(num_workers, 1, (std::min)(dest.parent_db_->num_threads_, static_cast<size_t>(MAX_CONCURRENT_THREADS)));
+
+    if (bulk_build && num_workers == 1)
+    {
+        StaxTree::BulkLoader loader(dest_tree, load_ctx);
+        for (auto cursor = source.seek_first(read_ctx); cursor->is_valid(); cursor->next())
+        {
+            const std::string_view key = cursor->key();
+            const std::string_view value = static_cast<std::string_view>(cursor->value());
+            if (keep_going && !keep_going(key.length() + value.length()))
+                return false;
+            loader.append(key, value);
+            totals.logical_item_count_delta++;
+            totals.live_record_bytes_delta += key.length() + value.length() + CollectionRecordAllocator::HEADER_SIZE;
+        }
+        if (!loader.publish())
+            throw std::runtime_error("Compaction failed: destination collection was modified during bulk load.");
+        return true;
+    }
+
+    std::vector<std::vector<uint32_t>> partition_records(num_workers);
+    std::vector<TransactionBatch> partition_totals(num_workers);
+    std::atomic<bool> is_stopped{false};
+    source.parallel_scan(read_ctx, "", std::nullopt, num_workers, [&](size_t partition_index, DBCursor &cursor)
+                         {
+        // Allocation is slot-local, so no two workers may share a slot.
+        if (partition_index >= num_workers)
+            throw std::out_of_range("Compaction partition " + std::to_string(partition_index) + " has no destination slot of its own.");
+        const TxnContext partition_ctx{load_txn_id, load_txn_id, partition_index};
+        TransactionBatch &partition_batch = partition_totals[partition_index];
+        for (; cursor.is_valid(); cursor.next())
+        {
+            const std::string_view key = cursor.key();
+            const std::string_view value = static_cast<std::string_view>(cursor.value());
+            if (is_stopped.load(std::memory_order_relaxed) || (keep_going && !keep_going(key.length() + value.length())))
+            {
+                is_stopped.store(true, std::memory_order_relaxed);
+                return;
+            }
+            if (bulk_build)
+            {
+                uint32_t record_rel_offset;
+                void *record_ptr = dest.record_allocator_->reserve_record_space(partition_index, key.length(), value.length(), record_rel_offset);
+                dest.record_allocator_->finalize_record_header_and_data(record_ptr, key.length(), value.length(), false, load_txn_id,
+                                                                        CollectionRecordAllocator::NIL_RECORD_OFFSET, key.data(), value.data());
+                partition_records[partition_index].push_back(record_rel_offset);
+            }
+            else
+            {
+                dest_tree.insert(partition_ctx, key, value);
+            }
+            partition_batch.logical_item_count_delta++;
+            partition_batch.live_record_bytes_delta += key.length() + value.length() + CollectionRecordAllocator::HEADER_SIZE;
+        } });
+    if (is_stopped.load(std::memory_order_relaxed))
+        return false;
+
+    if (bulk_build)
     {
-        return {0, get_last_committed_txn_id(), thread_id};
+        StaxTree::BulkLoader loader(dest_tree, load_ctx);
+        for (std::vector<uint32_t> &records : partition_records)
+        {
+            for (uint32_t record_rel_offset : records)
+                loader.append_record(record_rel_offset);
+            std::vector<uint32_t>().swap(records);
+        }
+        if (!loader.publish())
+            throw std::runtime_error("Compaction failed: destination collection was modified during bulk load.");
     }
-    else
+    for (const TransactionBatch &partition_batch : partition_totals)
     {
-        TxnID new_id = get_next_txn_id();
-        return {new_id, new_id, thread_id};
+        totals.logical_item_count_delta += partition_batch.logical_item_count_delta;
+        totals.live_record_bytes_delta += partition_batch.live_record_bytes_delta;
     }
+    return true;
 }
 
-void Database::commit(const TxnContext &ctx, uint32_t collection_idx, const TransactionBatch &batch)
+// Capture starts before the snapshot is taken, and the snapshot waits until
+// every commit that may have missed the start has published, so each commit
+// is in the snapshot or captured. A captured commit at or below the snapshot
+// may be in the copy already; its writes are idempotent per key and it is
+// counted by what they change.
+bool Database::compact_online(uint64_t io_bytes_per_second)
 {
-    if (ctx.txn_id == 0)
-        return;
-
-    DbGeneration *active_gen = get_active_generation();
-    if (!active_gen)
-        return;
+    std::lock_guard<std::mutex> compaction_lock(online_compaction_mutex_);
+    const std::chrono::milliseconds wait_timeout(ONLINE_COMPACTION_QUIESCE_TIMEOUT_MS);
+    const size_t thread_slot = get_thread_slot();
 
-    CollectionEntry &entry = active_gen->get_collection_entry_ref(collection_idx);
-    if (batch.logical_item_count_delta != 0)
     {
-        entry.logical_item_count.fetch_add(batch.logical_item_count_delta, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> capture_lock(compaction_capture_mutex_);
+        compaction_capture_frames_.clear();
     }
-    if (batch.live_record_bytes_delta != 0)
+    compaction_capture_active_.store(true, std::memory_order_seq_cst);
+    const bool commits_settled = epoch_manager_->wait_for_pins(wait_timeout);
+    const TxnContext copy_ctx = begin_transaction_context(thread_slot, true);
+    const TxnID snapshot_id = copy_ctx.read_snapshot_id;
+    // Contexts registered from here on read at or above the snapshot, and
+    // every write they make is recorded.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint64_t first_swap_ticket = snapshot_registry_->get_next_ticket();
+
+    const std::filesystem::path compaction_directory = base_directory_ / "compaction";
+    std::unique_ptr<Database> compacted_db;
+    bool is_copy_ctx_open = true;
+    auto abandon = [&]
+    {
+        compaction_capture_active_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> capture_lock(compaction_capture_mutex_);
+            std::string().swap(compaction_capture_frames_);
+        }
+        if (is_copy_ctx_open)
+            end_transaction_context(copy_ctx);
+        compacted_db.reset();
+        std::error_code ec;
+        std::filesystem::remove_all(compaction_directory, ec);
+    };
+    if (!commits_settled)
     {
-        entry.live_record_bytes.fetch_add(batch.live_record_bytes_delta, std::memory_order_relaxed);
+        abandon();
+        return false;
     }
 
-    update_last_committed_txn_id(ctx.txn_id);
-
-    if (durability_level_ == DurabilityLevel::SyncOnCommit)
+    try
     {
-        if (active_gen->mmap_base)
+        std::filesystem::remove_all(compaction_directory);
+        compacted_db = Database::create_new(compaction_directory, num_threads_, DurabilityLevel::NoSync);
+        compacted_db->librarian_->stop();
+        DbGeneration &compacted_gen = *compacted_db->get_active_generation();
+        DbGeneration &source_gen = *get_active_generation();
+
+        auto add_compacted_collection = [&](uint32_t idx) -> Collection &
         {
-            std::string err = OSFileExtensions::flush_file_range_raw(active_gen->mmap_base, active_gen->mmap_size);
-            if (!err.empty())
+            const uint32_t dest_idx = compacted_db->get_collection_for_hash(source_gen.get_collection_entry_ref(idx).name_hash);
+            if (dest_idx != idx)
+                throw std::runtime_error("Online compaction failed: collection " + std::to_string(idx) + " was rebuilt at index " + std::to_string(dest_idx) + ".");
+            Collection &dest_collection = compacted_db->get_collection_by_idx(dest_idx);
+            if (source_gen.file_header->order_statistics_collection_mask.load(std::memory_order_acquire) & (1ULL << idx))
+                dest_collection.enable_order_statistics();
+            if (get_collection_by_idx(idx).get_critbit_tree().has_hash_index())
+                dest_collection.enable_hash_index(source_gen.get_collection_entry_ref(idx).logical_item_count.load(std::memory_order_relaxed));
+            return dest_collection;
+        };
+        auto catch_up = [&]() -> size_t
+        {
+            std::string frames;
+            {
+                std::lock_guard<std::mutex> capture_lock(compaction_capture_mutex_);
+                frames.swap(compaction_capture_frames_);
+            }
+            const uint32_t source_count = source_gen.file_header->collection_array_count.load(std::memory_order_acquire);
+            for (uint32_t i = compacted_gen.file_header->collection_array_count.load(std::memory_order_acquire); i < source_count; ++i)
+                add_compacted_collection(i);
+            size_t intact_bytes = 0;
+            WriteAheadLog::for_each_frame(frames, [&](const WriteAheadLog::Frame &frame)
+                                          { apply_redo_frame(compacted_gen, frame, frame.txn_id <= snapshot_id); }, intact_bytes);
+            return frames.size();
+        };
+
+        // One copying thread: the rate limit, not the CPU, bounds the copy.
+        const auto copy_started = std::chrono::steady_clock::now();
+        uint64_t bytes_copied = 0;
+        auto throttle = [&](size_t record_bytes)
+        {
+            bytes_copied += record_bytes;
+            if (io_bytes_per_second != 0)
+                std::this_thread::sleep_until(copy_started + std::chrono::microseconds(bytes_copied * 1000000 / io_bytes_per_second));
+            return !online_compaction_cancelled_.load(std::memory_order_relaxed);
+        };
+        const uint32_t collection_count = source_gen.file_header->collection_array_count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < collection_count; ++i)
+        {
+            Collection &dest_collection = add_compacted_collection(i);
+            TransactionBatch totals;
+            if (!copy_collection(get_collection_by_idx(i), copy_ctx, dest_collection, snapshot_id, 1, true, totals, throttle))
             {
-                throw std::runtime_error("FATAL: Failed to flush data to disk during durable commit: " + err);
+                abandon();
+                return false;
             }
+            CollectionEntry &dest_entry = compacted_gen.get_collection_entry_ref(i);
+            dest_entry.logical_item_count.fetch_add(totals.logical_item_count_delta, std::memory_order_relaxed);
+            dest_entry.live_record_bytes.fetch_add(totals.live_record_bytes_delta, std::memory_order_relaxed);
         }
-    }
-}
+        end_transaction_context(copy_ctx);
+        is_copy_ctx_open = false;
 
-void Database::abort(const TxnContext &ctx)
+        for (size_t round = 0; round < ONLINE_COMPACTION_CATCH_UP_ROUNDS; ++round)
+        {
+            if (catch_up() < ONLINE_COMPACTION_SWAP_BACKLOG_BYTES)
+                break;
+        }
+
+        // Contexts opened before the snapshot may read below it or hold
+        // writes made before capture started. They are waited out here, with
+        // nothing held, catching up meanwhile.
+        const auto wait_deadline = std::chrono::steady_clock::now() + wait_timeout;
+        while (snapshot_registry_->has_floor_before(first_swap_ticket, num_threads_))
+        {
+            if (online_compaction_cancelled_.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= wait_deadline)
+            {
+                abandon();
+                return false;
+            }
+            catch_up();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        bool swapped = false;
+        librarian_->run_exclusive([&]
+                                  { swapped = swap_in_compacted_generation(compacted_db, compaction_directory / "data.stax", [&]
+                                                                           { catch_up(); }); });
+        if (!swapped)
+        {
+            abandon();
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::remove_all(compaction_directory, ec);
+        return true;
+    }
+    catch (...)
+    {
+        abandon();
+        throw;
+    }
+}
+
+// The new file takes the old one's path, so a crash mid-swap leaves one of
+// the two there or at data.stax.retired; open_existing sorts that out. With
+// the commit gate closed no commit can be captured or logged half way, but
+// transactions keep writing: capture stays on until their trees point at the
+// new generation, and their commits carry over what reached the old one.
+bool Database::swap_in_compacted_generation(std::unique_ptr<Database> &compacted_db, const std::filesystem::path &compacted_path, const std::function<void()> &catch_up)
+{
+    if (online_compaction_cancelled_.load(std::memory_order_relaxed) ||
+        !commit_gate_.close(std::chrono::milliseconds(ONLINE_COMPACTION_QUIESCE_TIMEOUT_MS)))
+    {
+        return false;
+    }
+
+    const std::filesystem::path path = get_active_generation()->path;
+    std::filesystem::path retired_path = path;
+    retired_path += ".retired";
+    std::unique_ptr<DbGeneration> new_gen;
+    try
+    {
+        catch_up();
+
+        DbGeneration &old_gen = *get_active_generation();
+        DbGeneration &compacted_gen = *compacted_db->get_active_generation();
+        const uint32_t compacted_count = compacted_gen.file_header->collection_array_count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < compacted_count; ++i)
+            compacted_gen.get_collection_entry_ref(i).object_id_counter.store(old_gen.get_collection_entry_ref(i).object_id_counter.load(std::memory_order_acquire), std::memory_order_relaxed);
+        record_checkpointed_counts(compacted_gen);
+        compacted_gen.file_header->last_committed_txn_id.store(get_last_committed_txn_id(), std::memory_order_release);
+        if (durability_level_ != DurabilityLevel::NoSync)
+        {
+            const std::string err = OSFileExtensions::flush_file_range_raw(compacted_gen.mmap_base, compacted_gen.mmap_size);
+            if (!err.empty())
+                throw std::runtime_error("Online compaction failed to flush the new file: " + err);
+        }
+        compacted_db.reset();
+
+        if (write_ahead_log_)
+        {
+            const std::string err = checkpoint_write_ahead_log();
+            if (!err.empty())
+                throw std::runtime_error("Online compaction failed to checkpoint the write-ahead log: " + err);
+        }
+
+        std::filesystem::rename(path, retired_path);
+        try
+        {
+            std::filesystem::rename(compacted_path, path);
+            new_gen = map_generation(path, INVALID_OS_FILE_HANDLE);
+        }
+        catch (...)
+        {
+            if (!std::filesystem::exists(compacted_path))
+                std::filesystem::rename(path, compacted_path);
+            std::filesystem::rename(retired_path, path);
+            throw;
+        }
+    }
+    catch (...)
+    {
+        commit_gate_.reopen();
+        throw;
+    }
+
+    uint32_t collections_added = 0;
+    {
+        UniqueSpinLockGuard lock(generations_lock_);
+        DbGeneration &old_gen = *generations_.front();
+
+        // Collections created since the last catch-up are still empty.
+        const uint32_t old_count = old_gen.file_header->collection_array_count.load(std::memory_order_acquire);
+        for (uint32_t i = new_gen->file_header->collection_array_count.load(std::memory_order_acquire); i < old_count; ++i)
+        {
+            init_collection(*new_gen, i, old_gen.get_collection_entry_ref(i).name_hash);
+            new_gen->get_collection_entry_ref(i).object_id_counter.store(old_gen.get_collection_entry_ref(i).object_id_counter.load(std::memory_order_acquire), std::memory_order_relaxed);
+            new_gen->file_header->collection_array_count.store(i + 1, std::memory_order_release);
+            ++collections_added;
+        }
+
+        // The Collection objects callers hold stay in place and take over
+        // the new generation's trees.
+        for (uint32_t i = 0; i < old_count; ++i)
+        {
+            Collection &stable_collection = *old_gen.owned_collections[i];
+            Collection &new_collection = *new_gen->owned_collections[i];
+            std::swap(stable_collection.owned_tree_, new_collection.owned_tree_);
+            std::swap(stable_collection.record_allocator_, new_collection.record_allocator_);
+            stable_collection.owning_generation_.store(new_gen.get(), std::memory_order_release);
+            new_collection.owning_generation_.store(&old_gen, std::memory_order_release);
+            stable_collection.critbit_tree_.store(stable_collection.owned_tree_.get(), std::memory_order_release);
+            new_collection.critbit_tree_.store(new_collection.owned_tree_.get(), std::memory_order_release);
+            std::swap(old_gen.owned_collections[i], new_gen->owned_collections[i]);
+        }
+        std::swap(old_gen.lock_file_handle, new_gen->lock_file_handle);
+        old_gen.path = retired_path;
+        active_generation_.store(new_gen.get(), std::memory_order_release);
+        retired_generations_.push_back({std::move(generations_.front()), epoch_manager_->get_global_epoch()});
+        generations_.front() = std::move(new_gen);
+    }
+    generation_sequence_.fetch_add(1, std::memory_order_acq_rel);
+    compaction_capture_active_.store(false, std::memory_order_release);
+    if (collections_added > 0 && durability_level_ == DurabilityLevel::Wal)
+        sync_generation(*get_active_generation());
+    compaction_recommended_.store(false, std::memory_order_relaxed);
+    commit_gate_.reopen();
+    return true;
+}
+
+void Database::release_retired_generations(bool wait_for_readers)
+{
+    if (retired_generations_.empty())
+        return;
+    epoch_manager_->reclaim(MAINTENANCE_THREAD_SLOT);
+    const uint64_t epoch = epoch_manager_->get_global_epoch();
+    for (RetiredGeneration &retired : retired_generations_)
+    {
+        if (!retired.generation->mmap_base || (wait_for_readers && retired.epoch + 2 > epoch))
+            continue;
+        // Everything in it is in the new file already.
+        retired.generation->file_header = nullptr;
+        retired.generation->unmap_file();
+        std::error_code ec;
+        std::filesystem::remove(retired.generation->path, ec);
+        if (ec)
+            std::cerr << "Warning: Failed to remove the compacted-away file '" << retired.generation->path << "': " << ec.message() << std::endl;
+    }
+}
+
+StaxStats::DatabaseStatisticsCollector Database::get_statistics_collector()
+{
+    return StaxStats::DatabaseStatisticsCollector(this);
+}
+
+TxnContext Database::begin_transaction_context(size_t thread_id, bool is_read_only)
+{
+    // Read first, so a context that sees the current sequence writes through
+    // the trees swapped in with it.
+    const uint64_t generation_sequence = generation_sequence_.load(std::memory_order_acquire);
+    // The floor is published before the snapshot is read, so a watermark
+    // computed concurrently is bounded by a commit no later than the snapshot.
+    const uint64_t snapshot_ticket = snapshot_registry_->register_floor(thread_id, get_last_committed_txn_id());
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const TxnID last_committed_id = get_last_committed_txn_id();
+
+    if (is_read_only)
+    {
+        return {0, last_committed_id, thread_id, snapshot_ticket, generation_sequence};
+    }
+    else
+    {
+        // Ids come from per-thread batches, so new_id can trail commits made
+        // with a later batch; reading at the newest commit then keeps the
+        // snapshot at or above the watermark.
+        TxnID new_id = get_next_txn_id();
+        return {new_id, (std::max)(new_id, last_committed_id), thread_id, snapshot_ticket, generation_sequence};
+    }
+}
+
+void Database::end_transaction_context(const TxnContext &ctx)
+{
+    snapshot_registry_->unregister(ctx.thread_id, ctx.snapshot_ticket);
+    const TxnID last_committed_id = get_last_committed_txn_id();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    snapshot_registry_->refresh_watermark(last_committed_id, num_threads_);
+}
+
+void Database::commit(const TxnContext &ctx, uint32_t collection_idx, const TransactionBatch &batch)
+{
+    const CollectionBatch collection_batch{collection_idx, &batch};
+    commit(ctx, std::span<const CollectionBatch>(&collection_batch, 1));
+}
+
+void Database::commit(const TxnContext &ctx, std::span<const CollectionBatch> batches)
+{
+    if (ctx.txn_id == 0)
+    {
+        end_transaction_context(ctx);
+        return;
+    }
+
+    // An online compaction swap waits for the commits in flight, and the pin
+    // lets it tell when every commit that missed the start of its capture
+    // has published.
+    CommitGateGuard commit_gate_guard(commit_gate_, ctx.thread_id);
+    EpochGuard epoch_guard(epoch_manager_.get(), ctx.thread_id);
+    DbGeneration *active_gen = get_active_generation();
+    if (!active_gen)
+        return;
+    if (ctx.generation_sequence != generation_sequence_.load(std::memory_order_acquire))
+        carry_over_writes(ctx, batches);
+
+    // Under Wal the group applies the counters once the frames are logged,
+    // so a checkpoint never records counters whose frames follow it.
+    if (!write_ahead_log_)
+        apply_counter_deltas(*active_gen, batches);
+
+    if (compaction_capture_active_.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(compaction_capture_mutex_);
+        append_redo_frames(compaction_capture_frames_, ctx.txn_id, batches);
+    }
+
+    if (write_ahead_log_)
+    {
+        const std::string err = commit_to_log(ctx, batches);
+        end_transaction_context(ctx);
+        if (!err.empty())
+        {
+            throw std::runtime_error("FATAL: Failed to sync the write-ahead log during durable commit: " + err);
+        }
+        return;
+    }
+
+    if (durability_level_ == DurabilityLevel::SyncOnCommit && active_gen->mmap_base)
+    {
+        const std::string err = commit_durably(*active_gen, ctx, batches);
+        end_transaction_context(ctx);
+        if (!err.empty())
+        {
+            throw std::runtime_error("FATAL: Failed to flush data to disk during durable commit: " + err);
+        }
+        return;
+    }
+
+    commit_watermark_.publish(ctx.thread_id, ctx.txn_id);
+    end_transaction_context(ctx);
+}
+
+void Database::apply_counter_deltas(DbGeneration &gen, std::span<const CollectionBatch> batches)
+{
+    for (const CollectionBatch &collection_batch : batches)
+    {
+        CollectionEntry &entry = gen.get_collection_entry_ref(collection_batch.collection_idx);
+        if (collection_batch.batch->logical_item_count_delta != 0)
+        {
+            entry.logical_item_count.fetch_add(collection_batch.batch->logical_item_count_delta, std::memory_order_relaxed);
+        }
+        if (collection_batch.batch->live_record_bytes_delta != 0)
+        {
+            entry.live_record_bytes.fetch_add(collection_batch.batch->live_record_bytes_delta, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string Database::commit_durably(DbGeneration &gen, const TxnContext &ctx, std::span<const CollectionBatch> batches)
+{
+    GroupCommitQueue::Request request;
+    request.txn_id = ctx.txn_id;
+    if (ctx.thread_id < MAX_CONCURRENT_THREADS)
+    {
+        // The group's leader flushes these along with every other slot's.
+        for (const CollectionBatch &collection_batch : batches)
+        {
+            const CollectionEntry &entry = gen.get_collection_entry_ref(collection_batch.collection_idx);
+            dirty_range_tracker_->mark(ctx.thread_id, reinterpret_cast<const uint8_t *>(&entry) - gen.mmap_base, sizeof(CollectionEntry));
+        }
+    }
+    else
+    {
+        request.ranges.emplace_back(0, gen.mmap_size);
+    }
+    return group_commit_queue_.submit(request, [&](const std::vector<GroupCommitQueue::Request *> &group)
+                                      { return flush_commit_group(gen, group); });
+}
+
+// The data pages of the whole group go first; only then is the last committed
+// id advanced and the header written, so neither readers nor a reopened file
+// ever see a commit whose pages are not on disk.
+std::string Database::flush_commit_group(DbGeneration &gen, const std::vector<GroupCommitQueue::Request *> &group)
+{
+    std::vector<DirtyRangeTracker::Range> ranges;
+    TxnID group_max_txn_id = 0;
+    for (const GroupCommitQueue::Request *request : group)
+    {
+        ranges.insert(ranges.end(), request->ranges.begin(), request->ranges.end());
+        group_max_txn_id = (std::max)(group_max_txn_id, request->txn_id);
+    }
+    if (dirty_range_tracker_)
+        dirty_range_tracker_->take_all(ranges);
+    DirtyRangeTracker::coalesce(ranges);
+
+    for (const auto &[range_begin, range_end] : ranges)
+    {
+        if (range_begin >= gen.mmap_size)
+            break;
+        std::string err = OSFileExtensions::flush_file_range_raw(gen.mmap_base + range_begin, (std::min)(range_end, static_cast<uint64_t>(gen.mmap_size)) - range_begin);
+        if (!err.empty())
+            return err;
+    }
+
+    update_last_committed_txn_id(group_max_txn_id);
+    return OSFileExtensions::flush_file_range_raw(gen.mmap_base, sizeof(FileHeader));
+}
+
+void Database::flush_maintenance_ranges(DbGeneration &gen)
+{
+    if (!dirty_range_tracker_ || !gen.mmap_base)
+        return;
+    std::vector<DirtyRangeTracker::Range> ranges;
+    dirty_range_tracker_->take(MAINTENANCE_THREAD_SLOT, ranges);
+    for (const auto &[range_begin, range_end] : ranges)
+    {
+        if (range_begin >= gen.mmap_size)
+            break;
+        std::string err = OSFileExtensions::flush_file_range_raw(gen.mmap_base + range_begin, (std::min)(range_end, static_cast<uint64_t>(gen.mmap_size)) - range_begin);
+        if (!err.empty())
+            throw std::runtime_error("Failed to flush maintenance writes: " + err);
+    }
+}
+
+void Database::sync_generation(DbGeneration &gen)
+{
+    if (durability_level_ == DurabilityLevel::NoSync || !gen.mmap_base)
+        return;
+    persist_last_committed_txn_id();
+    std::string err = OSFileExtensions::flush_file_range_raw(gen.mmap_base, gen.mmap_size);
+    if (!err.empty())
+    {
+        throw std::runtime_error("FATAL: Failed to flush data to disk: " + err);
+    }
+}
+
+// A multi-collection commit logs its frames together in one request, so one
+// group sync makes all of them durable.
+std::string Database::commit_to_log(const TxnContext &ctx, std::span<const CollectionBatch> batches)
+{
+    GroupCommitQueue::Request request;
+    request.txn_id = ctx.txn_id;
+    request.batches = batches;
+    append_redo_frames(request.log_frames, ctx.txn_id, batches);
+    return group_commit_queue_.submit(request, [this](const std::vector<GroupCommitQueue::Request *> &group)
+                                      { return flush_log_group(group); });
+}
+
+void Database::append_redo_frames(std::string &out, TxnID txn_id, std::span<const CollectionBatch> batches)
+{
+    uint32_t frames_following = static_cast<uint32_t>(std::count_if(batches.begin(), batches.end(), [](const CollectionBatch &collection_batch)
+                                                                    { return !collection_batch.batch->redo_ops.empty(); }));
+    for (const CollectionBatch &collection_batch : batches)
+    {
+        if (collection_batch.batch->redo_ops.empty())
+            continue;
+        WriteAheadLog::append_frame(out, txn_id, collection_batch.collection_idx, *collection_batch.batch, --frames_following);
+    }
+}
+
+void Database::apply_redo_frame(DbGeneration &gen, const WriteAheadLog::Frame &frame, bool may_be_applied)
+{
+    if (frame.collection_idx >= gen.owned_collections.size() || !gen.owned_collections[frame.collection_idx])
+    {
+        std::cerr << "Warning: Skipping write-ahead log frame for unknown collection " << frame.collection_idx << "." << std::endl;
+        return;
+    }
+    StaxTree &tree = gen.owned_collections[frame.collection_idx]->get_critbit_tree();
+    const TxnContext replay_ctx{frame.txn_id, frame.txn_id, 0};
+    const TxnContext latest_ctx{0, SnapshotRegistry::NO_FLOOR, 0};
+    int64_t logical_item_count_delta = may_be_applied ? 0 : frame.logical_item_count_delta;
+    int64_t live_record_bytes_delta = may_be_applied ? 0 : frame.live_record_bytes_delta;
+    auto replay_op = [&](bool is_remove, std::string_view key, std::string_view value)
+    {
+        const bool was_live = may_be_applied && tree.get(latest_ctx, key).has_value();
+        if (is_remove)
+        {
+            tree.remove(replay_ctx, key);
+            if (was_live)
+                logical_item_count_delta--;
+        }
+        else
+        {
+            tree.insert(replay_ctx, key, value);
+            if (may_be_applied)
+            {
+                logical_item_count_delta += was_live ? 0 : 1;
+                live_record_bytes_delta += key.length() + value.length() + CollectionRecordAllocator::HEADER_SIZE;
+            }
+        }
+    };
+    WriteAheadLog::for_each_op(frame.redo_ops, replay_op);
+
+    CollectionEntry &entry = gen.get_collection_entry_ref(frame.collection_idx);
+    entry.logical_item_count.fetch_add(logical_item_count_delta, std::memory_order_relaxed);
+    entry.live_record_bytes.fetch_add(live_record_bytes_delta, std::memory_order_relaxed);
+}
+
+// The writes made before the swap went to the old generation's trees. Those
+// made after it are already in the new ones and are simply written again;
+// the batch's deltas are applied by the commit as usual.
+void Database::carry_over_writes(const TxnContext &ctx, std::span<const CollectionBatch> batches)
+{
+    for (const CollectionBatch &collection_batch : batches)
+    {
+        StaxTree &tree = get_collection_by_idx(collection_batch.collection_idx).get_critbit_tree();
+        auto replay_op = [&](bool is_remove, std::string_view key, std::string_view value)
+        {
+            if (is_remove)
+                tree.remove(ctx, key);
+            else
+                tree.insert(ctx, key, value);
+        };
+        WriteAheadLog::for_each_op(collection_batch.batch->redo_ops, replay_op);
+    }
+}
+
+std::string Database::flush_log_group(const std::vector<GroupCommitQueue::Request *> &group)
+{
+    std::string frames;
+    TxnID group_max_txn_id = 0;
+    for (const GroupCommitQueue::Request *request : group)
+    {
+        frames += request->log_frames;
+        group_max_txn_id = (std::max)(group_max_txn_id, request->txn_id);
+    }
+    if (!frames.empty())
+    {
+        std::string err = write_ahead_log_->append_and_sync(frames);
+        if (!err.empty())
+            return err;
+    }
+
+    DbGeneration *active_gen = get_active_generation();
+    for (const GroupCommitQueue::Request *request : group)
+        apply_counter_deltas(*active_gen, request->batches);
+    update_last_committed_txn_id(group_max_txn_id);
+    if (write_ahead_log_->get_size() >= WAL_CHECKPOINT_LOG_BYTES)
+        librarian_->request_run("wal_checkpoint");
+    return "";
+}
+
+void Database::open_write_ahead_log()
+{
+    const std::filesystem::path log_path = base_directory_ / "data.wal";
+    if (durability_level_ != DurabilityLevel::Wal && !std::filesystem::exists(log_path))
+        return;
+
+    DbGeneration *active_gen = get_active_generation();
+    auto log = std::make_unique<WriteAheadLog>(log_path);
+    TxnID max_replayed_txn_id = 0;
+    bool counts_restored = false;
+    auto replay_frame = [&](const WriteAheadLog::Frame &frame)
+    {
+        // The entries may hold deltas of frames already on disk; replay
+        // counts from the checkpoint the log starts at.
+        if (!counts_restored)
+        {
+            restore_checkpointed_counts(*active_gen);
+            counts_restored = true;
+        }
+        apply_redo_frame(*active_gen, frame);
+        max_replayed_txn_id = (std::max)(max_replayed_txn_id, frame.txn_id);
+    };
+    const size_t txns_replayed = log->replay(replay_frame);
+
+    if (txns_replayed > 0)
+    {
+        update_last_committed_txn_id(max_replayed_txn_id);
+        std::cerr << "Recovered " << txns_replayed << " commits from the write-ahead log." << std::endl;
+    }
+
+    write_ahead_log_ = std::move(log);
+    const std::string err = checkpoint_write_ahead_log();
+    if (!err.empty())
+    {
+        throw std::runtime_error("Failed to checkpoint the replayed write-ahead log: " + err);
+    }
+
+    if (durability_level_ != DurabilityLevel::Wal)
+    {
+        write_ahead_log_.reset();
+        std::filesystem::remove(log_path);
+    }
+}
+
+// The first flush runs alongside commits: everything logged by then is
+// already in the mapping. The second runs with commits held off, so it only
+// writes what they dirtied meanwhile, and the log is emptied right after.
+std::string Database::checkpoint_write_ahead_log()
+{
+    DbGeneration *active_gen = get_active_generation();
+    if (!active_gen || !active_gen->mmap_base)
+        return "";
+
+    std::string err = OSFileExtensions::flush_file_range_raw(active_gen->mmap_base, active_gen->mmap_size);
+    if (!err.empty())
+        return err;
+    // Until the truncate the old log replays onto the previous checkpoint's
+    // counts; after it, the empty log leaves the flushed entries as they are.
+    group_commit_queue_.run_exclusive([&]
+                                      {
+        err = OSFileExtensions::flush_file_range_raw(active_gen->mmap_base, active_gen->mmap_size);
+        if (err.empty())
+            err = write_ahead_log_->truncate();
+        if (err.empty())
+        {
+            record_checkpointed_counts(*active_gen);
+            err = OSFileExtensions::flush_file_range_raw(active_gen->mmap_base, sizeof(FileHeader));
+        } });
+    return err;
+}
+
+void Database::record_checkpointed_counts(DbGeneration &gen)
+{
+    const uint32_t collection_count = gen.file_header->collection_array_count.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < collection_count; ++i)
+    {
+        const CollectionEntry &entry = gen.get_collection_entry_ref(i);
+        gen.file_header->checkpointed_counts[i] = {entry.logical_item_count.load(std::memory_order_relaxed), entry.live_record_bytes.load(std::memory_order_relaxed)};
+    }
+}
+
+void Database::restore_checkpointed_counts(DbGeneration &gen)
+{
+    const uint32_t collection_count = gen.file_header->collection_array_count.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < collection_count; ++i)
+    {
+        CollectionEntry &entry = gen.get_collection_entry_ref(i);
+        entry.logical_item_count.store(gen.file_header->checkpointed_counts[i].logical_item_count, std::memory_order_relaxed);
+        entry.live_record_bytes.store(gen.file_header->checkpointed_counts[i].live_record_bytes, std::memory_order_relaxed);
+    }
+}
+
+void Database::checkpoint()
+{
+    if (durability_level_ != DurabilityLevel::Wal || !write_ahead_log_)
+        return;
+    const std::string err = checkpoint_write_ahead_log();
+    if (!err.empty())
+    {
+        throw std::runtime_error("Checkpoint failed: " + err);
+    }
+}
+
+void Database::start_librarian()
+{
+    if (write_ahead_log_)
+    {
+        librarian_->add_task("wal_checkpoint", std::chrono::milliseconds(WAL_CHECKPOINT_INTERVAL_MS), [this](Librarian::Budget &)
+                             {
+            if (write_ahead_log_->get_size() == 0)
+                return;
+            const std::string err = checkpoint_write_ahead_log();
+            if (!err.empty())
+                throw std::runtime_error("Background checkpoint failed: " + err); }, true);
+    }
+    if (durability_level_ == DurabilityLevel::Periodic)
+    {
+        librarian_->add_task("periodic_flush", std::chrono::milliseconds(PERIODIC_FLUSH_INTERVAL_MS), [this](Librarian::Budget &)
+                             {
+            if (DbGeneration *active_gen = get_active_generation())
+                sync_generation(*active_gen); }, true);
+    }
+
+    // Sweeps one collection at a time, resuming where the last wake-up ran
+    // out of budget. The cuts reach the disk before the versions they free
+    // can be reclaimed and reused.
+    librarian_->add_task("version_gc", std::chrono::milliseconds(LIBRARIAN_VERSION_GC_INTERVAL_MS),
+                         [this, next_collection = size_t{0}, resume_key = std::string()](Librarian::Budget &budget) mutable
+                         {
+        const std::vector<Collection *> collections = get_active_collections();
+        size_t versions_cut = 0;
+        size_t collections_swept = 0;
+        while (collections_swept < collections.size() && budget.has_time())
+        {
+            if (next_collection >= collections.size())
+                next_collection = 0;
+            versions_cut += collections[next_collection]->get_critbit_tree().prune_version_chains(MAINTENANCE_THREAD_SLOT, resume_key, LIBRARIAN_VERSION_GC_KEYS_PER_STEP);
+            if (resume_key.empty())
+            {
+                ++next_collection;
+                ++collections_swept;
+            }
+        }
+        DbGeneration *active_gen = get_active_generation();
+        if (versions_cut > 0 && active_gen)
+            flush_maintenance_ranges(*active_gen);
+        epoch_manager_->reclaim(MAINTENANCE_THREAD_SLOT); });
+
+    librarian_->add_task("statistics", std::chrono::milliseconds(LIBRARIAN_STATISTICS_INTERVAL_MS), [this](Librarian::Budget &)
+                         {
+        auto stats = std::make_shared<const StaxStats::DatabaseStats>(StaxStats::DatabaseStatisticsCollector(this).get_database_summary_stats());
+        std::lock_guard<std::mutex> lock(cached_statistics_mutex_);
+        cached_statistics_ = std::move(stats); });
+
+    // Compaction itself runs on its own thread; its swap waits for the
+    // librarian's tasks to finish.
+    librarian_->add_task("compaction_check", std::chrono::milliseconds(LIBRARIAN_COMPACTION_CHECK_INTERVAL_MS), [this](Librarian::Budget &)
+                         {
+        release_retired_generations();
+        const std::shared_ptr<const StaxStats::DatabaseStats> stats = get_cached_statistics();
+        if (!stats)
+            return;
+        const uint64_t allocated_bytes = stats->total_logical_allocated_bytes;
+        compaction_recommended_.store(allocated_bytes >= LIBRARIAN_COMPACTION_MIN_BYTES &&
+                                          stats->total_live_data_bytes * 100 < allocated_bytes * LIBRARIAN_COMPACTION_LIVE_PERCENT,
+                                      std::memory_order_relaxed);
+        if (!compaction_recommended_.load(std::memory_order_relaxed) || online_compaction_running_.load(std::memory_order_acquire) ||
+            online_compaction_cancelled_.load(std::memory_order_relaxed) ||
+            std::chrono::steady_clock::now().time_since_epoch().count() < online_compaction_retry_after_.load(std::memory_order_relaxed))
+            return;
+        if (online_compaction_thread_.joinable())
+            online_compaction_thread_.join();
+        online_compaction_running_.store(true, std::memory_order_release);
+        online_compaction_thread_ = std::thread([this]
+                                                {
+            bool compacted = false;
+            try
+            {
+                compacted = compact_online();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Warning: Online compaction failed: " << e.what() << std::endl;
+            }
+            // A failed attempt copied the live data for nothing; the
+            // transactions that held it off are likely still around.
+            if (!compacted)
+                online_compaction_retry_after_.store((std::chrono::steady_clock::now() + std::chrono::milliseconds(ONLINE_COMPACTION_RETRY_BACKOFF_MS)).time_since_epoch().count(),
+                                                     std::memory_order_relaxed);
+            online_compaction_running_.store(false, std::memory_order_release); }); });
+
+    librarian_->add_task("prefetch", std::chrono::milliseconds(LIBRARIAN_PREFETCH_INTERVAL_MS), [this](Librarian::Budget &budget)
+                         {
+        for (Collection *collection : get_active_collections())
+        {
+            if (budget.exhausted())
+                return;
+            const uint64_t max_bytes = (std::min)(budget.get_io_bytes_remaining(), static_cast<uint64_t>(LIBRARIAN_PREFETCH_BYTES_PER_COLLECTION));
+            budget.charge_io(collection->get_critbit_tree().prefetch_top_levels(MAINTENANCE_THREAD_SLOT, max_bytes));
+        } });
+
+    librarian_->start();
+}
+
+std::vector<Collection *> Database::get_active_collections()
 {
+    std::vector<Collection *> collections;
+    UniqueSpinLockGuard lock(generations_lock_);
+    if (generations_.empty())
+        return collections;
+    for (const auto &collection : generations_.front()->owned_collections)
+    {
+        if (collection)
+            collections.push_back(collection.get());
+    }
+    return collections;
+}
+
+std::shared_ptr<const StaxStats::DatabaseStats> Database::get_cached_statistics() const
+{
+    std::lock_guard<std::mutex> lock(cached_statistics_mutex_);
+    return cached_statistics_;
+}
+
+void Database::abort(const TxnContext &ctx)
+{
+    end_transaction_context(ctx);
+}
+
+MultiCollectionTransaction::MultiCollectionTransaction(Database *db, size_t thread_id)
+    : db_(db), ctx_(db->begin_transaction_context(thread_id, false))
+{
+}
+
+MultiCollectionTransaction::~MultiCollectionTransaction()
+{
+    if (!is_finished_)
+        abort();
+}
+
+void MultiCollectionTransaction::insert(Collection &col, std::string_view key, std::string_view value)
+{
+    col.insert(ctx_, get_batch(col.get_id()), key, value);
+}
+
+void MultiCollectionTransaction::remove(Collection &col, std::string_view key)
+{
+    col.remove(ctx_, get_batch(col.get_id()), key);
+}
+
+std::optional<RecordData> MultiCollectionTransaction::get(Collection &col, std::string_view key)
+{
+    return col.get(ctx_, key);
+}
+
+void MultiCollectionTransaction::commit()
+{
+    if (is_finished_)
+        return;
+    std::vector<CollectionBatch> batches;
+    batches.reserve(batches_.size());
+    for (const auto &[collection_idx, batch] : batches_)
+        batches.push_back({collection_idx, &batch});
+    db_->commit(ctx_, batches);
+    is_finished_ = true;
+}
+
+void MultiCollectionTransaction::abort()
+{
+    if (is_finished_)
+        return;
+    db_->abort(ctx_);
+    is_finished_ = true;
 }
 
 Collection::Collection(Database *parent_db, DbGeneration *owning_generation, uint32_t collection_idx, CollectionRecordAllocator &record_allocator)
     : parent_db_(parent_db), owning_generation_(owning_generation), collection_idx_(collection_idx), record_allocator_(&record_allocator)
 {
-    CollectionEntry &entry = owning_generation_->get_collection_entry_ref(collection_idx);
+    CollectionEntry &entry = owning_generation->get_collection_entry_ref(collection_idx);
 
-    critbit_tree_ = std::make_unique<StaxTree>(
-        *owning_generation_->internal_node_allocator,
+    owned_tree_ = std::make_unique<StaxTree>(
+        *owning_generation->internal_node_allocator,
         *record_allocator_,
-        entry.root_node_ptr);
+        entry.root_node_ptr,
+        parent_db_->get_epoch_manager(),
+        parent_db_->get_snapshot_registry(),
+        parent_db_->dirty_range_tracker_.get());
+    critbit_tree_.store(owned_tree_.get(), std::memory_order_release);
+
+    if (owning_generation->file_header->order_statistics_collection_mask.load(std::memory_order_acquire) & (1ULL << collection_idx_))
+    {
+        owned_tree_->enable_order_statistics();
+    }
+
+    const uint64_t hash_index_offset = owning_generation->file_header->hash_index_offsets[collection_idx_].load(std::memory_order_acquire);
+    if (hash_index_offset != 0)
+    {
+        owned_tree_->attach_hash_index(reinterpret_cast<HashIndexHeader *>(owning_generation->mmap_base + hash_index_offset), false);
+    }
+}
+
+void Collection::enable_order_statistics()
+{
+    DbGeneration &gen = *owning_generation_.load(std::memory_order_acquire);
+    get_critbit_tree().enable_order_statistics();
+    gen.file_header->order_statistics_collection_mask.fetch_or(1ULL << collection_idx_, std::memory_order_acq_rel);
+    parent_db_->sync_generation(gen);
+}
+
+void Collection::enable_hash_index(size_t expected_keys)
+{
+    if (get_critbit_tree().has_hash_index())
+        return;
+
+    DbGeneration &gen = *owning_generation_.load(std::memory_order_acquire);
+    const uint64_t item_count = gen.get_collection_entry_ref(collection_idx_).logical_item_count.load(std::memory_order_relaxed);
+    const uint64_t capacity = std::bit_ceil(2 * std::max<uint64_t>({expected_keys, item_count, HASH_INDEX_MIN_CAPACITY}));
+    const size_t index_size = sizeof(HashIndexHeader) + capacity * sizeof(uint64_t);
+
+    const uint64_t index_offset = parent_db_->allocate_data_chunk(index_size);
+    std::memset(gen.mmap_base + index_offset, 0, index_size);
+    HashIndexHeader *index = reinterpret_cast<HashIndexHeader *>(gen.mmap_base + index_offset);
+    index->capacity = capacity;
+
+    get_critbit_tree().attach_hash_index(index, true);
+    gen.file_header->hash_index_offsets[collection_idx_].store(index_offset, std::memory_order_release);
+    parent_db_->sync_generation(gen);
 }
 
 TxnContext Collection::begin_transaction_context(size_t thread_id, bool is_read_only)
@@ -930,28 +2126,61 @@ void Collection::insert(const TxnContext &ctx, TransactionBatch &batch, std::str
 {
     if (ctx.txn_id == 0)
         throw std::runtime_error("Cannot perform writes in a read-only transaction context.");
-    critbit_tree_->insert(ctx, key, value);
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), ctx.thread_id);
+    const bool records_redo_ops = parent_db_->records_redo_ops();
+    get_critbit_tree().insert(ctx, key, value);
     batch.logical_item_count_delta++;
     batch.live_record_bytes_delta += (key.length() + value.length() + CollectionRecordAllocator::HEADER_SIZE);
+    if (records_redo_ops)
+        WriteAheadLog::append_insert(batch.redo_ops, key, value);
+}
+
+void Collection::insert_batch(const TxnContext &ctx, TransactionBatch &batch, const CoreKVPair *kv_pairs, size_t num_kvs)
+{
+    if (ctx.txn_id == 0)
+        throw std::runtime_error("Cannot perform writes in a read-only transaction context.");
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), ctx.thread_id);
+    const bool records_redo_ops = parent_db_->records_redo_ops();
+    get_critbit_tree().insert_batch(ctx, kv_pairs, num_kvs, batch);
+    if (records_redo_ops)
+    {
+        for (size_t i = 0; i < num_kvs; ++i)
+            WriteAheadLog::append_insert(batch.redo_ops, kv_pairs[i].key, kv_pairs[i].value);
+    }
 }
 
 void Collection::remove(const TxnContext &ctx, TransactionBatch &batch, std::string_view key)
 {
     if (ctx.txn_id == 0)
         throw std::runtime_error("Cannot perform writes in a read-only transaction context.");
-    critbit_tree_->remove(ctx, key);
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), ctx.thread_id);
+    const bool records_redo_ops = parent_db_->records_redo_ops();
+    get_critbit_tree().remove(ctx, key);
     batch.logical_item_count_delta--;
+    if (records_redo_ops)
+        WriteAheadLog::append_remove(batch.redo_ops, key);
 }
 
 std::optional<RecordData> Collection::get(const TxnContext &ctx, std::string_view key)
 {
-    for (const auto &gen_ptr : parent_db_->get_generations())
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), ctx.thread_id);
+    const auto &generations = parent_db_->get_generations();
+    // The newest generation holding the key decides, tombstone or not.
+    const bool keeps_tombstones = generations.size() > 1;
+    for (size_t i = 0; i < generations.size(); ++i)
     {
-        if (collection_idx_ < gen_ptr->owned_collections.size() && gen_ptr->owned_collections[collection_idx_])
+        // Online compaction replaces the front generation while readers run;
+        // its collections are reached through the stable objects instead.
+        Collection *collection = i == 0 ? parent_db_->get_active_collection(collection_idx_) : nullptr;
+        if (i != 0 && collection_idx_ < generations[i]->owned_collections.size())
+            collection = generations[i]->owned_collections[collection_idx_].get();
+        if (collection)
         {
-            auto result = gen_ptr->owned_collections[collection_idx_]->get_critbit_tree().get(ctx, key);
+            auto result = collection->get_critbit_tree().get(ctx, key, keeps_tombstones);
             if (result.has_value())
             {
+                if (result->is_deleted)
+                    return std::nullopt;
                 return result;
             }
         }
@@ -963,9 +2192,13 @@ void Collection::insert_sync_direct(std::string_view key, std::string_view value
 {
     TxnContext ctx = parent_db_->begin_transaction_context(thread_id, false);
     TransactionBatch batch;
-    critbit_tree_->insert(ctx, key, value);
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), thread_id);
+    const bool records_redo_ops = parent_db_->records_redo_ops();
+    get_critbit_tree().insert(ctx, key, value);
     batch.logical_item_count_delta++;
     batch.live_record_bytes_delta += (key.length() + value.length() + CollectionRecordAllocator::HEADER_SIZE);
+    if (records_redo_ops)
+        WriteAheadLog::append_insert(batch.redo_ops, key, value);
     parent_db_->commit(ctx, collection_idx_, batch);
 }
 
@@ -973,8 +2206,12 @@ void Collection::remove_sync_direct(std::string_view key, size_t thread_id)
 {
     TxnContext ctx = parent_db_->begin_transaction_context(thread_id, false);
     TransactionBatch batch;
-    critbit_tree_->remove(ctx, key);
+    EpochGuard epoch_guard(parent_db_->get_epoch_manager(), thread_id);
+    const bool records_redo_ops = parent_db_->records_redo_ops();
+    get_critbit_tree().remove(ctx, key);
     batch.logical_item_count_delta--;
+    if (records_redo_ops)
+        WriteAheadLog::append_remove(batch.redo_ops, key);
     parent_db_->commit(ctx, collection_idx_, batch);
 }
 
@@ -988,6 +2225,69 @@ std::unique_ptr<DBCursor> Collection::seek_first(const TxnContext &ctx, std::opt
     return std::make_unique<DBCursor>(parent_db_, ctx, collection_idx_, "", end_key);
 }
 
+std::unique_ptr<DBCursor> Collection::seek_for_prev(const TxnContext &ctx, std::string_view last_key, std::optional<std::string_view> start_key)
+{
+    return std::make_unique<DBCursor>(parent_db_, ctx, collection_idx_, ReverseSeek{last_key}, start_key);
+}
+
+std::unique_ptr<DBCursor> Collection::seek_last(const TxnContext &ctx, std::optional<std::string_view> start_key)
+{
+    return std::make_unique<DBCursor>(parent_db_, ctx, collection_idx_, ReverseSeek{std::nullopt}, start_key);
+}
+
+void Collection::parallel_scan(const TxnContext &ctx, std::string_view start_key, std::optional<std::string_view> end_key, size_t num_partitions,
+                               const std::function<void(size_t partition_index, DBCursor &cursor)> &visitor)
+{
+    const uint64_t item_count = owning_generation_.load(std::memory_order_acquire)->get_collection_entry_ref(collection_idx_).logical_item_count.load(std::memory_order_relaxed);
+    num_partitions = (std::min)(num_partitions, static_cast<size_t>(item_count / PARALLEL_SCAN_MIN_KEYS_PER_PARTITION) + 1);
+
+    std::vector<std::string> boundaries;
+    {
+        EpochGuard epoch_guard(parent_db_->get_epoch_manager(), ctx.thread_id);
+        get_critbit_tree().partition_key_space(start_key, end_key, num_partitions, boundaries);
+    }
+
+    std::vector<std::string_view> partition_starts{start_key};
+    partition_starts.insert(partition_starts.end(), boundaries.begin(), boundaries.end());
+
+    auto scan_partition = [&](size_t partition_index)
+    {
+        std::optional<std::string_view> partition_end = (partition_index + 1 < partition_starts.size()) ? std::optional<std::string_view>(partition_starts[partition_index + 1]) : end_key;
+        auto cursor = seek(ctx, partition_starts[partition_index], partition_end);
+        visitor(partition_index, *cursor);
+    };
+
+    if (partition_starts.size() == 1)
+    {
+        scan_partition(0);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(partition_starts.size());
+    std::vector<std::thread> workers;
+    workers.reserve(partition_starts.size());
+    for (size_t i = 0; i < partition_starts.size(); ++i)
+    {
+        workers.emplace_back([&, i]()
+                             {
+            try
+            {
+                scan_partition(i);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            } });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    for (auto &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
 std::unique_ptr<DBCursor> Collection::seek_raw(const TxnContext &ctx, std::string_view start_key, std::optional<std::string_view> end_key)
 {
     return std::make_unique<DBCursor>(parent_db_, ctx, &this->get_critbit_tree(), start_key, end_key, true);
@@ -1025,19 +2325,44 @@ void NodeAllocator<T>::request_new_chunk(size_t thread_id)
 template <typename T>
 uint64_t NodeAllocator<T>::allocate(size_t thread_id)
 {
-    if (!thread_local_free_list.empty())
-    {
-        uint64_t recycled_byte_offset = thread_local_free_list.back();
-        thread_local_free_list.pop_back();
-        return recycled_byte_offset;
-    }
+    uint64_t node_byte_offset;
+    if (thread_id >= MAX_CONCURRENT_THREADS || !free_pool_.pop(thread_id, align_up(sizeof(StaxTreeNode), 8), node_byte_offset))
+        node_byte_offset = allocate_bytes(thread_id, sizeof(StaxTreeNode));
+    parent_db_->mark_dirty_range(thread_id, node_byte_offset, sizeof(StaxTreeNode));
+    return node_byte_offset;
+}
 
+template <typename T>
+uint64_t NodeAllocator<T>::allocate_span_node(size_t thread_id, bool wide, uint32_t bit_index)
+{
+    const size_t fanout = wide ? 256 : 16;
+    const size_t node_size = align_up(wide ? sizeof(StaxSpanNode256) : sizeof(StaxSpanNode16), 8);
+    uint64_t node_byte_offset;
+    if (thread_id >= MAX_CONCURRENT_THREADS || !free_pool_.pop(thread_id, node_size, node_byte_offset))
+        node_byte_offset = allocate_bytes(thread_id, node_size);
+    parent_db_->mark_dirty_range(thread_id, node_byte_offset, node_size);
+    set_bit_index(node_byte_offset, bit_index);
+    for (size_t slot = 0; slot < fanout; ++slot)
+    {
+        get_span_child_ptr(node_byte_offset, static_cast<uint32_t>(slot)).store(0, std::memory_order_relaxed);
+    }
+    return node_byte_offset;
+}
+
+template <typename T>
+void NodeAllocator<T>::deallocate_span_node(size_t thread_id, uint64_t node_byte_offset, bool wide)
+{
+    free_pool_.push(thread_id, node_byte_offset, align_up(wide ? sizeof(StaxSpanNode256) : sizeof(StaxSpanNode16), 8));
+}
+
+template <typename T>
+uint64_t NodeAllocator<T>::allocate_bytes(size_t thread_id, size_t node_size)
+{
     if (thread_id >= MAX_CONCURRENT_THREADS)
     {
         throw std::out_of_range("Thread ID exceeds configured number of threads for NodeAllocator.");
     }
 
-    const size_t node_size = sizeof(StaxTreeNode);
     const size_t aligned_node_size = NodeAllocator<T>::align_up(node_size, 8);
 
     for (int i = 0; i < 2; ++i)
@@ -1056,11 +2381,11 @@ uint64_t NodeAllocator<T>::allocate(size_t thread_id)
 }
 
 template <typename T>
-void NodeAllocator<T>::deallocate(uint64_t node_byte_offset)
+void NodeAllocator<T>::deallocate(size_t thread_id, uint64_t node_byte_offset)
 {
     if (node_byte_offset == NIL_INDEX)
         return;
-    thread_local_free_list.push_back(node_byte_offset);
+    free_pool_.push(thread_id, node_byte_offset, align_up(sizeof(StaxTreeNode), 8));
 }
 
 template <typename T>
@@ -1117,6 +2442,14 @@ void *CollectionRecordAllocator::reserve_record_space(size_t thread_id, size_t k
 
     const size_t total_record_size = get_allocated_record_size(key_len, value_len);
 
+    uint64_t recycled_byte_offset;
+    if (free_pool_.pop(thread_id, total_record_size, recycled_byte_offset))
+    {
+        out_record_rel_offset = static_cast<uint32_t>(recycled_byte_offset / OFFSET_GRANULARITY);
+        parent_db_->mark_dirty_range(thread_id, recycled_byte_offset, total_record_size);
+        return mmap_base_addr_ + recycled_byte_offset;
+    }
+
     for (int i = 0; i < 2; ++i)
     {
         ThreadLocalBuffer &tlab = thread_tlabs_[thread_id];
@@ -1128,6 +2461,7 @@ void *CollectionRecordAllocator::reserve_record_space(size_t thread_id, size_t k
             uint64_t byte_offset_from_base = absolute_record_addr - reinterpret_cast<uint64_t>(mmap_base_addr_);
 
             out_record_rel_offset = static_cast<uint32_t>(byte_offset_from_base / OFFSET_GRANULARITY);
+            parent_db_->mark_dirty_range(thread_id, byte_offset_from_base, total_record_size);
             return reinterpret_cast<void *>(absolute_record_addr);
         }
         allocate_new_tlab(thread_id, total_record_size);
@@ -1136,4 +2470,306 @@ void *CollectionRecordAllocator::reserve_record_space(size_t thread_id, size_t k
     throw std::runtime_error("CollectionRecordAllocator: Persistent out of space after attempting to get a new chunk.");
 }
 
+void CollectionRecordAllocator::release_record_space(size_t thread_id, uint32_t rel_offset, size_t key_len, size_t value_len)
+{
+    if (rel_offset == NIL_RECORD_OFFSET)
+        return;
+    free_pool_.push(thread_id, static_cast<uint64_t>(rel_offset) * OFFSET_GRANULARITY, get_allocated_record_size(key_len, value_len));
+}
+
+void FreeBlockPool::push(size_t thread_id, uint64_t byte_offset, size_t size_bytes)
+{
+    if (thread_id > MAINTENANCE_THREAD_SLOT || !is_pooled_size(size_bytes))
+        return;
+    if (thread_id == MAINTENANCE_THREAD_SLOT)
+    {
+        UniqueSpinLockGuard lock(shared_lock_);
+        if (!shared_lists_)
+            shared_lists_ = std::make_unique<SlotLists>();
+        shared_lists_->by_size_class[size_bytes / GRANULARITY - 1].push_back(byte_offset);
+        shared_block_count_.fetch_add(1, std::memory_order_relaxed);
+        pooled_bytes_.fetch_add(size_bytes, std::memory_order_relaxed);
+        return;
+    }
+    std::unique_ptr<SlotLists> &lists = slots_[thread_id];
+    if (!lists)
+        lists = std::make_unique<SlotLists>();
+    lists->by_size_class[size_bytes / GRANULARITY - 1].push_back(byte_offset);
+    pooled_bytes_.fetch_add(size_bytes, std::memory_order_relaxed);
+}
+
+bool FreeBlockPool::pop_shared(size_t size_bytes, uint64_t &out_byte_offset)
+{
+    UniqueSpinLockGuard lock(shared_lock_);
+    if (!shared_lists_)
+        return false;
+    std::vector<uint64_t> &free_list = shared_lists_->by_size_class[size_bytes / GRANULARITY - 1];
+    if (free_list.empty())
+        return false;
+    out_byte_offset = free_list.back();
+    free_list.pop_back();
+    shared_block_count_.fetch_sub(1, std::memory_order_relaxed);
+    pooled_bytes_.fetch_sub(size_bytes, std::memory_order_relaxed);
+    return true;
+}
+
+EpochManager::EpochManager() : global_epoch_(0) {}
+
+size_t EpochManager::current_thread_stripe()
+{
+    return std::hash<std::thread::id>{}(std::this_thread::get_id()) % MAX_CONCURRENT_THREADS;
+}
+
+bool EpochManager::try_advance()
+{
+    uint64_t epoch = global_epoch_.load(std::memory_order_seq_cst);
+    for (const PinCounter &pin : pins_[(epoch + 2) % 3])
+    {
+        if (pin.count.load(std::memory_order_seq_cst) != 0)
+            return false;
+    }
+    return global_epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+// A pin holds back the step two past the epoch it was taken in.
+bool EpochManager::wait_for_pins(std::chrono::milliseconds timeout)
+{
+    const uint64_t target_epoch = global_epoch_.load(std::memory_order_seq_cst) + 2;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (global_epoch_.load(std::memory_order_seq_cst) < target_epoch)
+    {
+        if (!try_advance())
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+            std::this_thread::yield();
+        }
+    }
+    return true;
+}
+
+void EpochManager::retire(size_t thread_id, FreeBlockPool &pool, uint64_t byte_offset, size_t size_bytes)
+{
+    if (thread_id > MAINTENANCE_THREAD_SLOT || !FreeBlockPool::is_pooled_size(size_bytes))
+        return;
+    std::vector<RetiredBlock> &blocks = retired_[thread_id].blocks;
+    blocks.push_back({&pool, byte_offset, size_bytes, global_epoch_.load(std::memory_order_seq_cst)});
+    if (blocks.size() >= EPOCH_RECLAIM_BATCH_SIZE)
+        reclaim(thread_id);
+}
+
+void EpochManager::reclaim(size_t thread_id)
+{
+    try_advance();
+    const uint64_t current_epoch = global_epoch_.load(std::memory_order_acquire);
+    std::vector<RetiredBlock> &blocks = retired_[thread_id].blocks;
+    auto still_reachable = std::partition(blocks.begin(), blocks.end(), [&](const RetiredBlock &block)
+                                          { return block.epoch + 2 > current_epoch; });
+    for (auto it = still_reachable; it != blocks.end(); ++it)
+    {
+        it->pool->push(thread_id, it->byte_offset, it->size_bytes);
+    }
+    blocks.erase(still_reachable, blocks.end());
+}
+
+uint64_t SnapshotRegistry::register_floor(size_t thread_id, TxnID floor)
+{
+    Slot &slot = slots_[thread_id % MAX_CONCURRENT_THREADS];
+    const uint64_t sequence = next_ticket_sequence_.fetch_add(1, std::memory_order_relaxed) << 8;
+    for (size_t entry_index = 0; entry_index < slot.entries.size(); ++entry_index)
+    {
+        Entry &entry = slot.entries[entry_index];
+        uint64_t expected = 0;
+        if (entry.ticket.load(std::memory_order_relaxed) != 0 ||
+            !entry.ticket.compare_exchange_strong(expected, sequence | entry_index, std::memory_order_acq_rel, std::memory_order_relaxed))
+            continue;
+        // A watermark scan that sees the claim before this store is bounded
+        // by a commit read before the caller's snapshot.
+        entry.floor.store(floor, std::memory_order_release);
+        return sequence | entry_index;
+    }
+
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    spilled_floors_.emplace_back(sequence | SPILLED_ENTRY_INDEX, floor);
+    spilled_count_.store(spilled_floors_.size(), std::memory_order_release);
+    return sequence | SPILLED_ENTRY_INDEX;
+}
+
+void SnapshotRegistry::unregister(size_t thread_id, uint64_t ticket)
+{
+    if (ticket == 0)
+        return;
+    if ((ticket & ENTRY_INDEX_MASK) != SPILLED_ENTRY_INDEX)
+    {
+        Entry &entry = slots_[thread_id % MAX_CONCURRENT_THREADS].entries[ticket & ENTRY_INDEX_MASK];
+        uint64_t expected = ticket;
+        entry.ticket.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(spill_mutex_);
+    auto spilled = std::find_if(spilled_floors_.begin(), spilled_floors_.end(), [ticket](const auto &pair) { return pair.first == ticket; });
+    if (spilled == spilled_floors_.end())
+        return;
+    *spilled = spilled_floors_.back();
+    spilled_floors_.pop_back();
+    spilled_count_.store(spilled_floors_.size(), std::memory_order_release);
+}
+
+void SnapshotRegistry::refresh_watermark(TxnID last_committed, size_t num_slots)
+{
+    TxnID lowest_floor = last_committed;
+    if (spilled_count_.load(std::memory_order_acquire) != 0)
+    {
+        std::lock_guard<std::mutex> lock(spill_mutex_);
+        for (const auto &spilled : spilled_floors_)
+            lowest_floor = (std::min)(lowest_floor, spilled.second);
+    }
+    for (size_t slot_index = 0; slot_index < num_slots && slot_index < MAX_CONCURRENT_THREADS; ++slot_index)
+    {
+        for (const Entry &entry : slots_[slot_index].entries)
+        {
+            if (entry.ticket.load(std::memory_order_acquire) != 0)
+                lowest_floor = (std::min)(lowest_floor, entry.floor.load(std::memory_order_relaxed));
+        }
+    }
+
+    // Any watermark computed this way stays safe, since later snapshots
+    // start at or above the commit it was bounded by; keep the highest.
+    TxnID watermark = watermark_.load(std::memory_order_relaxed);
+    while (lowest_floor > watermark && !watermark_.compare_exchange_weak(watermark, lowest_floor, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool SnapshotRegistry::has_floor_before(uint64_t ticket, size_t num_slots)
+{
+    if (spilled_count_.load(std::memory_order_acquire) != 0)
+    {
+        std::lock_guard<std::mutex> lock(spill_mutex_);
+        for (const auto &spilled : spilled_floors_)
+        {
+            if (spilled.first < ticket)
+                return true;
+        }
+    }
+    for (size_t slot_index = 0; slot_index < num_slots && slot_index < MAX_CONCURRENT_THREADS; ++slot_index)
+    {
+        for (const Entry &entry : slots_[slot_index].entries)
+        {
+            const uint64_t entry_ticket = entry.ticket.load(std::memory_order_acquire);
+            if (entry_ticket != 0 && entry_ticket < ticket)
+                return true;
+        }
+    }
+    return false;
+}
+
+std::string GroupCommitQueue::submit(Request &request, const FlushGroupFn &flush_group)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending_.push_back(&request);
+    while (!request.done)
+    {
+        if (flush_in_progress_)
+        {
+            group_flushed_.wait(lock);
+            continue;
+        }
+
+        flush_in_progress_ = true;
+        std::vector<Request *> group;
+        group.swap(pending_);
+        lock.unlock();
+        std::string error;
+        try
+        {
+            error = flush_group(group);
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+        }
+        lock.lock();
+
+        for (Request *member : group)
+        {
+            member->error = error;
+            member->done = true;
+        }
+        flush_in_progress_ = false;
+        flushed_group_count_.fetch_add(1, std::memory_order_relaxed);
+        group_flushed_.notify_all();
+    }
+    return request.error;
+}
+
+void GroupCommitQueue::run_exclusive(const std::function<void()> &fn)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    group_flushed_.wait(lock, [this]
+                        { return !flush_in_progress_; });
+    flush_in_progress_ = true;
+    lock.unlock();
+
+    std::exception_ptr failure;
+    try
+    {
+        fn();
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
+
+    lock.lock();
+    flush_in_progress_ = false;
+    group_flushed_.notify_all();
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+void DirtyRangeTracker::coalesce(std::vector<Range> &ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+    size_t merged_count = 0;
+    for (const Range &range : ranges)
+    {
+        if (merged_count > 0 && range.first <= ranges[merged_count - 1].second)
+            ranges[merged_count - 1].second = (std::max)(ranges[merged_count - 1].second, range.second);
+        else
+            ranges[merged_count++] = range;
+    }
+    ranges.resize(merged_count);
+}
+
+void DirtyRangeTracker::take(size_t thread_id, std::vector<Range> &out)
+{
+    out.clear();
+    if (thread_id > MAINTENANCE_THREAD_SLOT)
+        return;
+    {
+        std::lock_guard<SpinLock> lock(slots_[thread_id].lock);
+        out.swap(slots_[thread_id].ranges);
+    }
+    coalesce(out);
+}
+
+void DirtyRangeTracker::take_all(std::vector<Range> &out)
+{
+    std::vector<Range> slot_ranges;
+    for (size_t thread_id = 0; thread_id < MAX_CONCURRENT_THREADS; ++thread_id)
+    {
+        SlotRanges &slot = slots_[thread_id];
+        {
+            std::lock_guard<SpinLock> lock(slot.lock);
+            if (slot.ranges.empty())
+                continue;
+            slot_ranges.swap(slot.ranges);
+        }
+        out.insert(out.end(), slot_ranges.begin(), slot_ranges.end());
+        slot_ranges.clear();
+    }
+}
+
 template class NodeAllocator<StaxTreeNode>;
\ No newline at end of file
@@ -10,6 +10,10 @@
 #include <utility>
 #include <thread>
 #include <atomic>
+#include <functional>
+#include <map>
+#include <span>
+#include <array>
 
 #include "stax_common/os_platform_tools.h"
 #include "stax_db/arena_structs.h" 
@@ -20,6 +24,14 @@
 #include "stax_common/spin_locks.h"
 #include "stax_common/db_interfaces.h"
 #include "stax_tx/transaction.h"
+#include "stax_tx/snapshot_registry.hpp"
+#include "stax_tx/commit_watermark.hpp"
+#include "stax_tx/thread_slot_registry.hpp"
+#include "stax_tx/commit_gate.hpp"
+#include "stax_core/dirty_range_tracker.hpp"
+#include "stax_tx/group_commit.hpp"
+#include "stax_db/write_ahead_log.h"
+#include "stax_db/librarian.h"
 #include "stax_common/constants.h" 
 
 class Database;
@@ -29,6 +41,7 @@ class Collection;
 namespace StaxStats
 {
     class DatabaseStatisticsCollector;
+    struct DatabaseStats;
 }
 
 class HybridTimestampGenerator
@@ -36,17 +49,24 @@ class HybridTimestampGenerator
 public:
     HybridTimestampGenerator();
     TxnID get_next_id();
+    // Every id handed out afterwards is above id, e.g. the last commit of an
+    // earlier session.
+    void advance_past(TxnID id);
 
 private:
     std::atomic<TxnID> last_generated_id_;
+    // A thread's batch is only used with the generator it came from.
+    const uint64_t instance_id_;
 
     struct ThreadTxnIDGenerator
     {
+        uint64_t owner_instance_id_;
         TxnID current_local_id_;
         TxnID local_id_end_;
-        ThreadTxnIDGenerator() : current_local_id_(0), local_id_end_(0) {}
+        ThreadTxnIDGenerator() : owner_instance_id_(0), current_local_id_(0), local_id_end_(0) {}
     };
     static thread_local ThreadTxnIDGenerator tls_generator_;
+    static std::atomic<uint64_t> next_instance_id_;
     static constexpr size_t BATCH_SIZE = 1000;
 };
 
@@ -67,6 +87,9 @@ struct DbGeneration
 
     ~DbGeneration();
     void unmap_and_close();
+    // Unmaps and closes the data file but keeps the allocator and collection
+    // objects, which retire lists may still point into.
+    void unmap_file();
     CollectionEntry &get_collection_entry_ref(uint32_t idx) const;
 };
 
@@ -74,8 +97,8 @@ class Collection
 {
 public:
     uint32_t get_id() const { return collection_idx_; }
-    StaxTree &get_critbit_tree() { return *critbit_tree_; } 
-    const StaxTree &get_critbit_tree() const { return *critbit_tree_; }
+    StaxTree &get_critbit_tree() { return *critbit_tree_.load(std::memory_order_acquire); }
+    const StaxTree &get_critbit_tree() const { return *critbit_tree_.load(std::memory_order_acquire); }
 
     Collection(Database *parent_db, DbGeneration *owning_generation, uint32_t collection_idx, CollectionRecordAllocator &record_allocator);
 
@@ -84,33 +107,70 @@ public:
     void abort(const TxnContext &ctx);
 
     void insert(const TxnContext &ctx, TransactionBatch &batch, std::string_view key, std::string_view value);
+    void insert_batch(const TxnContext &ctx, TransactionBatch &batch, const CoreKVPair *kv_pairs, size_t num_kvs);
     void remove(const TxnContext &ctx, TransactionBatch &batch, std::string_view key);
     std::optional<RecordData> get(const TxnContext &ctx, std::string_view key);
 
+    // Keeps live-key counts in the tree nodes of this collection so that
+    // count_prefix/count_range/rank/select on its tree take one descent.
+    // The choice is persisted; call it before concurrent writers start.
+    void enable_order_statistics();
+
+    // Builds a hash index over the keys of this collection so point gets
+    // skip most of the descent. It is sized for expected_keys (or the current
+    // item count) at no more than half load. Persisted like
+    // enable_order_statistics; call it before concurrent writers start.
+    void enable_hash_index(size_t expected_keys = 0);
+
     void insert_sync_direct(std::string_view key, std::string_view value, size_t thread_id);
     void remove_sync_direct(std::string_view key, size_t thread_id);
 
     std::unique_ptr<DBCursor> seek(const TxnContext &ctx, std::string_view start_key, std::optional<std::string_view> end_key = std::nullopt);
     std::unique_ptr<DBCursor> seek_first(const TxnContext &ctx, std::optional<std::string_view> end_key = std::nullopt);
+    // Reverse cursors: positioned on the last key <= last_key (or the last key
+    // overall) and walked with prev() until a key falls below start_key.
+    std::unique_ptr<DBCursor> seek_for_prev(const TxnContext &ctx, std::string_view last_key, std::optional<std::string_view> start_key = std::nullopt);
+    std::unique_ptr<DBCursor> seek_last(const TxnContext &ctx, std::optional<std::string_view> start_key = std::nullopt);
     std::unique_ptr<DBCursor> seek_raw(const TxnContext &ctx, std::string_view start_key, std::optional<std::string_view> end_key = std::nullopt);
 
+    // Splits [start_key, end_key) into up to num_partitions disjoint ranges
+    // and runs visitor on each from its own thread, all reading ctx's
+    // snapshot. The cursors share ctx: its thread_id only picks the epoch
+    // stripe they pin, which takes pins from any thread, and reading keeps no
+    // other slot-local state. The first exception thrown by a visitor is
+    // rethrown.
+    void parallel_scan(const TxnContext &ctx, std::string_view start_key, std::optional<std::string_view> end_key, size_t num_partitions,
+                       const std::function<void(size_t partition_index, DBCursor &cursor)> &visitor);
+
 private:
     friend class Database;
     friend class DBCursor;
     friend class MergedCursorImpl;
 
     Database *parent_db_;
-    DbGeneration *owning_generation_;
+    std::atomic<DbGeneration *> owning_generation_;
     uint32_t collection_idx_;
 
-    std::unique_ptr<StaxTree> critbit_tree_;
+    // compact_online points these at the new generation's tree while
+    // transactions may be reading and writing through them. The epoch is
+    // pinned before critbit_tree_ is loaded, so the retired generation
+    // outlives every use of a tree reached through it.
+    std::unique_ptr<StaxTree> owned_tree_;
+    std::atomic<StaxTree *> critbit_tree_;
     CollectionRecordAllocator *record_allocator_;
 };
 
 enum class DurabilityLevel
 {
     NoSync,
-    SyncOnCommit
+    SyncOnCommit,
+    // Commits append redo records to data.wal and sync only the log; the data
+    // file is flushed by a background checkpointer, and the log is replayed
+    // when the database is opened again.
+    Wal,
+    // Commits return without syncing; the librarian flushes the data file
+    // every PERIODIC_FLUSH_INTERVAL_MS, which bounds what a crash can lose.
+    Periodic
 };
 
 class Database
@@ -122,6 +182,20 @@ public:
     static std::unique_ptr<Database> open_existing(const std::filesystem::path &db_directory, size_t num_threads, DurabilityLevel level = DurabilityLevel::NoSync);
     static void drop(const std::filesystem::path& db_directory);
 
+    // Flushes the data file and empties the redo log. A no-op unless the
+    // durability level is Wal.
+    void checkpoint();
+
+    // Background maintenance: durability flushes, version-chain GC,
+    // statistics, prefetch of the top of each tree, and the compaction check.
+    Librarian &get_librarian() { return *librarian_; }
+    // Summary statistics as of the librarian's last refresh, or null before
+    // the first one.
+    std::shared_ptr<const StaxStats::DatabaseStats> get_cached_statistics() const;
+    // Set by the librarian once little of the allocated arena is live data;
+    // compact() reclaims the rest.
+    bool is_compaction_recommended() const { return compaction_recommended_.load(std::memory_order_relaxed); }
+
     uint32_t get_collection(std::string_view name);
     Collection &get_collection_by_idx(uint32_t collection_idx);
 
@@ -130,15 +204,41 @@ public:
 
     TxnContext begin_transaction_context(size_t thread_id, bool is_read_only = false);
     void commit(const TxnContext &ctx, uint32_t collection_idx, const TransactionBatch &batch);
+    // Commits the writes of one transaction to several collections at one
+    // durability point: one flush or log sync, and one advance of the last
+    // committed id, so readers and recovery see all of them or none.
+    void commit(const TxnContext &ctx, std::span<const CollectionBatch> batches);
     void abort(const TxnContext &ctx);
+    // Group flushes (SyncOnCommit) or log syncs (Wal) made for commits.
+    uint64_t get_commit_flush_count() const { return group_commit_queue_.get_flushed_group_count(); }
 
     const std::filesystem::path &get_db_path() const;
     size_t get_num_configured_threads() const { return num_threads_; }
+    // The slot leased to the calling thread, leased on its first call. The
+    // thread keeps it until it exits.
+    size_t get_thread_slot();
+    size_t get_leased_thread_slot_count() const { return thread_slot_registry_->get_leased_count(); }
     DurabilityLevel get_durability_level() const { return durability_level_; }
 
     void dump_state(std::ostream &os) const;
 
-    static void compact(const std::filesystem::path &db_directory, size_t num_threads, bool flatten = false);
+    // Each collection is split into up to num_threads key ranges, copied on
+    // their own threads. With bulk_build their records are then linked into
+    // the new tree in one bottom-up pass; otherwise the threads insert them in
+    // key order as they read them. Flattening merges every generation into
+    // the new file and removes the older ones; with bulk_build it copies from
+    // one stream, so its memory does not grow with the record count.
+    static void compact(const std::filesystem::path &db_directory, size_t num_threads, bool flatten = false, bool bulk_build = true);
+    // Compacts the active generation while the database stays open. The live
+    // records are copied from a snapshot into a new file at no more than
+    // io_bytes_per_second (0 for no limit), the commits made meanwhile are
+    // caught up, and the file is swapped in while new commits wait briefly;
+    // transactions opened after the snapshot stay open across the swap.
+    // Collection references stay valid. Returns false, changing nothing, if
+    // transactions opened before the snapshot held off the swap or the
+    // database is closing. The librarian runs it in the background once
+    // compaction is recommended, and waits a while after a failed attempt.
+    bool compact_online(uint64_t io_bytes_per_second = ONLINE_COMPACTION_IO_BYTES_PER_SEC);
 
     StaxStats::DatabaseStatisticsCollector get_statistics_collector();
     
@@ -149,12 +249,15 @@ public:
     
     uint64_t allocate_data_chunk(size_t size_bytes);
 
+    EpochManager *get_epoch_manager() { return epoch_manager_.get(); }
+    const SnapshotRegistry *get_snapshot_registry() const { return snapshot_registry_.get(); }
+
 public:
     Database(const std::filesystem::path &base_dir, size_t num_threads, DurabilityLevel level);
 
     const std::vector<std::unique_ptr<DbGeneration>> &get_generations() const { return generations_; }
     SpinLock &get_generations_lock() { return generations_lock_; }
-    DbGeneration *get_active_generation() { return generations_.empty() ? nullptr : generations_.front().get(); }
+    DbGeneration *get_active_generation() { return active_generation_.load(std::memory_order_acquire); }
 
 private:
     friend class Collection;
@@ -165,14 +268,161 @@ private:
     friend class CollectionRecordAllocator;
 
     static uint64_t hash_name(std::string_view name);
+    // Null when the active generation has no collection at idx.
+    Collection *get_active_collection(uint32_t collection_idx);
+    uint32_t get_collection_for_hash(uint32_t name_hash);
+    // Fills in entry idx of gen's collection array and creates its objects.
+    // Callers hold generations_lock_ and have claimed the index.
+    void init_collection(DbGeneration &gen, uint32_t idx, uint32_t name_hash);
 
     std::unique_ptr<HybridTimestampGenerator> timestamp_generator_;
+    std::unique_ptr<EpochManager> epoch_manager_;
+    std::unique_ptr<SnapshotRegistry> snapshot_registry_;
+    CommitWatermark commit_watermark_;
+    // Shared so that a lease can outlive the database on its thread.
+    std::shared_ptr<ThreadSlotRegistry> thread_slot_registry_;
+    // Only with SyncOnCommit.
+    std::unique_ptr<DirtyRangeTracker> dirty_range_tracker_;
+    GroupCommitQueue group_commit_queue_;
+    // Only with Wal.
+    std::unique_ptr<WriteAheadLog> write_ahead_log_;
+    std::unique_ptr<Librarian> librarian_;
+    CommitGate commit_gate_;
+    mutable std::mutex cached_statistics_mutex_;
+    std::shared_ptr<const StaxStats::DatabaseStats> cached_statistics_;
+    std::atomic<bool> compaction_recommended_{false};
     std::filesystem::path base_directory_;
     size_t num_threads_;
     DurabilityLevel durability_level_;
 
     std::vector<std::unique_ptr<DbGeneration>> generations_;
     SpinLock generations_lock_;
+    // The front of generations_ and its collections, for readers that take
+    // no lock. Collection objects keep their index for the database's
+    // lifetime, whichever generation they are backed by.
+    std::atomic<DbGeneration *> active_generation_{nullptr};
+    std::array<std::atomic<Collection *>, MAX_COLLECTIONS_PER_DB_INITIAL> collections_by_idx_{};
+    // Bumped by each online compaction swap.
+    std::atomic<uint64_t> generation_sequence_{0};
+
+    struct RetiredGeneration
+    {
+        std::unique_ptr<DbGeneration> generation;
+        uint64_t epoch;
+    };
+    // Generations replaced by compact_online. Their files are released once
+    // the epoch has moved two steps past the swap; the objects are kept until
+    // close. Only touched while the librarian's tasks are held off.
+    std::vector<RetiredGeneration> retired_generations_;
+
+    // While compact_online runs, commits also hand their redo frames here.
+    std::atomic<bool> compaction_capture_active_{false};
+    std::mutex compaction_capture_mutex_;
+    std::string compaction_capture_frames_;
+    std::mutex online_compaction_mutex_;
+    std::thread online_compaction_thread_;
+    std::atomic<bool> online_compaction_running_{false};
+    std::atomic<bool> online_compaction_cancelled_{false};
+    // steady_clock ticks before which the librarian does not start another
+    // online compaction.
+    std::atomic<int64_t> online_compaction_retry_after_{0};
 
     void open_generation(const std::filesystem::path &db_directory, const std::filesystem::path &file_name, bool is_new);
+    // Maps an existing or new data file; the generation takes over
+    // lock_file_handle.
+    std::unique_ptr<DbGeneration> map_generation(const std::filesystem::path &path, OsFileHandleType lock_file_handle);
+    // Unregisters the context's snapshot and moves the watermark up.
+    void end_transaction_context(const TxnContext &ctx);
+    // Copies the last committed id into the file header, ahead of a flush
+    // of the whole mapping.
+    void persist_last_committed_txn_id();
+
+    void mark_dirty_range(size_t thread_id, uint64_t byte_offset, size_t size_bytes)
+    {
+        if (dirty_range_tracker_)
+            dirty_range_tracker_->mark(thread_id, byte_offset, size_bytes);
+    }
+    // Queues the collections' entries for the next group flush, which takes
+    // the pages every slot dirtied since the last one, and waits for it.
+    // Returns the flush error, if any.
+    std::string commit_durably(DbGeneration &gen, const TxnContext &ctx, std::span<const CollectionBatch> batches);
+    static void apply_counter_deltas(DbGeneration &gen, std::span<const CollectionBatch> batches);
+    std::string flush_commit_group(DbGeneration &gen, const std::vector<GroupCommitQueue::Request *> &group);
+    // For structures built outside any transaction, which no commit's dirty
+    // ranges cover.
+    void sync_generation(DbGeneration &gen);
+    // Flushes the pages the maintenance slot wrote since its last flush.
+    void flush_maintenance_ranges(DbGeneration &gen);
+
+    // Replays what a previous session logged but never checkpointed; under
+    // Wal the log then stays open for commits.
+    void open_write_ahead_log();
+    std::string commit_to_log(const TxnContext &ctx, std::span<const CollectionBatch> batches);
+    static void append_redo_frames(std::string &out, TxnID txn_id, std::span<const CollectionBatch> batches);
+    // A frame whose writes gen may already hold, as a copy taken at a
+    // snapshot at or above it does, counts what its ops change instead of
+    // adding its deltas.
+    static void apply_redo_frame(DbGeneration &gen, const WriteAheadLog::Frame &frame, bool may_be_applied = false);
+    // Replays, into the active generation, writes a transaction made to the
+    // one online compaction swapped out.
+    void carry_over_writes(const TxnContext &ctx, std::span<const CollectionBatch> batches);
+    // Checked before each write reaches the tree, so a write that lands in a
+    // generation being compacted is recorded.
+    bool records_redo_ops() const { return write_ahead_log_ || compaction_capture_active_.load(std::memory_order_acquire); }
+    std::string flush_log_group(const std::vector<GroupCommitQueue::Request *> &group);
+    std::string checkpoint_write_ahead_log();
+    // Redo frames carry counter deltas, which are not idempotent; the header
+    // keeps the counters the log's frames apply on top of.
+    static void record_checkpointed_counts(DbGeneration &gen);
+    static void restore_checkpointed_counts(DbGeneration &gen);
+
+    // Registers the maintenance tasks the durability level calls for and
+    // starts the librarian; the last step of opening a database.
+    void start_librarian();
+    std::vector<Collection *> get_active_collections();
+
+    // Copies the records source shows at read_ctx into the empty dest as of
+    // load_txn_id, in up to num_workers key ranges on their own threads, and
+    // adds them to totals. The workers share read_ctx, as parallel_scan's
+    // cursors do, but write through dest slots of their own, slot i for
+    // range i, so nothing else may write to dest meanwhile. keep_going is
+    // called from the copying threads with each record's size and stops the
+    // copy by returning false; the result is then false and dest is left
+    // unpublished.
+    static bool copy_collection(Collection &source, const TxnContext &read_ctx, Collection &dest, TxnID load_txn_id, size_t num_workers, bool bulk_build,
+                                TransactionBatch &totals, const std::function<bool(size_t record_bytes)> &keep_going = nullptr);
+
+    // Steps of compact_online. The swap runs with the commit gate closed.
+    bool swap_in_compacted_generation(std::unique_ptr<Database> &compacted_db, const std::filesystem::path &compacted_path, const std::function<void()> &catch_up);
+    void release_retired_generations(bool wait_for_readers = true);
+};
+
+// A transaction that writes to several collections of one database. Deltas
+// are kept per collection and committed together at one durability point.
+// Aborted on destruction unless committed.
+class MultiCollectionTransaction
+{
+public:
+    MultiCollectionTransaction(Database *db, size_t thread_id);
+    ~MultiCollectionTransaction();
+
+    MultiCollectionTransaction(const MultiCollectionTransaction &) = delete;
+    MultiCollectionTransaction &operator=(const MultiCollectionTransaction &) = delete;
+
+    const TxnContext &get_context() const { return ctx_; }
+    // Stays valid until the transaction commits or aborts.
+    TransactionBatch &get_batch(uint32_t collection_idx) { return batches_[collection_idx]; }
+
+    void insert(Collection &col, std::string_view key, std::string_view value);
+    void remove(Collection &col, std::string_view key);
+    std::optional<RecordData> get(Collection &col, std::string_view key);
+
+    void commit();
+    void abort();
+
+private:
+    Database *db_;
+    TxnContext ctx_;
+    std::map<uint32_t, TransactionBatch> batches_;
+    bool is_finished_ = false;
 };
\ No newline at end of file
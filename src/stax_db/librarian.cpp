@@ -0,0 +1,150 @@
+#include "stax_db/librarian.h"
+
+#include <iostream>
+#include <stdexcept>
+
+Librarian::Librarian(std::chrono::milliseconds max_sleep, std::chrono::milliseconds cpu_budget, uint64_t io_budget_bytes)
+    : max_sleep_(max_sleep), cpu_budget_(cpu_budget), io_budget_bytes_(io_budget_bytes)
+{
+}
+
+Librarian::~Librarian()
+{
+    stop();
+}
+
+void Librarian::add_task(std::string name, std::chrono::milliseconds interval, TaskFn run, bool mandatory)
+{
+    auto task = std::make_unique<Task>();
+    task->name = std::move(name);
+    task->interval = interval;
+    task->run = std::move(run);
+    task->mandatory = mandatory;
+    task->next_due = std::chrono::steady_clock::now() + interval;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    wakeup_.notify_all();
+}
+
+void Librarian::start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable())
+        return;
+    stop_requested_ = false;
+    thread_ = std::thread(&Librarian::run_loop, this);
+}
+
+void Librarian::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    wakeup_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+    // A run_all_now in progress finishes before stop returns.
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+}
+
+void Librarian::request_run(std::string_view name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &task : tasks_)
+        {
+            if (task->name == name)
+                task->next_due = std::chrono::steady_clock::now();
+        }
+    }
+    wakeup_.notify_all();
+}
+
+void Librarian::run_all_now()
+{
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_requested_)
+            return;
+    }
+    run_due_tasks((std::chrono::steady_clock::time_point::max)());
+}
+
+void Librarian::run_exclusive(const std::function<void()> &fn)
+{
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    fn();
+}
+
+uint64_t Librarian::get_run_count(std::string_view name) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &task : tasks_)
+    {
+        if (task->name == name)
+            return task->run_count;
+    }
+    throw std::invalid_argument("No librarian task named '" + std::string(name) + "'.");
+}
+
+void Librarian::run_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_requested_)
+    {
+        std::chrono::steady_clock::time_point wake_at = std::chrono::steady_clock::now() + max_sleep_;
+        for (const auto &task : tasks_)
+            wake_at = (std::min)(wake_at, task->next_due);
+        wakeup_.wait_until(lock, wake_at);
+        if (stop_requested_)
+            break;
+
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> run_lock(run_mutex_);
+            run_due_tasks(std::chrono::steady_clock::now());
+        }
+        lock.lock();
+    }
+}
+
+void Librarian::run_due_tasks(std::chrono::steady_clock::time_point due_by)
+{
+    std::vector<Task *> due_tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &task : tasks_)
+        {
+            if (task->next_due <= due_by)
+                due_tasks.push_back(task.get());
+        }
+    }
+
+    Budget budget(std::chrono::steady_clock::now() + cpu_budget_, io_budget_bytes_);
+    for (Task *task : due_tasks)
+    {
+        const bool skipped = !task->mandatory && budget.exhausted();
+        {
+            // Rescheduled before it runs, so a request_run made meanwhile
+            // is not lost.
+            std::lock_guard<std::mutex> lock(mutex_);
+            task->next_due = std::chrono::steady_clock::now() + (skipped ? (std::min)(task->interval, max_sleep_) : task->interval);
+        }
+        if (skipped)
+            continue;
+        try
+        {
+            task->run(budget);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Warning: Librarian task '" << task->name << "' failed: " << e.what() << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++task->run_count;
+    }
+}
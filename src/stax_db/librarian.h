@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+
+// Background maintenance of one database. A single thread runs registered
+// tasks, each on its own interval. The tasks due at a wake-up share one
+// budget of CPU time and I/O bytes, in the order they were added. Once the
+// budget is spent, optional tasks are put off by at most one sleep.
+// Mandatory tasks (the durability ones) run regardless.
+class Librarian
+{
+public:
+    class Budget
+    {
+    public:
+        Budget(std::chrono::steady_clock::time_point deadline, uint64_t io_bytes)
+            : deadline_(deadline), io_bytes_remaining_(io_bytes) {}
+
+        bool has_time() const { return std::chrono::steady_clock::now() < deadline_; }
+        uint64_t get_io_bytes_remaining() const { return io_bytes_remaining_; }
+        bool exhausted() const { return io_bytes_remaining_ == 0 || !has_time(); }
+
+        // I/O that has already happened; the budget cannot go below zero.
+        void charge_io(uint64_t bytes) { io_bytes_remaining_ -= (std::min)(bytes, io_bytes_remaining_); }
+
+    private:
+        std::chrono::steady_clock::time_point deadline_;
+        uint64_t io_bytes_remaining_;
+    };
+
+    using TaskFn = std::function<void(Budget &budget)>;
+
+    Librarian(std::chrono::milliseconds max_sleep, std::chrono::milliseconds cpu_budget, uint64_t io_budget_bytes);
+    ~Librarian();
+
+    Librarian(const Librarian &) = delete;
+    Librarian &operator=(const Librarian &) = delete;
+
+    // A new task is first due one interval after it is added.
+    void add_task(std::string name, std::chrono::milliseconds interval, TaskFn run, bool mandatory = false);
+    void start();
+    // Waits for the current wake-up to finish. Tasks do not run again after
+    // this returns.
+    void stop();
+
+    // Makes the named task due now and wakes the thread.
+    void request_run(std::string_view name);
+    // Runs every task on the calling thread, as one wake-up would if they
+    // were all due, and returns once they have finished.
+    void run_all_now();
+    // Runs fn on the calling thread while no task is running. Must not be
+    // called from a task.
+    void run_exclusive(const std::function<void()> &fn);
+
+    uint64_t get_run_count(std::string_view name) const;
+
+private:
+    struct Task
+    {
+        std::string name;
+        std::chrono::milliseconds interval;
+        TaskFn run;
+        bool mandatory;
+        std::chrono::steady_clock::time_point next_due;
+        uint64_t run_count = 0;
+    };
+
+    void run_loop();
+    // Runs the tasks due by due_by. Callers hold run_mutex_.
+    void run_due_tasks(std::chrono::steady_clock::time_point due_by);
+
+    const std::chrono::milliseconds max_sleep_;
+    const std::chrono::milliseconds cpu_budget_;
+    const uint64_t io_budget_bytes_;
+
+    // tasks_, the schedule, and the stop flag.
+    mutable std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<std::unique_ptr<Task>> tasks_;
+    bool stop_requested_ = false;
+    // One wake-up at a time, whether on the thread or from run_all_now.
+    std::mutex run_mutex_;
+    std::thread thread_;
+};
@@ -18,6 +18,8 @@ DatabaseStatisticsCollector::DatabaseStatisticsCollector(Database* db_instance)
 DatabaseStats DatabaseStatisticsCollector::get_database_summary_stats(bool include_physical_memory_stats) {
     DatabaseStats stats;
     
+    // A generation replaced by online compaction stays mapped while pinned.
+    EpochGuard epoch_guard(db_ref_->get_epoch_manager(), EpochManager::current_thread_stripe());
     std::vector<const DbGeneration*> generations_snapshot;
     {
         UniqueSpinLockGuard lock(db_ref_->get_generations_lock());
@@ -66,6 +68,7 @@ std::map<uint32_t, CollectionStats> DatabaseStatisticsCollector::get_all_collect
     
     uint32_t num_collections_to_scan = 0;
     const DbGeneration* active_gen_snapshot = nullptr;
+    EpochGuard epoch_guard(db_ref_->get_epoch_manager(), EpochManager::current_thread_stripe());
     {
         UniqueSpinLockGuard lock(db_ref_->get_generations_lock());
         if (db_ref_->get_generations().empty()) {
@@ -88,6 +91,7 @@ std::map<uint32_t, CollectionStats> DatabaseStatisticsCollector::get_all_collect
 CollectionStats DatabaseStatisticsCollector::get_collection_stats(uint32_t collection_idx) {
     const DbGeneration* active_gen_snapshot = nullptr;
     bool is_valid_collection = false;
+    EpochGuard epoch_guard(db_ref_->get_epoch_manager(), EpochManager::current_thread_stripe());
     {
         UniqueSpinLockGuard lock(db_ref_->get_generations_lock());
         if (db_ref_->get_generations().empty()) {
@@ -0,0 +1,210 @@
+#include "stax_db/write_ahead_log.h"
+#include "stax_common/os_file_extensions.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t FRAME_MAGIC = 0x4C415753; // "SWAL"
+constexpr uint8_t OP_INSERT = 0;
+constexpr uint8_t OP_REMOVE = 1;
+
+struct FrameHeader
+{
+    uint32_t magic;
+    uint32_t redo_ops_size;
+    uint64_t checksum;
+    TxnID txn_id;
+    uint32_t collection_idx;
+    uint32_t frames_following;
+    int64_t logical_item_count_delta;
+    int64_t live_record_bytes_delta;
+};
+
+struct OpHeader
+{
+    uint8_t kind;
+    uint32_t key_len;
+    uint32_t value_len;
+};
+
+// Everything after the checksum field: the rest of the header and the ops.
+constexpr size_t CHECKSUMMED_HEADER_OFFSET = offsetof(FrameHeader, txn_id);
+constexpr size_t OP_HEADER_SIZE = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+
+uint64_t frame_checksum(const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void append_op(std::string &redo_ops, uint8_t kind, std::string_view key, std::string_view value)
+{
+    const uint32_t key_len = static_cast<uint32_t>(key.size());
+    const uint32_t value_len = static_cast<uint32_t>(value.size());
+    char op_header[OP_HEADER_SIZE];
+    op_header[0] = static_cast<char>(kind);
+    std::memcpy(op_header + 1, &key_len, sizeof(key_len));
+    std::memcpy(op_header + 1 + sizeof(key_len), &value_len, sizeof(value_len));
+    redo_ops.append(op_header, OP_HEADER_SIZE);
+    redo_ops.append(key);
+    redo_ops.append(value);
+}
+}
+
+WriteAheadLog::WriteAheadLog(const std::filesystem::path &log_path)
+    : path_(log_path)
+{
+    file_handle_ = OSFileExtensions::open_or_create_file(path_);
+    if (file_handle_ == INVALID_OS_FILE_HANDLE)
+    {
+        throw std::runtime_error("Failed to open write-ahead log at " + path_.string());
+    }
+    size_.store(std::filesystem::file_size(path_), std::memory_order_release);
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    OSFileExtensions::close_file(file_handle_);
+}
+
+void WriteAheadLog::append_insert(std::string &redo_ops, std::string_view key, std::string_view value)
+{
+    append_op(redo_ops, OP_INSERT, key, value);
+}
+
+void WriteAheadLog::append_remove(std::string &redo_ops, std::string_view key)
+{
+    append_op(redo_ops, OP_REMOVE, key, {});
+}
+
+void WriteAheadLog::append_frame(std::string &out, TxnID txn_id, uint32_t collection_idx, const TransactionBatch &batch, uint32_t frames_following)
+{
+    FrameHeader header{};
+    header.magic = FRAME_MAGIC;
+    header.redo_ops_size = static_cast<uint32_t>(batch.redo_ops.size());
+    header.txn_id = txn_id;
+    header.collection_idx = collection_idx;
+    header.frames_following = frames_following;
+    header.logical_item_count_delta = batch.logical_item_count_delta;
+    header.live_record_bytes_delta = batch.live_record_bytes_delta;
+
+    const size_t frame_offset = out.size();
+    out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.append(batch.redo_ops);
+    const uint64_t checksum = frame_checksum(out.data() + frame_offset + CHECKSUMMED_HEADER_OFFSET, sizeof(header) - CHECKSUMMED_HEADER_OFFSET + batch.redo_ops.size());
+    std::memcpy(out.data() + frame_offset + offsetof(FrameHeader, checksum), &checksum, sizeof(checksum));
+}
+
+void WriteAheadLog::for_each_op(std::string_view redo_ops, const RedoOpVisitor &visitor)
+{
+    size_t offset = 0;
+    while (offset + OP_HEADER_SIZE <= redo_ops.size())
+    {
+        OpHeader op;
+        op.kind = static_cast<uint8_t>(redo_ops[offset]);
+        std::memcpy(&op.key_len, redo_ops.data() + offset + 1, sizeof(op.key_len));
+        std::memcpy(&op.value_len, redo_ops.data() + offset + 1 + sizeof(op.key_len), sizeof(op.value_len));
+        offset += OP_HEADER_SIZE;
+        if (offset + op.key_len + op.value_len > redo_ops.size())
+        {
+            throw std::runtime_error("Write-ahead log frame holds a truncated operation.");
+        }
+        visitor(op.kind == OP_REMOVE, redo_ops.substr(offset, op.key_len), redo_ops.substr(offset + op.key_len, op.value_len));
+        offset += op.key_len + op.value_len;
+    }
+}
+
+std::string WriteAheadLog::append_and_sync(std::string_view frames)
+{
+    const uint64_t offset = size_.load(std::memory_order_relaxed);
+    std::string err = OSFileExtensions::write_to_file_raw(file_handle_, frames.data(), frames.size(), offset);
+    if (err.empty())
+    {
+        err = OSFileExtensions::sync_file_raw(file_handle_);
+    }
+    if (err.empty())
+    {
+        size_.store(offset + frames.size(), std::memory_order_release);
+    }
+    return err;
+}
+
+std::string WriteAheadLog::truncate()
+{
+    std::string err = OSFileExtensions::extend_file_raw(file_handle_, 0);
+    if (err.empty())
+    {
+        err = OSFileExtensions::sync_file_raw(file_handle_);
+    }
+    if (err.empty())
+    {
+        size_.store(0, std::memory_order_release);
+    }
+    return err;
+}
+
+size_t WriteAheadLog::for_each_frame(std::string_view frames, const std::function<void(const Frame &)> &apply, size_t &intact_bytes)
+{
+    // intact_bytes is the end of the last whole transaction; a transaction's
+    // frames are only applied once its last one has been read intact.
+    intact_bytes = 0;
+    size_t frame_offset = 0;
+    size_t txn_count = 0;
+    std::vector<Frame> txn_frames;
+    while (frame_offset + sizeof(FrameHeader) <= frames.size())
+    {
+        FrameHeader header;
+        std::memcpy(&header, frames.data() + frame_offset, sizeof(header));
+        const size_t frame_size = sizeof(header) + header.redo_ops_size;
+        if (header.magic != FRAME_MAGIC || frame_offset + frame_size > frames.size() ||
+            frame_checksum(frames.data() + frame_offset + CHECKSUMMED_HEADER_OFFSET, frame_size - CHECKSUMMED_HEADER_OFFSET) != header.checksum ||
+            (!txn_frames.empty() && header.txn_id != txn_frames.front().txn_id))
+        {
+            break;
+        }
+
+        txn_frames.push_back(Frame{header.txn_id, header.collection_idx, header.logical_item_count_delta, header.live_record_bytes_delta,
+                                   frames.substr(frame_offset + sizeof(header), header.redo_ops_size)});
+        frame_offset += frame_size;
+        if (header.frames_following != 0)
+            continue;
+
+        for (const Frame &frame : txn_frames)
+            apply(frame);
+        txn_frames.clear();
+        intact_bytes = frame_offset;
+        ++txn_count;
+    }
+    return txn_count;
+}
+
+size_t WriteAheadLog::replay(const std::function<void(const Frame &)> &apply)
+{
+    std::ifstream log_stream(path_, std::ios::binary);
+    const std::string log_contents((std::istreambuf_iterator<char>(log_stream)), std::istreambuf_iterator<char>());
+
+    size_t offset = 0;
+    const size_t txns_replayed = for_each_frame(log_contents, apply, offset);
+
+    if (offset != log_contents.size())
+    {
+        std::string err = OSFileExtensions::extend_file_raw(file_handle_, offset);
+        if (err.empty())
+            err = OSFileExtensions::sync_file_raw(file_handle_);
+        if (!err.empty())
+            throw std::runtime_error("Failed to cut the torn tail of the write-ahead log: " + err);
+    }
+    size_.store(offset, std::memory_order_release);
+    return txns_replayed;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <functional>
+#include <atomic>
+
+#include "stax_common/os_platform_tools.h"
+#include "stax_common/common_types.hpp"
+#include "stax_tx/transaction.h"
+
+
+// Redo log for DurabilityLevel::Wal. Every commit to a collection becomes one
+// frame of logical writes; a commit to several collections writes its frames
+// back to back, each counting the frames that follow it. Frames are appended
+// in commit-group order and made durable with one sync per group; the data
+// file itself is only flushed by checkpoints, which then empty the log. A
+// frame cut short by a crash fails its checksum and ends the replay, along
+// with the rest of its transaction.
+class WriteAheadLog
+{
+public:
+    struct Frame
+    {
+        TxnID txn_id;
+        uint32_t collection_idx;
+        int64_t logical_item_count_delta;
+        int64_t live_record_bytes_delta;
+        std::string_view redo_ops;
+    };
+
+    using RedoOpVisitor = std::function<void(bool is_remove, std::string_view key, std::string_view value)>;
+
+    explicit WriteAheadLog(const std::filesystem::path &log_path);
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    static void append_insert(std::string &redo_ops, std::string_view key, std::string_view value);
+    static void append_remove(std::string &redo_ops, std::string_view key);
+    static void append_frame(std::string &out, TxnID txn_id, uint32_t collection_idx, const TransactionBatch &batch, uint32_t frames_following = 0);
+    static void for_each_op(std::string_view redo_ops, const RedoOpVisitor &visitor);
+    // Hands the frames of every intact transaction in frames to apply, in
+    // order. intact_bytes is set to the end of the last one. Returns the
+    // number of transactions.
+    static size_t for_each_frame(std::string_view frames, const std::function<void(const Frame &)> &apply, size_t &intact_bytes);
+
+    // Appends and truncates must not overlap; the group commit queue runs
+    // them one at a time. Both return an error message, or "" on success.
+    std::string append_and_sync(std::string_view frames);
+    std::string truncate();
+
+    // Hands the frames of every intact transaction to apply in log order and
+    // cuts the log after the last one. Returns the number of transactions
+    // replayed.
+    size_t replay(const std::function<void(const Frame &)> &apply);
+
+    uint64_t get_size() const { return size_.load(std::memory_order_acquire); }
+    const std::filesystem::path &get_path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+    OsFileHandleType file_handle_ = INVALID_OS_FILE_HANDLE;
+    std::atomic<uint64_t> size_{0};
+};
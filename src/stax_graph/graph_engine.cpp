@@ -322,13 +322,22 @@ std::optional<uint64_t> GraphReader::get_property_for_object_numeric(uint32_t ob
 
 std::set<uint32_t> GraphReader::get_all_relationship_types()
 {
-    std::set<uint32_t> rel_types;
-    for (auto cursor = fvo_col_->seek_first(ctx_); cursor->is_valid(); cursor->next()) {
-        std::string_view key = cursor->key();
-        // Relationship keys in FVO are (field_id, target_id, source_id)
-        if (key.length() == GraphTransaction::BINARY_U32_SIZE * 3) {
-            rel_types.insert(from_binary_key_u32(key.substr(0, GraphTransaction::BINARY_U32_SIZE)));
+    const size_t num_partitions = (std::max)(1u, std::thread::hardware_concurrency());
+    std::vector<std::set<uint32_t>> partition_rel_types(num_partitions);
+    fvo_col_->parallel_scan(ctx_, "", std::nullopt, num_partitions, [&](size_t partition_index, DBCursor &cursor) {
+        std::set<uint32_t> &rel_types = partition_rel_types[partition_index];
+        for (; cursor.is_valid(); cursor.next()) {
+            std::string_view key = cursor.key();
+            // Relationship keys in FVO are (field_id, target_id, source_id)
+            if (key.length() == GraphTransaction::BINARY_U32_SIZE * 3) {
+                rel_types.insert(from_binary_key_u32(key.substr(0, GraphTransaction::BINARY_U32_SIZE)));
+            }
         }
+    });
+
+    std::set<uint32_t> rel_types;
+    for (const auto &partition : partition_rel_types) {
+        rel_types.insert(partition.begin(), partition.end());
     }
     return rel_types;
 }
@@ -429,6 +438,12 @@ size_t GraphReader::count_relationships_by_type(uint32_t relationship_field_id)
     size_t fvo_rel_prefix_len = to_binary_key_buf(relationship_field_id, fvo_rel_prefix_buf, sizeof(fvo_rel_prefix_buf));
     std::string_view fvo_rel_prefix(fvo_rel_prefix_buf, fvo_rel_prefix_len);
 
+    const StaxTree &fvo_tree = fvo_col_->get_critbit_tree();
+    if (fvo_tree.has_order_statistics())
+    {
+        return static_cast<size_t>(fvo_tree.count_prefix(fvo_rel_prefix));
+    }
+
     size_t count = 0;
     for (auto cursor = fvo_col_->seek_raw(ctx_, fvo_rel_prefix); cursor->is_valid() && cursor->key().starts_with(fvo_rel_prefix); cursor->next())
     {
@@ -1002,7 +1017,7 @@ void GraphTransaction::multi_insert_low_level_on_collection(::Collection *target
 {
     if (!target_col || num_kvs == 0)
         return;
-    target_col->get_critbit_tree().insert_batch(ctx, kv_pairs, num_kvs, batch);
+    target_col->insert_batch(ctx, batch, kv_pairs, num_kvs);
 }
 
 void GraphTransaction::remove_fact(uint32_t obj_id, uint32_t field_id, uint32_t val_id)
@@ -1230,8 +1245,9 @@ void GraphTransaction::commit()
 
     flush_pending_writes();
 
-    ofv_col_->commit(ctx_, ofv_batch_deltas_);
-    fvo_col_->commit(ctx_, fvo_batch_deltas_);
+    // Both collections commit at one durability point.
+    const CollectionBatch batches[] = {{ofv_col_idx_, &ofv_batch_deltas_}, {fvo_col_idx_, &fvo_batch_deltas_}};
+    db_->commit(ctx_, batches);
     is_finished_ = true;
 }
 
@@ -1239,7 +1255,6 @@ void GraphTransaction::abort()
 {
     if (is_finished_)
         return;
-    ofv_col_->abort(ctx_);
-    fvo_col_->abort(ctx_);
+    db_->abort(ctx_);
     is_finished_ = true;
 }
\ No newline at end of file
@@ -165,6 +165,7 @@ public:
 
     TxnID get_txn_id() const;
     TxnID get_read_snapshot_id() const;
+    size_t get_thread_id() const { return thread_id_; }
 
     
     void insert_fact(uint32_t obj_id, uint32_t field_id, uint32_t val_id);
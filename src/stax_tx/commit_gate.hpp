@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "stax_common/constants.h"
+
+
+// Counts the commits in flight in one database, per thread slot so that
+// entering and leaving stays on the slot's own cache line. While the gate is
+// closed new commits wait for it to reopen, which gives maintenance a moment
+// in which no commit is half done. Open contexts are not held up: their reads
+// and writes go on, only their commits wait.
+class CommitGate
+{
+public:
+    void enter(size_t thread_id)
+    {
+        std::atomic<int64_t> &in_flight = slots_[slot_of(thread_id)].in_flight;
+        for (;;)
+        {
+            in_flight.fetch_add(1, std::memory_order_seq_cst);
+            if (!closed_.load(std::memory_order_seq_cst))
+                return;
+            in_flight.fetch_sub(1, std::memory_order_release);
+            std::unique_lock<std::mutex> lock(mutex_);
+            reopened_.wait(lock, [this]
+                           { return !closed_.load(std::memory_order_acquire); });
+        }
+    }
+
+    void exit(size_t thread_id)
+    {
+        slots_[slot_of(thread_id)].in_flight.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Closes the gate and waits for the commits in flight to finish. If they
+    // have not finished by the timeout the gate is reopened and false is
+    // returned.
+    bool close(std::chrono::milliseconds timeout)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_.store(true, std::memory_order_seq_cst);
+        }
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (count_in_flight() != 0)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                reopen();
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void reopen()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_.store(false, std::memory_order_release);
+        }
+        reopened_.notify_all();
+    }
+
+private:
+    static size_t slot_of(size_t thread_id) { return thread_id < MAX_CONCURRENT_THREADS ? thread_id : MAX_CONCURRENT_THREADS; }
+
+    int64_t count_in_flight() const
+    {
+        int64_t in_flight = 0;
+        for (const Slot &slot : slots_)
+            in_flight += slot.in_flight.load(std::memory_order_seq_cst);
+        return in_flight;
+    }
+
+    struct alignas(64) Slot
+    {
+        std::atomic<int64_t> in_flight{0};
+    };
+
+    std::array<Slot, MAX_CONCURRENT_THREADS + 1> slots_;
+    std::atomic<bool> closed_{false};
+    std::mutex mutex_;
+    std::condition_variable reopened_;
+};
+
+
+class CommitGateGuard
+{
+public:
+    CommitGateGuard(CommitGate &gate, size_t thread_id) : gate_(gate), thread_id_(thread_id) { gate_.enter(thread_id_); }
+    ~CommitGateGuard() { gate_.exit(thread_id_); }
+
+    CommitGateGuard(const CommitGateGuard &) = delete;
+    CommitGateGuard &operator=(const CommitGateGuard &) = delete;
+
+private:
+    CommitGate &gate_;
+    size_t thread_id_;
+};
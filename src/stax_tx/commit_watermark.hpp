@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <algorithm>
+
+#include "stax_common/constants.h"
+#include "stax_common/common_types.hpp"
+
+
+// The last committed transaction id of one database, sharded so that commits
+// from different thread slots do not all update one cache line. Each shard
+// keeps the highest id committed from its COMMIT_WATERMARK_SLOTS_PER_SHARD
+// slots. The id is the maximum over the shards, so it covers every commit
+// that has returned. Callers without a slot (group commit leaders, recovery)
+// share one more shard. The file header keeps only a persisted copy.
+class CommitWatermark
+{
+public:
+    explicit CommitWatermark(size_t num_slots)
+        : num_slot_shards_((std::min)((num_slots + COMMIT_WATERMARK_SLOTS_PER_SHARD - 1) / COMMIT_WATERMARK_SLOTS_PER_SHARD, SHARED_SHARD)),
+          num_slots_(num_slots) {}
+
+    void publish(size_t thread_id, TxnID txn_id)
+    {
+        raise(shards_[thread_id < num_slots_ ? thread_id / COMMIT_WATERMARK_SLOTS_PER_SHARD : SHARED_SHARD].committed, txn_id);
+    }
+
+    void publish_shared(TxnID txn_id) { raise(shards_[SHARED_SHARD].committed, txn_id); }
+
+    TxnID get() const
+    {
+        TxnID last_committed = shards_[SHARED_SHARD].committed.load(std::memory_order_acquire);
+        for (size_t shard = 0; shard < num_slot_shards_; ++shard)
+            last_committed = (std::max)(last_committed, shards_[shard].committed.load(std::memory_order_acquire));
+        return last_committed;
+    }
+
+private:
+    static constexpr size_t SHARED_SHARD = (MAX_CONCURRENT_THREADS + COMMIT_WATERMARK_SLOTS_PER_SHARD - 1) / COMMIT_WATERMARK_SLOTS_PER_SHARD;
+
+    // Most commits lose to a newer id already in the shard and only load it.
+    static void raise(std::atomic<TxnID> &committed, TxnID txn_id)
+    {
+        TxnID observed = committed.load(std::memory_order_relaxed);
+        while (txn_id > observed && !committed.compare_exchange_weak(observed, txn_id, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    struct alignas(64) Shard
+    {
+        std::atomic<TxnID> committed{0};
+    };
+
+    std::array<Shard, SHARED_SHARD + 1> shards_;
+    const size_t num_slot_shards_;
+    const size_t num_slots_;
+};
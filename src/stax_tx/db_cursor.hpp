@@ -7,6 +7,7 @@
 #include <queue>      
 #include <functional> 
 #include <utility>    
+#include <optional>
 
 #include "stax_core/value_store.hpp"
 #include "stax_common/common_types.hpp"
@@ -17,6 +18,12 @@
 class StaxTree;
 class MergedCursorImpl;
 
+// Selects the cursor constructors that start on the last key at or before
+// last_key (or on the last key of all) for reverse iteration with prev().
+struct ReverseSeek {
+    std::optional<std::string_view> last_key;
+};
+
 namespace { 
     static const TxnContext inert_context = {0, 0, 0};
 }
@@ -37,11 +44,16 @@ public:
     std::string_view key() const;
     DataView value() const;
     void next();
+    void prev();
     
     
     DBCursor(Database* db, const TxnContext& ctx, uint32_t collection_idx, std::string_view start_key, std::optional<std::string_view> end_key);
+    DBCursor(Database* db, const TxnContext& ctx, uint32_t collection_idx, ReverseSeek seek, std::optional<std::string_view> start_key);
     DBCursor(Database* db, const TxnContext& ctx, StaxTree* tree, std::optional<std::string_view> end_key, bool raw_mode = false); 
-    DBCursor(Database* db, const TxnContext& ctx, StaxTree* tree, std::string_view start_key, std::optional<std::string_view> end_key, bool raw_mode = false);
+    // With keeps_tombstones the cursor also stops on keys whose visible
+    // version is a tombstone, for merges where it shadows older generations.
+    DBCursor(Database* db, const TxnContext& ctx, StaxTree* tree, std::string_view start_key, std::optional<std::string_view> end_key, bool raw_mode = false, bool keeps_tombstones = false);
+    DBCursor(Database* db, const TxnContext& ctx, StaxTree* tree, ReverseSeek seek, std::optional<std::string_view> start_key, bool raw_mode = false, bool keeps_tombstones = false);
 
 
 private:
@@ -51,14 +63,18 @@ private:
 
     void validate_current_leaf();
     void advance_to_next_physical_leaf();
+    void retreat_to_prev_physical_leaf();
 
     std::unique_ptr<MergedCursorImpl> impl_;
     
     Database* db_ = nullptr;
     const TxnContext& ctx_;
     StaxTree* tree_ = nullptr; 
+    // Keeps the records and nodes this cursor points at from being recycled.
+    EpochGuard epoch_guard_;
     bool is_valid_ = false;
     bool raw_mode_ = false;
+    bool keeps_tombstones_ = false;
 
     std::stack<uint64_t, std::vector<uint64_t>> path_stack_;
     
@@ -70,6 +86,10 @@ private:
     std::string end_key_buffer_;
     std::string_view end_key_view_;
     bool has_end_key_ = false;
+
+    std::string start_key_buffer_;
+    std::string_view start_key_view_;
+    bool has_start_key_ = false;
 };
 
 
@@ -78,21 +98,28 @@ inline DBCursor::DBCursor(DBCursor&& other) noexcept
       db_(other.db_),
       ctx_(other.ctx_), 
       tree_(other.tree_),
+      epoch_guard_(std::move(other.epoch_guard_)),
       is_valid_(other.is_valid_),
       raw_mode_(other.raw_mode_),
+      keeps_tombstones_(other.keeps_tombstones_),
       path_stack_(std::move(other.path_stack_)),
       current_record_data_(other.current_record_data_),
       current_key_ptr_(other.current_key_ptr_),
       current_key_len_(other.current_key_len_),
       end_key_buffer_(std::move(other.end_key_buffer_)),
       
-      has_end_key_(other.has_end_key_)
+      has_end_key_(other.has_end_key_),
+      start_key_buffer_(std::move(other.start_key_buffer_)),
+      has_start_key_(other.has_start_key_)
 {
     
     
     if (has_end_key_) {
         end_key_view_ = end_key_buffer_;
     }
+    if (has_start_key_) {
+        start_key_view_ = start_key_buffer_;
+    }
 
     
     other.is_valid_ = false;
@@ -111,14 +138,18 @@ inline DBCursor& DBCursor::operator=(DBCursor&& other) noexcept {
         
         
         tree_ = other.tree_;
+        epoch_guard_ = std::move(other.epoch_guard_);
         is_valid_ = other.is_valid_;
         raw_mode_ = other.raw_mode_;
+        keeps_tombstones_ = other.keeps_tombstones_;
         path_stack_ = std::move(other.path_stack_);
         current_record_data_ = other.current_record_data_;
         current_key_ptr_ = other.current_key_ptr_;
         current_key_len_ = other.current_key_len_;
         end_key_buffer_ = std::move(other.end_key_buffer_);
         has_end_key_ = other.has_end_key_;
+        start_key_buffer_ = std::move(other.start_key_buffer_);
+        has_start_key_ = other.has_start_key_;
         
         
         
@@ -127,6 +158,11 @@ inline DBCursor& DBCursor::operator=(DBCursor&& other) noexcept {
         } else {
             end_key_view_ = {};
         }
+        if (has_start_key_) {
+            start_key_view_ = start_key_buffer_;
+        } else {
+            start_key_view_ = {};
+        }
 
         
         other.is_valid_ = false;
@@ -151,6 +187,14 @@ struct MergeCursorState {
         
         return generation_index > other.generation_index;
     }
+
+    // Orders the max-heap used while iterating backwards.
+    bool operator<(const MergeCursorState& other) const {
+        int key_cmp = cursor.key().compare(other.cursor.key());
+        if (key_cmp != 0) return key_cmp < 0;
+
+        return generation_index > other.generation_index;
+    }
 };
 
 class MergedCursorImpl {
@@ -158,7 +202,11 @@ public:
     Database* db_;
     const TxnContext& ctx_;
 
+    uint32_t collection_idx_;
+    bool reverse_ = false;
+
     std::priority_queue<MergeCursorState, std::vector<MergeCursorState>, std::greater<MergeCursorState>> pq_;
+    std::priority_queue<MergeCursorState, std::vector<MergeCursorState>, std::less<MergeCursorState>> reverse_pq_;
     std::string last_key_buffer_;
     std::string_view last_key_view_;
     RecordData current_record_data_;
@@ -168,6 +216,18 @@ public:
     std::string_view end_key_view_;
     bool has_end_key_ = false;
 
+    std::string start_key_buffer_;
+    std::string_view start_key_view_;
+    bool has_start_key_ = false;
+
     MergedCursorImpl(Database* db, const TxnContext& ctx, uint32_t collection_idx, std::string_view start_key, std::optional<std::string_view> end_key);
+    MergedCursorImpl(Database* db, const TxnContext& ctx, uint32_t collection_idx, ReverseSeek seek, std::optional<std::string_view> start_key);
     void advance();
+    void retreat();
+
+private:
+    void position_forward(std::string_view start_key, bool skip_start_key);
+    void position_reverse(std::optional<std::string_view> last_key, bool skip_last_key);
+    template <typename Queue>
+    void merge_next_visible(Queue& queue, bool reverse);
 };
\ No newline at end of file
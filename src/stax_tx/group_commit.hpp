@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <span>
+#include <vector>
+
+#include "stax_common/common_types.hpp"
+#include "stax_tx/transaction.h"
+#include "stax_core/dirty_range_tracker.hpp"
+
+
+// Durable commits of one database, flushed in groups. The first committer to
+// find no flush running leads: it takes every request queued so far and
+// flushes them in one pass, while committers arriving meanwhile queue up for
+// the next group. Each committer returns once its own group is on disk.
+class GroupCommitQueue
+{
+public:
+    struct Request
+    {
+        TxnID txn_id = 0;
+        std::vector<DirtyRangeTracker::Range> ranges;
+        // Redo log frames, under DurabilityLevel::Wal, and the batches whose
+        // counters the group applies once they are logged.
+        std::string log_frames;
+        std::span<const CollectionBatch> batches;
+        bool done = false;
+        std::string error;
+    };
+
+    // flush_group returns an error message, or an empty string on success;
+    // every member of the group gets the same result.
+    using FlushGroupFn = std::function<std::string(const std::vector<Request *> &group)>;
+
+    std::string submit(Request &request, const FlushGroupFn &flush_group);
+
+    // Runs fn while no group is being flushed and holds new groups off until
+    // it returns, e.g. to checkpoint and empty a log.
+    void run_exclusive(const std::function<void()> &fn);
+
+    uint64_t get_flushed_group_count() const { return flushed_group_count_.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable group_flushed_;
+    std::vector<Request *> pending_;
+    bool flush_in_progress_ = false;
+    std::atomic<uint64_t> flushed_group_count_{0};
+};
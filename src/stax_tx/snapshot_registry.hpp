@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <array>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "stax_common/constants.h"
+#include "stax_common/common_types.hpp"
+
+
+// Snapshots of the open transactions of one database, and the low watermark
+// derived from them: no open or future snapshot reads below it, so versions
+// hidden behind a newer version at or under it can be cut from their chains.
+// Each thread slot has a few entries, claimed by CAS since threads without a
+// slot of their own can share one. Floors beyond a slot's entries go to a
+// locked spill list. A context that is never committed or aborted keeps its
+// floor, and with it the watermark, pinned.
+class SnapshotRegistry
+{
+public:
+    static constexpr TxnID NO_FLOOR = (std::numeric_limits<TxnID>::max)();
+
+    // Returns the ticket that unregisters the floor.
+    uint64_t register_floor(size_t thread_id, TxnID floor);
+
+    // Idempotent: a context committed to several collections unregisters once.
+    void unregister(size_t thread_id, uint64_t ticket);
+
+    // last_committed must be read before the registry is scanned.
+    void refresh_watermark(TxnID last_committed, size_t num_slots);
+
+    TxnID get_watermark() const { return watermark_.load(std::memory_order_acquire); }
+
+    // Tickets are ordered by when they were registered: every ticket handed
+    // out after this call compares at or above the value returned.
+    uint64_t get_next_ticket() const { return next_ticket_sequence_.load(std::memory_order_seq_cst) << 8; }
+
+    // Whether a floor registered before ticket is still open.
+    bool has_floor_before(uint64_t ticket, size_t num_slots);
+
+private:
+    static constexpr uint64_t ENTRY_INDEX_MASK = 0xFF;
+    static constexpr uint64_t SPILLED_ENTRY_INDEX = ENTRY_INDEX_MASK;
+    static_assert(SNAPSHOT_REGISTRY_ENTRIES_PER_SLOT <= SPILLED_ENTRY_INDEX, "entry index must fit the ticket's low byte");
+
+    struct Entry
+    {
+        std::atomic<uint64_t> ticket{0};
+        std::atomic<TxnID> floor{NO_FLOOR};
+    };
+
+    struct alignas(64) Slot
+    {
+        std::array<Entry, SNAPSHOT_REGISTRY_ENTRIES_PER_SLOT> entries;
+    };
+
+    std::array<Slot, MAX_CONCURRENT_THREADS> slots_;
+    std::atomic<uint64_t> next_ticket_sequence_{1};
+    // Tickets and floors that found every entry of their slot taken.
+    std::mutex spill_mutex_;
+    std::vector<std::pair<uint64_t, TxnID>> spilled_floors_;
+    std::atomic<size_t> spilled_count_{0};
+    std::atomic<TxnID> watermark_{0};
+};
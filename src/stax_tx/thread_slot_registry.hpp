@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+#include "stax_common/constants.h"
+
+
+// Leases the thread slots of one database to OS threads that do not choose
+// a slot themselves (the C API and the bindings). A slot's TLABs and free
+// lists assume one thread at a time, and a lease is held by one thread until
+// it exits. Callers that pass explicit slot ids must not use leased slots.
+class ThreadSlotRegistry
+{
+public:
+    static_assert(MAX_CONCURRENT_THREADS <= 64, "Slot leases are tracked in one 64-bit mask.");
+
+    explicit ThreadSlotRegistry(size_t num_slots)
+    {
+        num_slots = (std::min)(num_slots, static_cast<size_t>(MAX_CONCURRENT_THREADS));
+        all_slots_mask_ = num_slots >= 64 ? ~uint64_t{0} : (uint64_t{1} << num_slots) - 1;
+    }
+
+    // Leases the lowest free slot. Throws once every slot is leased.
+    size_t acquire()
+    {
+        uint64_t leased = leased_mask_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const uint64_t free_slots = ~leased & all_slots_mask_;
+            if (free_slots == 0)
+                throw std::runtime_error("All " + std::to_string(std::popcount(all_slots_mask_)) + " thread slots are leased; open the database with more threads.");
+            const uint64_t slot_bit = free_slots & (~free_slots + 1);
+            if (leased_mask_.compare_exchange_weak(leased, leased | slot_bit, std::memory_order_acquire, std::memory_order_relaxed))
+                return static_cast<size_t>(std::countr_zero(slot_bit));
+        }
+    }
+
+    void release(size_t slot)
+    {
+        leased_mask_.fetch_and(~(uint64_t{1} << slot), std::memory_order_release);
+    }
+
+    size_t get_leased_count() const { return static_cast<size_t>(std::popcount(leased_mask_.load(std::memory_order_relaxed))); }
+
+private:
+    uint64_t all_slots_mask_;
+    std::atomic<uint64_t> leased_mask_{0};
+};
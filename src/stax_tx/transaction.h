@@ -1,6 +1,9 @@
 
 #pragma once
 
+#include <string>
+#include <cstdint>
+
 #include "stax_common/common_types.hpp"
 
 
@@ -9,6 +12,12 @@ struct TxnContext {
     TxnID txn_id;
     TxnID read_snapshot_id;
     size_t thread_id;
+    // Registration of the snapshot with the database's SnapshotRegistry;
+    // 0 for contexts that were not created by begin_transaction_context.
+    uint64_t snapshot_ticket = 0;
+    // The database's generation when the context began. A commit made after
+    // online compaction swapped in a newer one carries its writes over.
+    uint64_t generation_sequence = 0;
 };
 
 
@@ -16,4 +25,13 @@ struct TxnContext {
 struct TransactionBatch {
     int64_t logical_item_count_delta = 0;
     int64_t live_record_bytes_delta = 0;
+    // Logical writes of the transaction, kept only under DurabilityLevel::Wal.
+    std::string redo_ops;
+};
+
+// One collection's share of a transaction that writes to several; see
+// Database::commit.
+struct CollectionBatch {
+    uint32_t collection_idx;
+    const TransactionBatch *batch;
 };
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include <string_view>
 #include <cstdint>
 #include <utility>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
 
 #if defined(_WIN32)
 #include <process.h>
@@ -30,6 +34,39 @@ static inline int get_process_id() {
 #endif
 }
 
+// The directory a test keeps its databases in: path() is a per-process
+// database directory under base(), which is cleared on construction and
+// removed again when the test returns or throws.
+class TestDbDir {
+public:
+    explicit TestDbDir(std::filesystem::path base_dir)
+        : base_dir_(std::move(base_dir)), db_dir_(base_dir_ / ("test_db_" + std::to_string(get_process_id()))) {
+        std::filesystem::remove_all(base_dir_);
+    }
+    ~TestDbDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(base_dir_, ec);
+    }
+
+    TestDbDir(const TestDbDir&) = delete;
+    TestDbDir& operator=(const TestDbDir&) = delete;
+
+    const std::filesystem::path& base() const { return base_dir_; }
+    const std::filesystem::path& path() const { return db_dir_; }
+
+private:
+    std::filesystem::path base_dir_;
+    std::filesystem::path db_dir_;
+};
+
+// Throws if the test recorded a failure, otherwise reports that it passed.
+inline void finish_test(bool test_passed, const std::string& test_name) {
+    if (!test_passed) {
+        throw std::runtime_error(test_name + " test failed.");
+    }
+    std::cout << test_name << " Test Passed!" << std::endl;
+}
+
 
 
 struct TestUser {
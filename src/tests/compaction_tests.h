@@ -24,6 +24,10 @@
 #include <mutex>    
 #include <random>   
 #include <memory>   
+#include <algorithm>
+#include <optional>
+#include <functional>
+#include <cstdio>
 
 
 #include "stax_db/db.h"
@@ -225,6 +229,366 @@ void run_hot_compaction_stress_test() {
 }
 
 
+inline void run_online_compaction_test() {
+    std::cout << "\n--- Running Online Compaction Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_online_compaction");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    const int num_keys = 20000;
+    const int num_writers = 3;
+    const int keys_per_writer = 3000;
+    auto key_of = [](int n) { return "key_" + std::to_string(n); };
+    auto check_contents = [&](Database& db, Collection& docs, const char* when) {
+        const size_t slot = db.get_thread_slot();
+        TxnContext read_ctx = docs.begin_transaction_context(slot, true);
+        for (int n = 0; n < num_keys; ++n) {
+            auto record = docs.get(read_ctx, key_of(n));
+            const bool expect_present = n % 4 != 0;
+            if (record.has_value() != expect_present || (record && record->value_view() != "v3_" + std::to_string(n))) {
+                std::cerr << "FAIL: " << when << ", " << key_of(n) << " is wrong." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+        for (int t = 0; t < num_writers; ++t) {
+            for (int n = 0; n < keys_per_writer; ++n) {
+                if (!docs.get(read_ctx, "w" + std::to_string(t) + "_" + std::to_string(n))) {
+                    std::cerr << "FAIL: " << when << ", a concurrent write by writer " << t << " is missing." << std::endl;
+                    test_passed = false;
+                    n = keys_per_writer;
+                    t = num_writers;
+                }
+            }
+        }
+        docs.abort(read_ctx);
+    };
+
+    uint32_t docs_idx;
+    {
+        auto db = Database::create_new(db_dir, 8, DurabilityLevel::Wal);
+        docs_idx = db->get_collection("docs");
+        Collection& docs = db->get_collection_by_idx(docs_idx);
+        Collection& other = db->get_collection_by_idx(db->get_collection("other"));
+        other.enable_hash_index();
+
+        // Overwrites and removes leave most of the arena dead.
+        const std::string padding(64, 'p');
+        for (int version = 0; version < 4; ++version) {
+            TxnContext ctx = docs.begin_transaction_context(0, false);
+            TransactionBatch batch;
+            for (int n = 0; n < num_keys; ++n) {
+                docs.insert(ctx, batch, key_of(n), "v" + std::to_string(version) + "_" + std::to_string(n) + (version < 3 ? padding : ""));
+            }
+            docs.commit(ctx, batch);
+        }
+        {
+            TxnContext ctx = docs.begin_transaction_context(0, false);
+            TransactionBatch batch;
+            for (int n = 0; n < num_keys; n += 4) {
+                docs.remove(ctx, batch, key_of(n));
+            }
+            for (int n = 0; n < 100; ++n) {
+                other.insert(ctx, batch, key_of(n), "other");
+            }
+            docs.commit(ctx, batch);
+        }
+        const uint64_t allocated_before = db->get_active_generation()->file_header->global_alloc_offset.load();
+
+        std::vector<std::thread> writers;
+        for (int t = 0; t < num_writers; ++t) {
+            writers.emplace_back([&, t]() {
+                const size_t slot = db->get_thread_slot();
+                for (int n = 0; n < keys_per_writer; n += 10) {
+                    TxnContext ctx = docs.begin_transaction_context(slot, false);
+                    TransactionBatch batch;
+                    for (int i = n; i < n + 10; ++i) {
+                        docs.insert(ctx, batch, "w" + std::to_string(t) + "_" + std::to_string(i), "written");
+                        // Held open for a while, so some of them span the swap.
+                        if (i == n + 4) {
+                            std::this_thread::sleep_for(std::chrono::microseconds(200));
+                        }
+                    }
+                    docs.commit(ctx, batch);
+                }
+            });
+        }
+        if (!db->compact_online(0)) {
+            std::cerr << "FAIL: Online compaction did not swap in the new file." << std::endl;
+            test_passed = false;
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+
+        if (db->get_collection("docs") != docs_idx) {
+            std::cerr << "FAIL: A collection name no longer resolves after online compaction." << std::endl;
+            test_passed = false;
+        }
+        if (db->get_active_generation()->file_header->global_alloc_offset.load() >= allocated_before) {
+            std::cerr << "FAIL: Online compaction did not shrink the arena." << std::endl;
+            test_passed = false;
+        }
+        check_contents(*db, docs, "After online compaction");
+
+        TxnContext other_ctx = other.begin_transaction_context(0, true);
+        if (!other.get_critbit_tree().has_hash_index() || !other.get(other_ctx, key_of(42))) {
+            std::cerr << "FAIL: The hash-indexed collection lost its index or data." << std::endl;
+            test_passed = false;
+        }
+        other.abort(other_ctx);
+
+        // The replaced file goes once no reader can still reach it.
+        const std::filesystem::path retired_path = db_dir / "data.stax.retired";
+        for (int attempt = 0; attempt < 10 && std::filesystem::exists(retired_path); ++attempt) {
+            db->get_librarian().run_all_now();
+        }
+        if (std::filesystem::exists(retired_path) || std::filesystem::exists(db_dir / "compaction")) {
+            std::cerr << "FAIL: Online compaction left its old or partial file behind." << std::endl;
+            test_passed = false;
+        }
+
+        // A reader from before the snapshot holds off the swap, but not the
+        // transactions begun meanwhile.
+        TxnContext old_reader = docs.begin_transaction_context(0, true);
+        std::atomic<bool> is_compaction_done{false};
+        bool compacted_again = false;
+        std::thread compactor([&]() {
+            compacted_again = db->compact_online(0);
+            is_compaction_done.store(true);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        TxnContext ctx = docs.begin_transaction_context(0, false);
+        TransactionBatch batch;
+        docs.insert(ctx, batch, "after_swap", "kept");
+        docs.commit(ctx, batch);
+        if (is_compaction_done.load()) {
+            std::cerr << "FAIL: Online compaction swapped with a reader from before its snapshot still open." << std::endl;
+            test_passed = false;
+        }
+        docs.abort(old_reader);
+        compactor.join();
+        if (!compacted_again) {
+            std::cerr << "FAIL: Online compaction did not swap once the old reader ended." << std::endl;
+            test_passed = false;
+        }
+        check_contents(*db, docs, "After the second online compaction");
+    }
+    {
+        auto db = Database::open_existing(db_dir, 8, DurabilityLevel::Wal);
+        Collection& docs = db->get_collection_by_idx(db->get_collection("docs"));
+        check_contents(*db, docs, "After reopening");
+        TxnContext read_ctx = docs.begin_transaction_context(db->get_thread_slot(), true);
+        if (!docs.get(read_ctx, "after_swap")) {
+            std::cerr << "FAIL: A write made after the swap was lost across a reopen." << std::endl;
+            test_passed = false;
+        }
+        docs.abort(read_ctx);
+    }
+
+    finish_test(test_passed, "Online Compaction");
+}
+
+inline void run_parallel_compaction_test() {
+    std::cout << "\n--- Running Parallel Compaction Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_parallel_compaction");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    // Enough keys for every worker to get a partition of its own.
+    const size_t num_threads = 4;
+    const int num_keys = static_cast<int>(num_threads * PARALLEL_SCAN_MIN_KEYS_PER_PARTITION);
+    auto key_of = [](int n) {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "key_%07d", n);
+        return std::string(buf);
+    };
+    auto value_of = [](int n) { return (n % 2 == 0 ? "new_" : "old_") + std::to_string(n); };
+
+    uint32_t plain_idx;
+    uint32_t ranked_idx;
+    {
+        auto db = Database::create_new(db_dir, num_threads);
+        plain_idx = db->get_collection("plain");
+        ranked_idx = db->get_collection("ranked");
+        Collection& plain = db->get_collection_by_idx(plain_idx);
+        Collection& ranked = db->get_collection_by_idx(ranked_idx);
+        ranked.enable_order_statistics();
+
+        for (Collection* col : {&plain, &ranked}) {
+            TxnContext ctx = col->begin_transaction_context(0, false);
+            TransactionBatch batch;
+            for (int n = 0; n < num_keys; ++n) {
+                col->insert(ctx, batch, key_of(n), "old_" + std::to_string(n));
+            }
+            col->commit(ctx, batch);
+
+            ctx = col->begin_transaction_context(0, false);
+            batch = TransactionBatch();
+            for (int n = 0; n < num_keys; n += 2) {
+                col->insert(ctx, batch, key_of(n), value_of(n));
+            }
+            for (int n = 0; n < num_keys; n += 5) {
+                col->remove(ctx, batch, key_of(n));
+            }
+            col->commit(ctx, batch);
+        }
+    }
+
+    auto check_all = [&](const char* when) {
+        auto db = Database::open_existing(db_dir, num_threads);
+        if (db->get_collection("plain") != plain_idx || db->get_collection("ranked") != ranked_idx) {
+            std::cerr << "FAIL: " << when << ", collection names no longer resolve." << std::endl;
+            test_passed = false;
+            return;
+        }
+        for (uint32_t idx : {plain_idx, ranked_idx}) {
+            Collection& col = db->get_collection_by_idx(idx);
+            TxnContext read_ctx = col.begin_transaction_context(0, true);
+            int n = 0;
+            for (auto cursor = col.seek_first(read_ctx); cursor->is_valid(); cursor->next(), ++n) {
+                while (n % 5 == 0) {
+                    ++n;
+                }
+                if (cursor->key() != key_of(n) || static_cast<std::string_view>(cursor->value()) != value_of(n)) {
+                    std::cerr << "FAIL: " << when << ", expected " << key_of(n) << " but found " << cursor->key() << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+            while (n < num_keys && n % 5 == 0) {
+                ++n;
+            }
+            if (n < num_keys) {
+                std::cerr << "FAIL: " << when << ", the scan stopped at " << key_of(n) << "." << std::endl;
+                test_passed = false;
+            }
+            col.abort(read_ctx);
+        }
+        const uint64_t expected_live = num_keys - (num_keys + 4) / 5;
+        if (db->get_collection_by_idx(ranked_idx).get_critbit_tree().count_prefix("") != expected_live) {
+            std::cerr << "FAIL: " << when << ", the ranked collection counts the wrong number of keys." << std::endl;
+            test_passed = false;
+        }
+    };
+
+    // The compaction's workers split each collection the same way.
+    {
+        auto db = Database::open_existing(db_dir, num_threads);
+        Collection& plain = db->get_collection_by_idx(plain_idx);
+        TxnContext read_ctx = plain.begin_transaction_context(0, true);
+        std::vector<std::atomic<size_t>> keys_per_partition(num_threads);
+        std::atomic<size_t> partitions_seen{0};
+        plain.parallel_scan(read_ctx, "", std::nullopt, num_threads, [&](size_t partition_index, DBCursor& cursor) {
+            partitions_seen++;
+            for (; cursor.is_valid(); cursor.next()) {
+                keys_per_partition[partition_index]++;
+            }
+        });
+        plain.abort(read_ctx);
+        if (partitions_seen.load() != num_threads) {
+            std::cerr << "FAIL: The copy was split into " << partitions_seen.load() << " partitions, not " << num_threads << "." << std::endl;
+            test_passed = false;
+        }
+        for (size_t i = 0; i < num_threads; ++i) {
+            if (keys_per_partition[i].load() == 0) {
+                std::cerr << "FAIL: Copy partition " << i << " was empty." << std::endl;
+                test_passed = false;
+            }
+        }
+    }
+
+    Database::compact(db_dir, num_threads, false, true);
+    check_all("After partitioned bulk compaction");
+    Database::compact(db_dir, num_threads, false, false);
+    check_all("After partitioned insert compaction");
+    Database::compact(db_dir, num_threads, true);
+    check_all("After flattening compaction");
+
+    finish_test(test_passed, "Parallel Compaction");
+}
+
+inline void run_flatten_compaction_test() {
+    std::cout << "\n--- Running Flatten Compaction Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_flatten_compaction");
+    const std::filesystem::path& db_dir = test_dir.path();
+    std::filesystem::path old_gen_dir = test_dir.base() / ("old_gen_" + std::to_string(::Tests::get_process_id()));
+
+    auto commit_to = [](Database& db, const std::function<void(Collection&, TxnContext&, TransactionBatch&)>& write) {
+        Collection& col = db.get_collection_by_idx(db.get_collection("flat"));
+        TxnContext ctx = col.begin_transaction_context(0, false);
+        TransactionBatch batch;
+        write(col, ctx, batch);
+        col.commit(ctx, batch);
+    };
+
+    // The older generation commits once, so every version the newer one
+    // writes afterwards has the higher txn id.
+    auto build_generations = [&]() {
+        std::filesystem::remove_all(test_dir.base());
+        {
+            auto db = Database::create_new(old_gen_dir, 1);
+            commit_to(*db, [](Collection& col, TxnContext& ctx, TransactionBatch& batch) {
+                col.insert(ctx, batch, "shadowed", "old");
+                col.insert(ctx, batch, "updated", "old");
+                col.insert(ctx, batch, "old_only", "old");
+            });
+        }
+        {
+            auto db = Database::create_new(db_dir, 1);
+            commit_to(*db, [](Collection& col, TxnContext& ctx, TransactionBatch& batch) {
+                col.insert(ctx, batch, "shadowed", "new");
+                col.insert(ctx, batch, "updated", "new");
+                col.insert(ctx, batch, "new_only", "new");
+            });
+            commit_to(*db, [](Collection& col, TxnContext& ctx, TransactionBatch& batch) {
+                col.remove(ctx, batch, "shadowed");
+            });
+        }
+        std::filesystem::rename(old_gen_dir / "data.stax", db_dir / "data.stax_g0");
+    };
+
+    auto check_contents = [&](const std::string& stage) {
+        auto db = Database::open_existing(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("flat"));
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        const std::vector<std::pair<std::string, std::optional<std::string>>> want = {
+            {"shadowed", std::nullopt}, {"updated", "new"}, {"old_only", "old"}, {"new_only", "new"}};
+        for (const auto& [key, value] : want) {
+            auto res = col.get(read_ctx, key);
+            if (res.has_value() != value.has_value() || (res && res->value_view() != *value)) {
+                std::cerr << "FAIL: " << stage << ": '" << key << "' reads " << (res ? std::string(res->value_view()) : "nothing") << ", expected " << value.value_or("nothing") << "." << std::endl;
+                test_passed = false;
+            }
+        }
+        size_t scanned = 0;
+        for (auto cursor = col.seek_first(read_ctx); cursor->is_valid(); cursor->next()) {
+            scanned++;
+        }
+        if (scanned != 3) {
+            std::cerr << "FAIL: " << stage << ": scan visited " << scanned << " keys, expected 3." << std::endl;
+            test_passed = false;
+        }
+        col.abort(read_ctx);
+    };
+
+    for (bool bulk_build : {true, false}) {
+        const std::string mode = bulk_build ? "streaming bulk" : "insert";
+        build_generations();
+        check_contents("Before " + mode + " flatten");
+        Database::compact(db_dir, 2, true, bulk_build);
+        if (std::filesystem::exists(db_dir / "data.stax_g0")) {
+            std::cerr << "FAIL: The " << mode << " flatten left the older generation in place." << std::endl;
+            test_passed = false;
+        }
+        check_contents("After " + mode + " flatten");
+    }
+
+    finish_test(test_passed, "Flatten Compaction");
+}
+
+
 } 
 //
 
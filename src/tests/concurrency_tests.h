@@ -0,0 +1,527 @@
+#pragma once
+
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#include "stax_db/db.h"
+#include "stax_db/write_ahead_log.h"
+#include "stax_db/librarian.h"
+#include "stax_db/statistics.h"
+#include "stax_graph/graph_engine.h"
+#include "stax_tx/transaction.h"
+#include "tests/common_test_utils.h"
+
+namespace Tests {
+
+inline void run_librarian_test() {
+    std::cout << "\n--- Running Librarian Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_librarian");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    auto wait_for = [](const std::function<bool()>& condition) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return true;
+    };
+
+    // Tasks run on their intervals or on request; once a task spends the
+    // budget, the optional ones behind it wait and the mandatory ones do not.
+    {
+        Librarian librarian(std::chrono::milliseconds(50), std::chrono::seconds(10), 1000);
+        const auto never = std::chrono::hours(1);
+        librarian.add_task("frequent", std::chrono::milliseconds(10), [](Librarian::Budget&) {});
+        librarian.add_task("on_request", never, [](Librarian::Budget&) {});
+        librarian.add_task("failing", never, [](Librarian::Budget&) { throw std::runtime_error("expected task failure"); });
+        librarian.add_task("spender", never, [](Librarian::Budget& budget) { budget.charge_io(5000); });
+        librarian.add_task("optional", never, [](Librarian::Budget&) {});
+        librarian.add_task("mandatory", never, [](Librarian::Budget&) {}, true);
+
+        librarian.run_all_now();
+        if (librarian.get_run_count("spender") != 1 || librarian.get_run_count("optional") != 0 || librarian.get_run_count("mandatory") != 1) {
+            std::cerr << "FAIL: The budget did not hold off the optional task behind a spent one." << std::endl;
+            test_passed = false;
+        }
+
+        librarian.start();
+        librarian.request_run("failing");
+        librarian.request_run("on_request");
+        if (!wait_for([&] { return librarian.get_run_count("frequent") >= 3 && librarian.get_run_count("on_request") >= 1; })) {
+            std::cerr << "FAIL: The librarian thread did not run due or requested tasks." << std::endl;
+            test_passed = false;
+        }
+        librarian.stop();
+        const uint64_t runs_at_stop = librarian.get_run_count("frequent");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (librarian.get_run_count("frequent") != runs_at_stop || librarian.get_run_count("failing") != 2) {
+            std::cerr << "FAIL: Tasks ran after stop, or a failing task stopped the thread." << std::endl;
+            test_passed = false;
+        }
+        try {
+            librarian.get_run_count("missing");
+            std::cerr << "FAIL: Unknown task names were accepted." << std::endl;
+            test_passed = false;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    // Blocks the maintenance slot reclaims reach slots that never pooled a
+    // block of their own, and its writes are tracked apart from commits.
+    {
+        FreeBlockPool pool;
+        pool.push(MAINTENANCE_THREAD_SLOT, 4096, 64);
+        uint64_t block_offset = 0;
+        if (!pool.pop(3, 64, block_offset) || block_offset != 4096 || pool.pop(3, 64, block_offset)) {
+            std::cerr << "FAIL: A slot without lists of its own missed the shared free blocks." << std::endl;
+            test_passed = false;
+        }
+
+        DirtyRangeTracker tracker(4096, false);
+        tracker.mark(0, 0, 1);
+        tracker.mark(MAINTENANCE_THREAD_SLOT, 8192, 1);
+        std::vector<DirtyRangeTracker::Range> ranges;
+        tracker.take_all(ranges);
+        if (!ranges.empty()) {
+            std::cerr << "FAIL: A maintenance-only tracker handed ranges to commits." << std::endl;
+            test_passed = false;
+        }
+        tracker.take(MAINTENANCE_THREAD_SLOT, ranges);
+        if (ranges != std::vector<DirtyRangeTracker::Range>{{8192, 12288}}) {
+            std::cerr << "FAIL: The maintenance slot's writes were not tracked." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    // Keys nobody rewrites keep the versions an old snapshot once pinned
+    // until the maintenance sweep cuts them.
+    {
+        auto db = Database::create_new(db_dir, 2);
+        Collection& direct = db->get_collection_by_idx(db->get_collection("gc_direct"));
+        Collection& swept = db->get_collection_by_idx(db->get_collection("gc_swept"));
+        const size_t num_versions = 50;
+        TxnContext old_snapshot = direct.begin_transaction_context(1, true);
+        for (size_t i = 0; i < num_versions; ++i) {
+            for (Collection* col : {&direct, &swept}) {
+                TxnContext ctx = col->begin_transaction_context(0, false);
+                TransactionBatch batch;
+                col->insert(ctx, batch, "idle", "v" + std::to_string(i));
+                col->commit(ctx, batch);
+            }
+        }
+        direct.abort(old_snapshot);
+
+        Librarian& librarian = db->get_librarian();
+        librarian.stop();
+        std::string resume_key;
+        const size_t direct_cut = direct.get_critbit_tree().prune_version_chains(MAINTENANCE_THREAD_SLOT, resume_key, 16);
+        if (direct_cut != num_versions - 2 || !resume_key.empty()) {
+            std::cerr << "FAIL: Sweeping an idle chain cut " << direct_cut << " versions." << std::endl;
+            test_passed = false;
+        }
+
+        librarian.start();
+        librarian.run_all_now();
+        librarian.stop();
+        resume_key.clear();
+        if (librarian.get_run_count("version_gc") != 1 || swept.get_critbit_tree().prune_version_chains(MAINTENANCE_THREAD_SLOT, resume_key, 16) != 0) {
+            std::cerr << "FAIL: The version GC task left an idle chain uncut." << std::endl;
+            test_passed = false;
+        }
+        for (Collection* col : {&direct, &swept}) {
+            TxnContext ctx = col->begin_transaction_context(0, true);
+            auto res = col->get(ctx, "idle");
+            if (!res || res->value_view() != "v" + std::to_string(num_versions - 1)) {
+                std::cerr << "FAIL: Pruning an idle chain lost its newest version." << std::endl;
+                test_passed = false;
+            }
+            col->abort(ctx);
+        }
+
+        auto stats = db->get_cached_statistics();
+        if (!stats || stats->total_collections_count != 2 || db->is_compaction_recommended()) {
+            std::cerr << "FAIL: The statistics task did not refresh the cached statistics." << std::endl;
+            test_passed = false;
+        }
+    }
+    std::filesystem::remove_all(db_dir);
+
+    // Periodic commits return unsynced; the flush task makes them durable.
+    const size_t num_keys = 200;
+    {
+        auto db = Database::create_new(db_dir, 1, DurabilityLevel::Periodic);
+        Collection& col = db->get_collection_by_idx(db->get_collection("periodic"));
+        for (size_t i = 0; i < num_keys; ++i) {
+            TxnContext ctx = col.begin_transaction_context(0, false);
+            TransactionBatch batch;
+            col.insert(ctx, batch, "p:" + std::to_string(i), std::to_string(i));
+            col.commit(ctx, batch);
+        }
+        Librarian& librarian = db->get_librarian();
+        const uint64_t flushes_before = librarian.get_run_count("periodic_flush");
+        librarian.request_run("periodic_flush");
+        if (!wait_for([&] { return librarian.get_run_count("periodic_flush") > flushes_before; })) {
+            std::cerr << "FAIL: The periodic flush task did not run on request." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, 1, DurabilityLevel::Periodic);
+        Collection& col = db->get_collection_by_idx(db->get_collection("periodic"));
+        TxnContext ctx = col.begin_transaction_context(0, true);
+        for (size_t i = 0; i < num_keys; ++i) {
+            auto res = col.get(ctx, "p:" + std::to_string(i));
+            if (!res || res->value_view() != std::to_string(i)) {
+                std::cerr << "FAIL: Key p:" << i << " was lost across a Periodic reopen." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+        col.abort(ctx);
+    }
+
+    finish_test(test_passed, "Librarian");
+}
+
+inline void run_commit_watermark_test() {
+    std::cout << "\n--- Running Commit Watermark Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_commit_watermark");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        CommitWatermark watermark(20);
+        watermark.publish(0, 5);
+        watermark.publish(19, 7);
+        watermark.publish(40, 9);
+        watermark.publish(3, 4);
+        if (watermark.get() != 9) {
+            std::cerr << "FAIL: The watermark is not the newest commit over all shards." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    // Ids stay unique across threads, and a thread's batch from one
+    // generator is never handed out by another.
+    {
+        HybridTimestampGenerator generator;
+        const size_t num_threads = 8;
+        const size_t ids_per_thread = 20000;
+        std::vector<std::vector<TxnID>> ids(num_threads);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = 0; i < ids_per_thread; ++i) {
+                    ids[t].push_back(generator.get_next_id());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::vector<TxnID> all_ids;
+        for (const auto& thread_ids : ids) {
+            if (!std::is_sorted(thread_ids.begin(), thread_ids.end())) {
+                std::cerr << "FAIL: A thread's ids went backwards." << std::endl;
+                test_passed = false;
+            }
+            all_ids.insert(all_ids.end(), thread_ids.begin(), thread_ids.end());
+        }
+        std::sort(all_ids.begin(), all_ids.end());
+        if (std::adjacent_find(all_ids.begin(), all_ids.end()) != all_ids.end()) {
+            std::cerr << "FAIL: The generator handed out an id twice." << std::endl;
+            test_passed = false;
+        }
+
+        HybridTimestampGenerator other;
+        const TxnID floor = generator.get_next_id() + (1ULL << 40);
+        other.advance_past(floor);
+        generator.get_next_id();
+        if (other.get_next_id() <= floor) {
+            std::cerr << "FAIL: A generator handed out an id from another generator's batch." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    // A commit is visible from every slot once it returns, and the newest
+    // commit survives a reopen.
+    const size_t num_threads = 16;
+    const size_t commits_per_thread = 500;
+    TxnID last_committed_before_close = 0;
+    {
+        auto db = Database::create_new(db_dir, num_threads);
+        Collection& col = db->get_collection_by_idx(db->get_collection("watermark"));
+        std::atomic<bool> visible = true;
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (size_t i = 0; i < commits_per_thread; ++i) {
+                    const std::string key = "w:" + std::to_string(t) + ":" + std::to_string(i);
+                    TxnContext ctx = col.begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    col.insert(ctx, batch, key, key);
+                    col.commit(ctx, batch);
+                    TxnContext read_ctx = col.begin_transaction_context((t + 1) % num_threads, true);
+                    if (!col.get(read_ctx, key)) {
+                        visible = false;
+                    }
+                    col.abort(read_ctx);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        if (!visible) {
+            std::cerr << "FAIL: A returned commit was invisible from another slot." << std::endl;
+            test_passed = false;
+        }
+        last_committed_before_close = db->get_last_committed_txn_id();
+    }
+    {
+        auto db = Database::open_existing(db_dir, num_threads);
+        if (db->get_last_committed_txn_id() != last_committed_before_close || db->get_next_txn_id() <= last_committed_before_close) {
+            std::cerr << "FAIL: The last committed id was not persisted across a reopen." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Commit Watermark");
+}
+
+inline void run_thread_slot_leasing_test() {
+    std::cout << "\n--- Running Thread Slot Leasing Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_thread_slot_leasing");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    const size_t num_threads = 8;
+    {
+        auto db = Database::create_new(db_dir, num_threads);
+        Collection& col = db->get_collection_by_idx(db->get_collection("leases"));
+
+        // Each thread keeps one slot across calls, and no two threads
+        // hold the same slot at once.
+        std::vector<size_t> slots(num_threads);
+        std::atomic<bool> stable = true;
+        std::atomic<size_t> leased = 0;
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                slots[t] = db->get_thread_slot();
+                leased.fetch_add(1);
+                for (size_t i = 0; i < 200; ++i) {
+                    const std::string key = "k:" + std::to_string(t) + ":" + std::to_string(i);
+                    col.insert_sync_direct(key, key, db->get_thread_slot());
+                    if (db->get_thread_slot() != slots[t]) {
+                        stable = false;
+                    }
+                }
+                while (leased.load() < num_threads) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::vector<size_t> sorted_slots = slots;
+        std::sort(sorted_slots.begin(), sorted_slots.end());
+        if (!stable || std::adjacent_find(sorted_slots.begin(), sorted_slots.end()) != sorted_slots.end() || sorted_slots.back() >= num_threads) {
+            std::cerr << "FAIL: Threads did not each keep a distinct slot." << std::endl;
+            test_passed = false;
+        }
+
+        // Exited threads gave their slots back.
+        if (db->get_leased_thread_slot_count() != 0) {
+            std::cerr << "FAIL: Slots were not returned on thread exit." << std::endl;
+            test_passed = false;
+        }
+
+        // Leasing past the configured slots throws.
+        std::atomic<size_t> failures = 0;
+        std::atomic<size_t> arrived = 0;
+        std::vector<std::thread> over_leasers;
+        for (size_t t = 0; t < num_threads + 1; ++t) {
+            over_leasers.emplace_back([&]() {
+                try {
+                    db->get_thread_slot();
+                } catch (const std::runtime_error&) {
+                    failures.fetch_add(1);
+                }
+                arrived.fetch_add(1);
+                while (arrived.load() < num_threads + 1) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& over_leaser : over_leasers) {
+            over_leaser.join();
+        }
+        if (failures.load() != 1) {
+            std::cerr << "FAIL: Leasing more slots than configured did not throw exactly once." << std::endl;
+            test_passed = false;
+        }
+
+        TxnContext read_ctx = col.begin_transaction_context(db->get_thread_slot(), true);
+        for (size_t t = 0; t < num_threads; ++t) {
+            if (!col.get(read_ctx, "k:" + std::to_string(t) + ":199")) {
+                std::cerr << "FAIL: A write made on a leased slot is missing." << std::endl;
+                test_passed = false;
+            }
+        }
+        col.abort(read_ctx);
+    }
+
+    // A lease on a closed database does not carry over to the next one
+    // opened on this thread.
+    {
+        auto db = Database::open_existing(db_dir, num_threads);
+        const size_t slot = db->get_thread_slot();
+        if (slot >= num_threads || db->get_leased_thread_slot_count() != 1) {
+            std::cerr << "FAIL: A reopened database reused a stale lease." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Thread Slot Leasing");
+}
+
+inline void run_multi_collection_commit_test() {
+    std::cout << "\n--- Running Multi-Collection Commit Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_multi_collection_commit");
+    const std::filesystem::path& db_dir = test_dir.path();
+    const std::filesystem::path log_path = db_dir / "data.wal";
+
+    // One flush per transaction, however many collections it writes.
+    uint32_t left_idx;
+    uint32_t right_idx;
+    {
+        auto db = Database::create_new(db_dir, 1, DurabilityLevel::SyncOnCommit);
+        left_idx = db->get_collection("left");
+        right_idx = db->get_collection("right");
+        Collection& left = db->get_collection_by_idx(left_idx);
+        Collection& right = db->get_collection_by_idx(right_idx);
+
+        uint64_t flushes_before = db->get_commit_flush_count();
+        {
+            MultiCollectionTransaction txn(db.get(), 0);
+            txn.insert(left, "a", "left");
+            txn.insert(right, "a", "right");
+            txn.insert(right, "b", "right");
+            txn.commit();
+        }
+        if (db->get_commit_flush_count() != flushes_before + 1) {
+            std::cerr << "FAIL: A two-collection commit took " << db->get_commit_flush_count() - flushes_before << " flushes." << std::endl;
+            test_passed = false;
+        }
+
+        flushes_before = db->get_commit_flush_count();
+        {
+            GraphTransaction txn(db.get(), 0);
+            txn.insert_fact(1, 2, 3);
+            txn.commit();
+        }
+        if (db->get_commit_flush_count() != flushes_before + 1) {
+            std::cerr << "FAIL: A graph commit took " << db->get_commit_flush_count() - flushes_before << " flushes." << std::endl;
+            test_passed = false;
+        }
+
+        {
+            MultiCollectionTransaction txn(db.get(), 0);
+            txn.insert(left, "aborted", "x");
+            txn.insert(right, "aborted", "x");
+        }
+
+        TxnContext read_ctx = left.begin_transaction_context(0, true);
+        if (!left.get(read_ctx, "a") || !right.get(read_ctx, "a") || !right.get(read_ctx, "b") ||
+            left.get(read_ctx, "aborted") || right.get(read_ctx, "aborted")) {
+            std::cerr << "FAIL: A multi-collection transaction did not commit or abort as a whole." << std::endl;
+            test_passed = false;
+        }
+        left.abort(read_ctx);
+    }
+
+    // A transaction's frames are replayed together or not at all.
+    TxnID first_logged_id;
+    {
+        auto db = Database::open_existing(db_dir, 1);
+        TxnContext id_ctx = db->begin_transaction_context(0, false);
+        first_logged_id = id_ctx.txn_id + 1;
+        db->abort(id_ctx);
+    }
+    {
+        WriteAheadLog log(log_path);
+        std::string frames;
+        TransactionBatch whole_left;
+        WriteAheadLog::append_insert(whole_left.redo_ops, "whole", "left");
+        TransactionBatch whole_right;
+        WriteAheadLog::append_insert(whole_right.redo_ops, "whole", "right");
+        WriteAheadLog::append_frame(frames, first_logged_id, left_idx, whole_left, 1);
+        WriteAheadLog::append_frame(frames, first_logged_id, right_idx, whole_right, 0);
+        TransactionBatch torn_left;
+        WriteAheadLog::append_insert(torn_left.redo_ops, "torn", "left");
+        TransactionBatch torn_right;
+        WriteAheadLog::append_insert(torn_right.redo_ops, "torn", "right");
+        WriteAheadLog::append_frame(frames, first_logged_id + 1, left_idx, torn_left, 1);
+        std::string torn;
+        WriteAheadLog::append_frame(torn, first_logged_id + 1, right_idx, torn_right, 0);
+        frames.append(torn, 0, torn.size() - 3);
+        if (!log.append_and_sync(frames).empty()) {
+            std::cerr << "FAIL: Could not write the test log." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, 1, DurabilityLevel::Wal);
+        Collection& left = db->get_collection_by_idx(left_idx);
+        Collection& right = db->get_collection_by_idx(right_idx);
+        TxnContext read_ctx = left.begin_transaction_context(0, true);
+        if (!left.get(read_ctx, "whole") || !right.get(read_ctx, "whole") || left.get(read_ctx, "torn") || right.get(read_ctx, "torn")) {
+            std::cerr << "FAIL: Replay split a multi-collection transaction." << std::endl;
+            test_passed = false;
+        }
+        left.abort(read_ctx);
+
+        // Under Wal the frames of one transaction share one log sync.
+        const uint64_t syncs_before = db->get_commit_flush_count();
+        {
+            MultiCollectionTransaction txn(db.get(), 0);
+            txn.insert(left, "logged", "left");
+            txn.insert(right, "logged", "right");
+            txn.commit();
+        }
+        if (db->get_commit_flush_count() != syncs_before + 1) {
+            std::cerr << "FAIL: A two-collection commit took " << db->get_commit_flush_count() - syncs_before << " log syncs." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, 1);
+        Collection& left = db->get_collection_by_idx(left_idx);
+        Collection& right = db->get_collection_by_idx(right_idx);
+        TxnContext read_ctx = left.begin_transaction_context(0, true);
+        if (!left.get(read_ctx, "logged") || !right.get(read_ctx, "logged")) {
+            std::cerr << "FAIL: A logged multi-collection commit was lost across a reopen." << std::endl;
+            test_passed = false;
+        }
+        left.abort(read_ctx);
+    }
+
+    finish_test(test_passed, "Multi-Collection Commit");
+}
+
+}
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+
+#include "stax_db/db.h"
+#include "stax_db/write_ahead_log.h"
+#include "stax_tx/transaction.h"
+#include "stax_tx/db_cursor.hpp"
+#include "tests/common_test_utils.h"
+
+namespace Tests {
+
+inline void run_dirty_range_sync_test() {
+    std::cout << "\n--- Running Dirty Range Sync Test ---" << std::endl;
+    bool test_passed = true;
+
+    {
+        DirtyRangeTracker tracker(4096);
+        tracker.mark(0, 10, 8);
+        tracker.mark(0, 100000, 1);
+        tracker.mark(0, 5000, 100);
+        tracker.mark(0, 4090, 20);
+        tracker.mark(1, 8192, 4096);
+        std::vector<DirtyRangeTracker::Range> ranges;
+        tracker.take(0, ranges);
+        const std::vector<DirtyRangeTracker::Range> expected = {{0, 8192}, {98304, 102400}};
+        if (ranges != expected) {
+            std::cerr << "FAIL: Dirty ranges were not page aligned and merged." << std::endl;
+            test_passed = false;
+        }
+        tracker.take(0, ranges);
+        if (!ranges.empty()) {
+            std::cerr << "FAIL: Taking the dirty ranges did not reset the slot." << std::endl;
+            test_passed = false;
+        }
+        tracker.take(1, ranges);
+        if (ranges != std::vector<DirtyRangeTracker::Range>{{8192, 12288}}) {
+            std::cerr << "FAIL: Dirty ranges leaked between thread slots." << std::endl;
+            test_passed = false;
+        }
+
+        // A commit flushes what every slot has dirtied, since its key can
+        // hang under nodes another slot linked.
+        tracker.mark(0, 0, 1);
+        tracker.mark(2, 40960, 1);
+        ranges.clear();
+        tracker.take_all(ranges);
+        DirtyRangeTracker::coalesce(ranges);
+        if (ranges != std::vector<DirtyRangeTracker::Range>{{0, 4096}, {40960, 45056}}) {
+            std::cerr << "FAIL: Taking every slot's dirty ranges missed a slot." << std::endl;
+            test_passed = false;
+        }
+        ranges.clear();
+        tracker.take_all(ranges);
+        if (!ranges.empty()) {
+            std::cerr << "FAIL: Taking every slot's dirty ranges did not reset them." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    TestDbDir test_dir("./db_data_dirty_range_sync");
+    const std::filesystem::path& db_dir = test_dir.path();
+    const size_t num_threads = 4;
+    const size_t keys_per_thread = 2000;
+    auto key_for = [](size_t t, size_t i) { return "sync:" + std::to_string(t) + ":" + std::to_string(i); };
+    {
+        auto db = Database::create_new(db_dir, num_threads, DurabilityLevel::SyncOnCommit);
+        Collection& col = db->get_collection_by_idx(db->get_collection("synced"));
+        col.enable_order_statistics();
+        col.enable_hash_index(num_threads * keys_per_thread);
+
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (size_t i = 0; i < keys_per_thread; ++i) {
+                    TxnContext ctx = col.begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    col.insert(ctx, batch, key_for(t, i), "v" + std::to_string(i));
+                    if (i % 10 == 9) {
+                        col.remove(ctx, batch, key_for(t, i - 1));
+                    }
+                    col.commit(ctx, batch);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+    }
+
+    {
+        auto db = Database::open_existing(db_dir, num_threads, DurabilityLevel::SyncOnCommit);
+        Collection& col = db->get_collection_by_idx(db->get_collection("synced"));
+        TxnContext ctx = col.begin_transaction_context(0, true);
+        for (size_t t = 0; t < num_threads && test_passed; ++t) {
+            for (size_t i = 0; i < keys_per_thread; ++i) {
+                const bool removed = (i % 10 == 8);
+                auto res = col.get(ctx, key_for(t, i));
+                if (removed ? res.has_value() : (!res || res->value_view() != "v" + std::to_string(i))) {
+                    std::cerr << "FAIL: Wrong value for " << key_for(t, i) << " after reopening a durable database." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+        }
+        const uint64_t expected_live = num_threads * (keys_per_thread - keys_per_thread / 10);
+        if (col.get_critbit_tree().count_prefix("sync:") != expected_live) {
+            std::cerr << "FAIL: Live key counts did not survive reopening a durable database." << std::endl;
+            test_passed = false;
+        }
+        col.abort(ctx);
+    }
+
+    finish_test(test_passed, "Dirty Range Sync");
+}
+
+inline void run_group_commit_test() {
+    std::cout << "\n--- Running Group Commit Test ---" << std::endl;
+    bool test_passed = true;
+
+    {
+        // Committers arriving while the first group is flushing all wait for
+        // it and then go to disk together.
+        GroupCommitQueue queue;
+        std::mutex flushed_mutex;
+        std::vector<TxnID> flushed_txn_ids;
+        std::atomic<bool> first_flush_started = false;
+        auto flush_group = [&](const std::vector<GroupCommitQueue::Request *> &group) {
+            if (!first_flush_started.exchange(true)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            std::lock_guard<std::mutex> lock(flushed_mutex);
+            for (const GroupCommitQueue::Request *request : group) {
+                flushed_txn_ids.push_back(request->txn_id);
+            }
+            return std::string();
+        };
+
+        const size_t num_committers = 8;
+        std::vector<std::thread> committers;
+        std::atomic<size_t> failed_submits = 0;
+        for (size_t t = 0; t < num_committers; ++t) {
+            committers.emplace_back([&, t]() {
+                GroupCommitQueue::Request request;
+                request.txn_id = t + 1;
+                if (!queue.submit(request, flush_group).empty() || !request.done) {
+                    failed_submits++;
+                }
+            });
+            if (t == 0) {
+                while (!first_flush_started.load()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        for (auto& committer : committers) {
+            committer.join();
+        }
+
+        std::sort(flushed_txn_ids.begin(), flushed_txn_ids.end());
+        if (failed_submits != 0 || flushed_txn_ids.size() != num_committers || std::adjacent_find(flushed_txn_ids.begin(), flushed_txn_ids.end()) != flushed_txn_ids.end()) {
+            std::cerr << "FAIL: Each queued commit must be flushed exactly once." << std::endl;
+            test_passed = false;
+        }
+        if (queue.get_flushed_group_count() >= num_committers) {
+            std::cerr << "FAIL: Waiting committers were not flushed as a group (" << queue.get_flushed_group_count() << " flushes)." << std::endl;
+            test_passed = false;
+        }
+
+        GroupCommitQueue::Request failing_request;
+        const std::string error = queue.submit(failing_request, [](const std::vector<GroupCommitQueue::Request *> &) { return std::string("disk full"); });
+        if (error != "disk full" || !failing_request.done) {
+            std::cerr << "FAIL: A failed group flush was not reported to its committers." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    TestDbDir test_dir("./db_data_group_commit");
+    const std::filesystem::path& db_dir = test_dir.path();
+    {
+        const size_t num_threads = 8;
+        const size_t commits_per_thread = 250;
+        auto db = Database::create_new(db_dir, num_threads, DurabilityLevel::SyncOnCommit);
+        Collection& col = db->get_collection_by_idx(db->get_collection("grouped"));
+
+        // A durable commit is visible to every snapshot taken after it returns.
+        std::atomic<bool> visibility_ok = true;
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (size_t i = 0; i < commits_per_thread; ++i) {
+                    const std::string key = "group:" + std::to_string(t) + ":" + std::to_string(i);
+                    TxnContext ctx = col.begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    col.insert(ctx, batch, key, key);
+                    col.commit(ctx, batch);
+
+                    TxnContext read_ctx = col.begin_transaction_context(t, true);
+                    auto res = col.get(read_ctx, key);
+                    if (!res || res->value_view() != key) {
+                        visibility_ok = false;
+                    }
+                    col.abort(read_ctx);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+
+        if (!visibility_ok) {
+            std::cerr << "FAIL: A durable commit was not visible once it returned." << std::endl;
+            test_passed = false;
+        }
+        TxnContext ctx = col.begin_transaction_context(0, true);
+        size_t visible_keys = 0;
+        for (auto cursor = col.seek(ctx, "group:"); cursor->is_valid(); cursor->next()) {
+            visible_keys++;
+        }
+        col.abort(ctx);
+        if (visible_keys != num_threads * commits_per_thread) {
+            std::cerr << "FAIL: Expected " << num_threads * commits_per_thread << " committed keys, saw " << visible_keys << "." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Group Commit");
+}
+
+inline void run_write_ahead_log_test() {
+    std::cout << "\n--- Running Write-Ahead Log Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_write_ahead_log");
+    const std::filesystem::path& db_dir = test_dir.path();
+    std::filesystem::path log_path = db_dir / "data.wal";
+
+    // Commits logged by a session whose data pages never reached the file
+    // are replayed on open; a frame torn by the crash is dropped.
+    TxnID first_logged_id;
+    uint32_t collection_idx;
+    {
+        auto db = Database::create_new(db_dir, 1);
+        collection_idx = db->get_collection("wal");
+        Collection& col = db->get_collection_by_idx(collection_idx);
+        TxnContext ctx = col.begin_transaction_context(0, false);
+        TransactionBatch batch;
+        col.insert(ctx, batch, "base", "old");
+        col.insert(ctx, batch, "kept", "kept");
+        col.commit(ctx, batch);
+        TxnContext id_ctx = col.begin_transaction_context(0, false);
+        first_logged_id = id_ctx.txn_id + 1;
+        col.abort(id_ctx);
+    }
+    {
+        WriteAheadLog log(log_path);
+        std::string frames;
+        TransactionBatch first;
+        WriteAheadLog::append_insert(first.redo_ops, "k1", "v1");
+        WriteAheadLog::append_remove(first.redo_ops, "base");
+        WriteAheadLog::append_frame(frames, first_logged_id, collection_idx, first);
+        TransactionBatch second;
+        WriteAheadLog::append_insert(second.redo_ops, "k1", "v2");
+        WriteAheadLog::append_insert(second.redo_ops, "k2", std::string(5000, 'x'));
+        second.logical_item_count_delta = 1;
+        WriteAheadLog::append_frame(frames, first_logged_id + 1, collection_idx, second);
+        std::string torn;
+        TransactionBatch third;
+        WriteAheadLog::append_insert(third.redo_ops, "torn", "torn");
+        WriteAheadLog::append_frame(torn, first_logged_id + 2, collection_idx, third);
+        frames.append(torn, 0, torn.size() - 3);
+        if (!log.append_and_sync(frames).empty()) {
+            std::cerr << "FAIL: Could not write the test log." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, 1, DurabilityLevel::Wal);
+        Collection& col = db->get_collection_by_idx(collection_idx);
+        TxnContext ctx = col.begin_transaction_context(0, true);
+        auto k1 = col.get(ctx, "k1");
+        auto k2 = col.get(ctx, "k2");
+        auto kept = col.get(ctx, "kept");
+        if (!k1 || k1->value_view() != "v2" || !k2 || k2->value_view() != std::string(5000, 'x') || !kept || col.get(ctx, "base") || col.get(ctx, "torn")) {
+            std::cerr << "FAIL: Replaying the log did not restore exactly the intact frames." << std::endl;
+            test_passed = false;
+        }
+        col.abort(ctx);
+        if (std::filesystem::file_size(log_path) != 0) {
+            std::cerr << "FAIL: The log was not emptied by the checkpoint after replay." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    // Regular Wal sessions log their commits and leave an empty log behind.
+    const size_t num_threads = 4;
+    const size_t commits_per_thread = 500;
+    {
+        auto db = Database::open_existing(db_dir, num_threads, DurabilityLevel::Wal);
+        Collection& col = db->get_collection_by_idx(db->get_collection("wal_live"));
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (size_t i = 0; i < commits_per_thread; ++i) {
+                    TxnContext ctx = col.begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    const std::string key = "live:" + std::to_string(t) + ":" + std::to_string(i);
+                    col.insert(ctx, batch, key, key);
+                    if (i % 5 == 4) {
+                        col.remove(ctx, batch, "live:" + std::to_string(t) + ":" + std::to_string(i - 1));
+                    }
+                    col.commit(ctx, batch);
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        db->checkpoint();
+        if (std::filesystem::file_size(log_path) != 0) {
+            std::cerr << "FAIL: An explicit checkpoint left records in the log." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, num_threads, DurabilityLevel::Wal);
+        Collection& col = db->get_collection_by_idx(db->get_collection("wal_live"));
+        TxnContext ctx = col.begin_transaction_context(0, true);
+        for (size_t t = 0; t < num_threads && test_passed; ++t) {
+            for (size_t i = 0; i < commits_per_thread; ++i) {
+                const std::string key = "live:" + std::to_string(t) + ":" + std::to_string(i);
+                auto res = col.get(ctx, key);
+                if ((i % 5 == 3) ? res.has_value() : (!res || res->value_view() != key)) {
+                    std::cerr << "FAIL: Wrong state for " << key << " after reopening a Wal database." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+        }
+        col.abort(ctx);
+    }
+
+    // A frame whose pages, entry included, reached the file before the crash
+    // is replayed onto the checkpointed counters, not counted twice.
+    uint32_t counts_idx;
+    {
+        auto db = Database::open_existing(db_dir, 1, DurabilityLevel::Wal);
+        counts_idx = db->get_collection("wal_counts");
+        Collection& col = db->get_collection_by_idx(counts_idx);
+        TxnContext ctx = col.begin_transaction_context(0, false);
+        TransactionBatch batch;
+        for (size_t i = 0; i < 3; ++i) {
+            col.insert(ctx, batch, "count:" + std::to_string(i), "v");
+        }
+        col.commit(ctx, batch);
+    }
+    TxnID written_back_id;
+    {
+        auto db = Database::open_existing(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(counts_idx);
+        TxnContext ctx = col.begin_transaction_context(0, false);
+        written_back_id = ctx.txn_id;
+        TransactionBatch batch;
+        col.insert(ctx, batch, "count:written_back", "v");
+        col.commit(ctx, batch);
+    }
+    {
+        WriteAheadLog log(log_path);
+        std::string frames;
+        TransactionBatch batch;
+        WriteAheadLog::append_insert(batch.redo_ops, "count:written_back", "v");
+        batch.logical_item_count_delta = 1;
+        WriteAheadLog::append_frame(frames, written_back_id, counts_idx, batch);
+        if (!log.append_and_sync(frames).empty()) {
+            std::cerr << "FAIL: Could not write the test log." << std::endl;
+            test_passed = false;
+        }
+    }
+    {
+        auto db = Database::open_existing(db_dir, 1, DurabilityLevel::Wal);
+        const uint64_t count = db->get_active_generation()->get_collection_entry_ref(counts_idx).logical_item_count.load();
+        if (count != 4) {
+            std::cerr << "FAIL: Replay left the item count at " << count << ", expected 4." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Write-Ahead Log");
+}
+
+}
@@ -0,0 +1,1462 @@
+#pragma once
+
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+
+#include "stax_db/db.h"
+#include "stax_core/stax_tree.hpp"
+#include "stax_tx/transaction.h"
+#include "stax_tx/db_cursor.hpp"
+#include "tests/common_test_utils.h"
+
+namespace Tests {
+
+inline void run_multi_get_correctness_test() {
+    std::cout << "\n--- Running Batched Multi-Get Correctness Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_multi_get");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("multi_get"));
+        StaxTree& tree = col.get_critbit_tree();
+
+        const size_t num_keys = 5000;
+        TxnContext insert_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch insert_batch;
+        for (size_t i = 0; i < num_keys; ++i) {
+            col.insert(insert_ctx, insert_batch, "mg:" + std::to_string(i), "v1:" + std::to_string(i));
+        }
+        col.commit(insert_ctx, insert_batch);
+        TxnContext before_update_ctx = col.begin_transaction_context(0, true);
+
+        TxnContext update_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch update_batch;
+        for (size_t i = 0; i < num_keys; i += 3) {
+            col.insert(update_ctx, update_batch, "mg:" + std::to_string(i), "v2:" + std::to_string(i));
+        }
+        for (size_t i = 1; i < num_keys; i += 7) {
+            col.remove(update_ctx, update_batch, "mg:" + std::to_string(i));
+        }
+        col.commit(update_ctx, update_batch);
+        TxnContext after_update_ctx = col.begin_transaction_context(0, true);
+
+        std::vector<std::string> key_storage;
+        for (size_t i = 0; i < num_keys + 500; ++i) {
+            key_storage.push_back("mg:" + std::to_string(i));
+            if (i % 11 == 0) key_storage.push_back("absent:" + std::to_string(i));
+        }
+        std::vector<std::string_view> keys(key_storage.begin(), key_storage.end());
+
+        for (const TxnContext* ctx : {&before_update_ctx, &after_update_ctx}) {
+            std::vector<std::optional<RecordData>> results;
+            tree.multi_get_simd(*ctx, keys, results);
+            if (results.size() != keys.size()) {
+                std::cerr << "FAIL: Multi-Get returned " << results.size() << " results for " << keys.size() << " keys." << std::endl;
+                test_passed = false;
+                continue;
+            }
+            for (size_t i = 0; i < keys.size(); ++i) {
+                auto expected = tree.get(*ctx, keys[i]);
+                if (expected.has_value() != results[i].has_value() ||
+                    (expected && expected->value_view() != results[i]->value_view())) {
+                    std::cerr << "FAIL: Multi-Get mismatch for key '" << keys[i] << "' at snapshot " << ctx->read_snapshot_id << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    finish_test(test_passed, "Batched Multi-Get Correctness");
+}
+
+inline void run_bulk_load_correctness_test() {
+    std::cout << "\n--- Running Bulk Load Correctness Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_bulk_load");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("bulk_load"));
+        StaxTree& tree = col.get_critbit_tree();
+
+        std::vector<std::pair<std::string, std::string>> rows;
+        for (size_t i = 0; i < 20000; ++i) {
+            rows.emplace_back("bl:" + std::to_string(i * 7919 % 100003), "v:" + std::to_string(i));
+        }
+        rows.emplace_back("bl", "prefix");
+        rows.emplace_back("bl:1", "dup-a");
+        rows.emplace_back("bl:1", "dup-b");
+        rows.emplace_back(std::string("bl:\xff\x01", 5), "high-bytes");
+        std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<CoreKVPair> pairs;
+        std::map<std::string, std::string> expected;
+        for (const auto& row : rows) {
+            pairs.push_back({row.first, row.second});
+            expected[row.first] = row.second;
+        }
+
+        TxnContext load_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch load_batch;
+        if (!tree.bulk_load(load_ctx, pairs.data(), pairs.size(), load_batch)) {
+            std::cerr << "FAIL: Bulk load was rejected on an empty tree with sorted input." << std::endl;
+            test_passed = false;
+        }
+        col.commit(load_ctx, load_batch);
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        for (const auto& pair : expected) {
+            auto res = col.get(read_ctx, pair.first);
+            if (!res || res->value_view() != pair.second) {
+                std::cerr << "FAIL: Bulk-loaded key '" << pair.first << "' not found or has wrong value." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+
+        auto it = expected.begin();
+        size_t visited = 0;
+        for (auto cursor = col.seek_first(read_ctx); cursor->is_valid(); cursor->next(), ++visited) {
+            if (it == expected.end() || cursor->key() != it->first) {
+                std::cerr << "FAIL: Cursor order diverged after bulk load at position " << visited << "." << std::endl;
+                test_passed = false;
+                break;
+            }
+            ++it;
+        }
+        if (test_passed && visited != expected.size()) {
+            std::cerr << "FAIL: Cursor visited " << visited << " keys, expected " << expected.size() << "." << std::endl;
+            test_passed = false;
+        }
+
+        TxnContext second_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch second_batch;
+        if (tree.bulk_load(second_ctx, pairs.data(), pairs.size(), second_batch)) {
+            std::cerr << "FAIL: Bulk load accepted a non-empty tree." << std::endl;
+            test_passed = false;
+        }
+        col.abort(second_ctx);
+
+        // A loader that loses the publish hands its records and nodes back;
+        // later inserts reuse that space without disturbing the tree.
+        TxnContext lost_ctx = col.begin_transaction_context(0, false);
+        StaxTree::BulkLoader lost_loader(tree, lost_ctx);
+        for (size_t i = 0; i < 5000; ++i) {
+            lost_loader.append("lost:" + std::to_string(100000 + i), "v");
+        }
+        if (lost_loader.publish()) {
+            std::cerr << "FAIL: BulkLoader published over a non-empty tree." << std::endl;
+            test_passed = false;
+        }
+        col.abort(lost_ctx);
+        TxnContext reuse_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch reuse_batch;
+        for (size_t i = 0; i < 5000; ++i) {
+            col.insert(reuse_ctx, reuse_batch, "reuse:" + std::to_string(100000 + i), "r");
+        }
+        col.commit(reuse_ctx, reuse_batch);
+        TxnContext reuse_read_ctx = col.begin_transaction_context(0, true);
+        for (const auto& pair : expected) {
+            auto res = col.get(reuse_read_ctx, pair.first);
+            if (!res || res->value_view() != pair.second) {
+                std::cerr << "FAIL: Key '" << pair.first << "' changed after a lost bulk publish." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+        for (size_t i = 0; i < 5000 && test_passed; i += 97) {
+            auto res = col.get(reuse_read_ctx, "reuse:" + std::to_string(100000 + i));
+            if (!res || res->value_view() != "r" || col.get(reuse_read_ctx, "lost:" + std::to_string(100000 + i))) {
+                std::cerr << "FAIL: Inserts after a lost bulk publish read back wrong." << std::endl;
+                test_passed = false;
+            }
+        }
+        col.abort(reuse_read_ctx);
+
+        StaxTree::BulkLoader loader(tree, second_ctx);
+        loader.append("b", "1");
+        try {
+            loader.append("a", "2");
+            std::cerr << "FAIL: BulkLoader accepted keys in descending order." << std::endl;
+            test_passed = false;
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    finish_test(test_passed, "Bulk Load Correctness");
+}
+
+inline void run_span_node_correctness_test() {
+    std::cout << "\n--- Running Span Node Correctness Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_span_nodes");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    auto binary_key = [](uint32_t v) {
+        std::string key(4, '\0');
+        for (int b = 0; b < 4; ++b) key[b] = static_cast<char>((v >> (24 - 8 * b)) & 0xFF);
+        return key;
+    };
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("span_nodes"));
+        StaxTree& tree = col.get_critbit_tree();
+
+        std::map<std::string, std::string> expected;
+        for (uint32_t i = 0; i < 30000; ++i) {
+            expected[binary_key(i * 2654435761u)] = "b:" + std::to_string(i);
+            expected["sp:" + std::to_string(i)] = "s:" + std::to_string(i);
+        }
+
+        std::vector<CoreKVPair> pairs;
+        for (const auto& pair : expected) {
+            pairs.push_back({pair.first, pair.second});
+        }
+        TxnContext load_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch load_batch;
+        tree.insert_batch(load_ctx, pairs.data(), pairs.size(), load_batch);
+        col.commit(load_ctx, load_batch);
+
+        TxnContext write_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch write_batch;
+        for (uint32_t i = 0; i < 30000; i += 5) {
+            std::string value = "updated:" + std::to_string(i);
+            col.insert(write_ctx, write_batch, "sp:" + std::to_string(i), value);
+            expected["sp:" + std::to_string(i)] = value;
+        }
+        for (uint32_t i = 1; i < 30000; i += 9) {
+            col.remove(write_ctx, write_batch, binary_key(i * 2654435761u));
+            expected.erase(binary_key(i * 2654435761u));
+        }
+        for (uint32_t i = 0; i < 5000; ++i) {
+            std::string key = binary_key(i * 40503u + 17);
+            col.insert(write_ctx, write_batch, key, "late:" + std::to_string(i));
+            expected[key] = "late:" + std::to_string(i);
+            col.insert(write_ctx, write_batch, "sq:" + std::to_string(i), "late");
+            expected["sq:" + std::to_string(i)] = "late";
+        }
+        col.commit(write_ctx, write_batch);
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        std::vector<std::string_view> lookup_keys;
+        for (const auto& pair : expected) {
+            lookup_keys.push_back(pair.first);
+            auto res = col.get(read_ctx, pair.first);
+            if (!res || res->value_view() != pair.second) {
+                std::cerr << "FAIL: Key with value '" << pair.second << "' not found or stale after mixing span nodes and inserts." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+        for (uint32_t i = 0; i < 2000; ++i) {
+            std::string absent = "sp:x" + std::to_string(i);
+            if (col.get(read_ctx, absent)) {
+                std::cerr << "FAIL: Absent key '" << absent << "' was found." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+
+        std::vector<std::optional<RecordData>> results;
+        tree.multi_get_simd(read_ctx, lookup_keys, results);
+        for (size_t i = 0; i < lookup_keys.size(); ++i) {
+            if (!results[i] || results[i]->value_view() != expected[std::string(lookup_keys[i])]) {
+                std::cerr << "FAIL: Multi-Get disagrees with expected state through span nodes." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+
+        auto it = expected.begin();
+        size_t visited = 0;
+        for (auto cursor = col.seek_first(read_ctx); cursor->is_valid(); cursor->next(), ++visited) {
+            if (it == expected.end() || cursor->key() != it->first) {
+                std::cerr << "FAIL: Cursor order diverged through span nodes at position " << visited << "." << std::endl;
+                test_passed = false;
+                break;
+            }
+            ++it;
+        }
+        if (test_passed && visited != expected.size()) {
+            std::cerr << "FAIL: Cursor visited " << visited << " keys, expected " << expected.size() << "." << std::endl;
+            test_passed = false;
+        }
+
+        std::vector<uint64_t> prefix_leaves;
+        tree.find_leaf_nodes_in_range("sq:1", prefix_leaves);
+        size_t expected_prefix_count = 0;
+        for (auto p = expected.lower_bound("sq:1"); p != expected.end() && p->first.rfind("sq:1", 0) == 0; ++p) {
+            ++expected_prefix_count;
+        }
+        if (prefix_leaves.size() != expected_prefix_count) {
+            std::cerr << "FAIL: Prefix scan found " << prefix_leaves.size() << " leaves, expected " << expected_prefix_count << "." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Span Node Correctness");
+}
+
+inline void run_leaf_fingerprint_test() {
+    std::cout << "\n--- Running Leaf Fingerprint Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_fingerprints");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("fingerprints"));
+
+        const std::string long_prefix(40, 'p');
+        TxnContext insert_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch insert_batch;
+        for (size_t i = 0; i < 4000; ++i) {
+            col.insert(insert_ctx, insert_batch, long_prefix + std::to_string(i), "v1");
+            col.insert(insert_ctx, insert_batch, "k" + std::to_string(i), "v1");
+        }
+        col.insert(insert_ctx, insert_batch, "", "empty-key");
+        col.commit(insert_ctx, insert_batch);
+
+        TxnContext update_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch update_batch;
+        for (size_t i = 0; i < 4000; i += 2) {
+            col.insert(update_ctx, update_batch, long_prefix + std::to_string(i), "v2");
+            col.remove(update_ctx, update_batch, "k" + std::to_string(i));
+        }
+        col.commit(update_ctx, update_batch);
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        for (size_t i = 0; i < 4000 && test_passed; ++i) {
+            auto long_res = col.get(read_ctx, long_prefix + std::to_string(i));
+            auto short_res = col.get(read_ctx, "k" + std::to_string(i));
+            bool long_ok = long_res && long_res->value_view() == (i % 2 == 0 ? "v2" : "v1");
+            bool short_ok = (i % 2 == 0) ? !short_res.has_value() : (short_res && short_res->value_view() == "v1");
+            if (!long_ok || !short_ok) {
+                std::cerr << "FAIL: Wrong result for fingerprinted key index " << i << "." << std::endl;
+                test_passed = false;
+            }
+            if (col.get(read_ctx, long_prefix + std::to_string(i) + "x") || col.get(read_ctx, "k" + std::to_string(i + 4000))) {
+                std::cerr << "FAIL: Near-miss key index " << i << " was found." << std::endl;
+                test_passed = false;
+            }
+        }
+        auto empty_res = col.get(read_ctx, "");
+        if (!empty_res || empty_res->value_view() != "empty-key") {
+            std::cerr << "FAIL: Empty key not found." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Leaf Fingerprint");
+}
+
+inline void run_order_statistics_test() {
+    std::cout << "\n--- Running Order Statistics Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_order_statistics");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    std::vector<std::string> sorted_keys;
+    for (size_t i = 0; i < 3000; ++i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%s:%06zu", (i % 3 == 0) ? "edge" : "node", i * 7);
+        sorted_keys.push_back(buf);
+    }
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+
+    std::map<std::string, bool> expected;
+    auto check = [&](Collection &col, const char *label) {
+        const StaxTree &tree = col.get_critbit_tree();
+        std::vector<std::string> live_keys;
+        for (const auto &pair : expected) {
+            if (pair.second) live_keys.push_back(pair.first);
+        }
+        for (const char *prefix : {"", "edge", "node:", "node:00", "edge:0123", "missing"}) {
+            uint64_t want = std::count_if(live_keys.begin(), live_keys.end(), [&](const std::string &k) { return k.starts_with(prefix); });
+            if (tree.count_prefix(prefix) != want) {
+                std::cerr << "FAIL: " << label << " count_prefix('" << prefix << "') = " << tree.count_prefix(prefix) << ", expected " << want << "." << std::endl;
+                test_passed = false;
+            }
+        }
+        for (const char *probe : {"", "a", "edge:", "edge:000700", "edge:0007001", "node:010000", "node:9", "zzz"}) {
+            uint64_t want = std::lower_bound(live_keys.begin(), live_keys.end(), std::string(probe)) - live_keys.begin();
+            if (tree.rank(probe) != want) {
+                std::cerr << "FAIL: " << label << " rank('" << probe << "') = " << tree.rank(probe) << ", expected " << want << "." << std::endl;
+                test_passed = false;
+            }
+        }
+        uint64_t want_range = std::lower_bound(live_keys.begin(), live_keys.end(), std::string("node:005000")) -
+                              std::lower_bound(live_keys.begin(), live_keys.end(), std::string("edge:001000"));
+        if (tree.count_range("edge:001000", "node:005000") != want_range) {
+            std::cerr << "FAIL: " << label << " count_range mismatch." << std::endl;
+            test_passed = false;
+        }
+        for (size_t i = 0; i < live_keys.size() && test_passed; i += 97) {
+            auto record = tree.select(i);
+            if (!record || std::string_view(record->key_ptr, record->key_len) != live_keys[i]) {
+                std::cerr << "FAIL: " << label << " select(" << i << ") did not return '" << live_keys[i] << "'." << std::endl;
+                test_passed = false;
+            }
+        }
+        if (tree.select(live_keys.size()).has_value()) {
+            std::cerr << "FAIL: " << label << " select past the end returned a record." << std::endl;
+            test_passed = false;
+        }
+    };
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection &bulk_col = db->get_collection_by_idx(db->get_collection("bulk_counted"));
+        Collection &online_col = db->get_collection_by_idx(db->get_collection("online_counted"));
+        Collection &plain_col = db->get_collection_by_idx(db->get_collection("plain"));
+        bulk_col.enable_order_statistics();
+
+        std::vector<CoreKVPair> pairs;
+        for (const auto &key : sorted_keys) {
+            pairs.push_back({key, "v"});
+            expected[key] = true;
+        }
+        TxnContext load_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch load_batch;
+        bulk_col.insert_batch(load_ctx, load_batch, pairs.data(), pairs.size());
+        bulk_col.commit(load_ctx, load_batch);
+
+        TxnContext online_ctx = online_col.begin_transaction_context(0, false);
+        TransactionBatch online_batch;
+        for (size_t i = 0; i < sorted_keys.size(); i += 2) {
+            online_col.insert(online_ctx, online_batch, sorted_keys[(i * 1237) % sorted_keys.size()], "v");
+        }
+        online_col.commit(online_ctx, online_batch);
+        online_col.enable_order_statistics();
+
+        TxnContext more_ctx = online_col.begin_transaction_context(0, false);
+        TransactionBatch more_batch;
+        for (size_t i = 0; i < sorted_keys.size(); ++i) {
+            online_col.insert(more_ctx, more_batch, sorted_keys[(i * 1237) % sorted_keys.size()], "v2");
+        }
+        online_col.commit(more_ctx, more_batch);
+
+        TxnContext update_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch bulk_updates;
+        TransactionBatch online_updates;
+        for (size_t i = 0; i < sorted_keys.size(); i += 5) {
+            bulk_col.remove(update_ctx, bulk_updates, sorted_keys[i]);
+            online_col.remove(update_ctx, online_updates, sorted_keys[i]);
+            expected[sorted_keys[i]] = false;
+        }
+        for (size_t i = 0; i < sorted_keys.size(); i += 10) {
+            bulk_col.insert(update_ctx, bulk_updates, sorted_keys[i], "again");
+            online_col.insert(update_ctx, online_updates, sorted_keys[i], "again");
+            bulk_col.insert(update_ctx, bulk_updates, sorted_keys[i] + "+", "new");
+            online_col.insert(update_ctx, online_updates, sorted_keys[i] + "+", "new");
+            bulk_col.remove(update_ctx, bulk_updates, sorted_keys[i] + "-gone");
+            online_col.remove(update_ctx, online_updates, sorted_keys[i] + "-gone");
+            expected[sorted_keys[i]] = true;
+            expected[sorted_keys[i] + "+"] = true;
+            expected[sorted_keys[i] + "-gone"] = false;
+        }
+        bulk_col.commit(update_ctx, bulk_updates);
+        online_col.commit(update_ctx, online_updates);
+
+        check(bulk_col, "bulk");
+        check(online_col, "online");
+
+        try {
+            plain_col.get_critbit_tree().count_prefix("");
+            std::cerr << "FAIL: Counting a collection without order statistics did not throw." << std::endl;
+            test_passed = false;
+        } catch (const std::runtime_error &) {
+        }
+    }
+
+    {
+        auto db = Database::open_existing(db_dir, 1);
+        Collection &bulk_col = db->get_collection_by_idx(db->get_collection("bulk_counted"));
+        if (!bulk_col.get_critbit_tree().has_order_statistics()) {
+            std::cerr << "FAIL: Order statistics mode was not restored on reopen." << std::endl;
+            test_passed = false;
+        } else {
+            check(bulk_col, "reopened");
+        }
+    }
+
+    finish_test(test_passed, "Order Statistics");
+}
+
+inline void run_seek_lower_bound_test() {
+    std::cout << "\n--- Running Seek Lower Bound Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_seek_lower_bound");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    auto binary_key = [](uint32_t v) {
+        std::string key(4, '\0');
+        for (int b = 0; b < 4; ++b) key[b] = static_cast<char>((v >> (24 - 8 * b)) & 0xFF);
+        return key;
+    };
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& bulk_col = db->get_collection_by_idx(db->get_collection("seek_bulk"));
+        Collection& online_col = db->get_collection_by_idx(db->get_collection("seek_online"));
+
+        std::map<std::string, std::string> expected;
+        for (uint32_t i = 0; i < 20000; ++i) {
+            expected[binary_key(i * 2654435761u)] = "b";
+            expected["rel:" + std::to_string(i * 13)] = "r";
+        }
+        std::vector<CoreKVPair> pairs;
+        for (const auto& pair : expected) {
+            pairs.push_back({pair.first, pair.second});
+        }
+        TxnContext load_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch bulk_batch;
+        bulk_col.insert_batch(load_ctx, bulk_batch, pairs.data(), pairs.size());
+        bulk_col.commit(load_ctx, bulk_batch);
+        TransactionBatch online_batch;
+        for (const auto& pair : expected) {
+            online_col.insert(load_ctx, online_batch, pair.first, pair.second);
+        }
+        online_col.commit(load_ctx, online_batch);
+
+        TxnContext write_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch bulk_removals;
+        TransactionBatch online_removals;
+        for (uint32_t i = 0; i < 20000; i += 3) {
+            bulk_col.remove(write_ctx, bulk_removals, "rel:" + std::to_string(i * 13));
+            online_col.remove(write_ctx, online_removals, "rel:" + std::to_string(i * 13));
+            expected.erase("rel:" + std::to_string(i * 13));
+        }
+        bulk_col.commit(write_ctx, bulk_removals);
+        online_col.commit(write_ctx, online_removals);
+
+        std::vector<std::string> probes = {"", "a", "rel:", "rel:1", "rel:99", "rel:;", "rel:259987", "zzz", std::string(1, '\xff')};
+        for (uint32_t i = 0; i < 3000; ++i) {
+            probes.push_back(binary_key(i * 40503u + 17));
+            probes.push_back(binary_key(i * 2654435761u).substr(0, 1 + i % 4) + std::string(i % 3, static_cast<char>(i)));
+            probes.push_back("rel:" + std::to_string(i * 7));
+        }
+
+        TxnContext read_ctx = bulk_col.begin_transaction_context(0, true);
+        for (Collection* col : {&bulk_col, &online_col}) {
+            for (const auto& probe : probes) {
+                auto want = expected.lower_bound(probe);
+                auto cursor = col->seek(read_ctx, probe);
+                bool ok = (want == expected.end()) ? !cursor->is_valid() : (cursor->is_valid() && cursor->key() == want->first);
+                if (ok && want != expected.end()) {
+                    cursor->next();
+                    auto after = std::next(want);
+                    ok = (after == expected.end()) ? !cursor->is_valid() : (cursor->is_valid() && cursor->key() == after->first);
+                }
+                if (!ok) {
+                    std::cerr << "FAIL: Seek did not land on the lower bound of a probe of length " << probe.size() << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    finish_test(test_passed, "Seek Lower Bound");
+}
+
+inline void run_reverse_iteration_test() {
+    std::cout << "\n--- Running Reverse Iteration Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_reverse_iteration");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    auto binary_key = [](uint32_t v) {
+        std::string key(4, '\0');
+        for (int b = 0; b < 4; ++b) key[b] = static_cast<char>((v >> (24 - 8 * b)) & 0xFF);
+        return key;
+    };
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& bulk_col = db->get_collection_by_idx(db->get_collection("reverse_bulk"));
+        Collection& online_col = db->get_collection_by_idx(db->get_collection("reverse_online"));
+
+        std::map<std::string, std::string> expected;
+        for (uint32_t i = 0; i < 20000; ++i) {
+            expected[binary_key(i * 2654435761u)] = "b";
+            expected["ts:" + std::to_string(1000000 + i * 11)] = "t";
+        }
+        std::vector<CoreKVPair> pairs;
+        for (const auto& pair : expected) {
+            pairs.push_back({pair.first, pair.second});
+        }
+        TxnContext load_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch bulk_batch;
+        bulk_col.insert_batch(load_ctx, bulk_batch, pairs.data(), pairs.size());
+        bulk_col.commit(load_ctx, bulk_batch);
+        TransactionBatch online_batch;
+        for (const auto& pair : expected) {
+            online_col.insert(load_ctx, online_batch, pair.first, pair.second);
+        }
+        online_col.commit(load_ctx, online_batch);
+
+        TxnContext write_ctx = bulk_col.begin_transaction_context(0, false);
+        TransactionBatch bulk_removals;
+        TransactionBatch online_removals;
+        for (uint32_t i = 0; i < 20000; i += 4) {
+            bulk_col.remove(write_ctx, bulk_removals, binary_key(i * 2654435761u));
+            online_col.remove(write_ctx, online_removals, binary_key(i * 2654435761u));
+            expected.erase(binary_key(i * 2654435761u));
+        }
+        bulk_col.commit(write_ctx, bulk_removals);
+        online_col.commit(write_ctx, online_removals);
+
+        TxnContext read_ctx = bulk_col.begin_transaction_context(0, true);
+        for (Collection* col : {&bulk_col, &online_col}) {
+            auto it = expected.rbegin();
+            size_t visited = 0;
+            for (auto cursor = col->seek_last(read_ctx); cursor->is_valid(); cursor->prev(), ++visited) {
+                if (it == expected.rend() || cursor->key() != it->first) {
+                    std::cerr << "FAIL: Reverse scan diverged at position " << visited << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+                ++it;
+            }
+            if (test_passed && visited != expected.size()) {
+                std::cerr << "FAIL: Reverse scan visited " << visited << " keys, expected " << expected.size() << "." << std::endl;
+                test_passed = false;
+            }
+
+            for (uint32_t i = 0; i < 3000 && test_passed; ++i) {
+                std::string probe = (i % 2) ? binary_key(i * 40503u + 17) : "ts:" + std::to_string(1000000 + i * 7);
+                auto want = expected.upper_bound(probe);
+                auto cursor = col->seek_for_prev(read_ctx, probe);
+                if (want == expected.begin()) {
+                    if (cursor->is_valid()) {
+                        std::cerr << "FAIL: seek_for_prev found a key before the first one." << std::endl;
+                        test_passed = false;
+                    }
+                    continue;
+                }
+                --want;
+                if (!cursor->is_valid() || cursor->key() != want->first) {
+                    std::cerr << "FAIL: seek_for_prev did not land on the last key <= probe " << i << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+                cursor->next();
+                auto after = std::next(want);
+                bool forward_ok = (after == expected.end()) ? !cursor->is_valid() : (cursor->is_valid() && cursor->key() == after->first);
+                cursor->prev();
+                cursor->prev();
+                bool backward_ok = (want == expected.begin()) ? !cursor->is_valid() : (cursor->is_valid() && cursor->key() == std::prev(want)->first);
+                if (!forward_ok || !backward_ok) {
+                    std::cerr << "FAIL: Switching direction after seek_for_prev lost position at probe " << i << "." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+            }
+
+            size_t latest = 0;
+            for (auto cursor = col->seek_for_prev(read_ctx, "ts:\xff", std::string_view("ts:")); cursor->is_valid(); cursor->prev()) {
+                if (!cursor->key().starts_with("ts:")) {
+                    std::cerr << "FAIL: Reverse scan crossed its start key." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+                ++latest;
+            }
+            if (test_passed && latest != 20000) {
+                std::cerr << "FAIL: Bounded reverse scan visited " << latest << " keys, expected 20000." << std::endl;
+                test_passed = false;
+            }
+        }
+    }
+
+    finish_test(test_passed, "Reverse Iteration");
+}
+
+inline void run_parallel_scan_test() {
+    std::cout << "\n--- Running Parallel Range Scan Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_parallel_scan");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& plain_col = db->get_collection_by_idx(db->get_collection("parallel_plain"));
+        Collection& counted_col = db->get_collection_by_idx(db->get_collection("parallel_counted"));
+        counted_col.enable_order_statistics();
+
+        std::vector<std::string> keys;
+        for (uint32_t i = 0; i < 120000; ++i) {
+            keys.push_back("k:" + std::to_string(i * 2654435761u));
+        }
+        TxnContext write_ctx = plain_col.begin_transaction_context(0, false);
+        TransactionBatch plain_batch;
+        TransactionBatch counted_batch;
+        for (const auto& key : keys) {
+            plain_col.insert(write_ctx, plain_batch, key, "v");
+            counted_col.insert(write_ctx, counted_batch, key, "v");
+        }
+        plain_col.commit(write_ctx, plain_batch);
+        counted_col.commit(write_ctx, counted_batch);
+        std::sort(keys.begin(), keys.end());
+
+        TxnContext read_ctx = plain_col.begin_transaction_context(0, true);
+        struct Range { std::string start; std::optional<std::string> end; };
+        for (const Range& range : {Range{"", std::nullopt}, Range{"k:2", std::string("k:7")}, Range{"k:31", std::string("k:32")}}) {
+            auto first = std::lower_bound(keys.begin(), keys.end(), range.start);
+            auto last = range.end ? std::lower_bound(keys.begin(), keys.end(), *range.end) : keys.end();
+            std::vector<std::string> want(first, last);
+
+            for (Collection* col : {&plain_col, &counted_col}) {
+                std::vector<std::vector<std::string>> seen(8);
+                std::optional<std::string_view> end_view;
+                if (range.end) end_view = *range.end;
+                col->parallel_scan(read_ctx, range.start, end_view, 8, [&](size_t partition_index, DBCursor& cursor) {
+                    for (; cursor.is_valid(); cursor.next()) {
+                        seen[partition_index].emplace_back(cursor.key());
+                    }
+                });
+                std::vector<std::string> merged;
+                size_t non_empty = 0;
+                for (const auto& partition : seen) {
+                    non_empty += partition.empty() ? 0 : 1;
+                    merged.insert(merged.end(), partition.begin(), partition.end());
+                }
+                if (merged != want) {
+                    std::cerr << "FAIL: Parallel scan of [" << range.start << ", " << range.end.value_or("end") << ") returned " << merged.size() << " keys out of order or incomplete, expected " << want.size() << "." << std::endl;
+                    test_passed = false;
+                }
+                if (range.start.empty() && non_empty < 4) {
+                    std::cerr << "FAIL: Full parallel scan used only " << non_empty << " partitions." << std::endl;
+                    test_passed = false;
+                }
+                if (range.start.empty() && seen.front().empty()) {
+                    std::cerr << "FAIL: Full parallel scan left its first partition empty." << std::endl;
+                    test_passed = false;
+                }
+            }
+        }
+
+        bool rethrown = false;
+        try {
+            plain_col.parallel_scan(read_ctx, "", std::nullopt, 4, [&](size_t partition_index, DBCursor&) {
+                if (partition_index == 1) throw std::runtime_error("visitor failure");
+            });
+        } catch (const std::runtime_error&) {
+            rethrown = true;
+        }
+        if (!rethrown) {
+            std::cerr << "FAIL: Visitor exception was not rethrown by parallel_scan." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Parallel Range Scan");
+}
+
+inline void run_fixed_width_key_test() {
+    std::cout << "\n--- Running Fixed-Width Key Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_fixed_width");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("fixed_width"));
+
+        // Widths around the specialised 9/12/13/16-byte paths. The leading width byte
+        // keeps zero-padded keys of different lengths distinct; the shared middle
+        // bytes push critical bits into both 64-bit words.
+        const std::vector<size_t> widths = {8, 9, 12, 13, 16, 17};
+        auto make_key = [](size_t width, uint32_t i) {
+            std::string key(width, '\0');
+            key[0] = static_cast<char>(width);
+            key[1] = static_cast<char>(i & 0x3);
+            for (size_t b = 0; b < 4 && b + 1 < width; ++b) {
+                key[width - 1 - b] = static_cast<char>((i >> (8 * b)) & 0xFF);
+            }
+            return key;
+        };
+
+        std::map<std::string, std::string> expected;
+        TxnContext insert_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch insert_batch;
+        for (uint32_t i = 0; i < 3000; ++i) {
+            for (size_t width : widths) {
+                std::string key = make_key(width, i * 2654435761u);
+                std::string value = "v" + std::to_string(width) + ":" + std::to_string(i);
+                col.insert(insert_ctx, insert_batch, key, value);
+                expected[key] = value;
+            }
+        }
+        col.commit(insert_ctx, insert_batch);
+
+        TxnContext update_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch update_batch;
+        for (uint32_t i = 0; i < 3000; i += 3) {
+            for (size_t width : widths) {
+                std::string key = make_key(width, i * 2654435761u);
+                col.remove(update_ctx, update_batch, key);
+                expected.erase(key);
+            }
+        }
+        col.commit(update_ctx, update_batch);
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        for (uint32_t i = 0; i < 3000 && test_passed; ++i) {
+            for (size_t width : widths) {
+                std::string key = make_key(width, i * 2654435761u);
+                auto res = col.get(read_ctx, key);
+                auto it = expected.find(key);
+                bool ok = (it == expected.end()) ? !res.has_value() : (res && res->value_view() == it->second);
+                if (!ok) {
+                    std::cerr << "FAIL: Wrong get result for " << width << "-byte key index " << i << "." << std::endl;
+                    test_passed = false;
+                }
+            }
+            if (col.get(read_ctx, make_key(12, i * 2654435761u + 1)) && !expected.count(make_key(12, i * 2654435761u + 1))) {
+                std::cerr << "FAIL: Absent 12-byte key index " << i << " was found." << std::endl;
+                test_passed = false;
+            }
+        }
+
+        auto expected_it = expected.begin();
+        for (auto cursor = col.seek_first(read_ctx); cursor->is_valid() && test_passed; cursor->next(), ++expected_it) {
+            if (expected_it == expected.end() || cursor->key() != expected_it->first) {
+                std::cerr << "FAIL: Scan order diverged from expected key order." << std::endl;
+                test_passed = false;
+            }
+        }
+        if (test_passed && expected_it != expected.end()) {
+            std::cerr << "FAIL: Scan ended before all expected keys were visited." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Fixed-Width Key");
+}
+
+inline void run_epoch_reclamation_test() {
+    std::cout << "\n--- Running Epoch Reclamation Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_epoch_reclamation");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 2);
+        Collection& col = db->get_collection_by_idx(db->get_collection("epochs"));
+        auto value_for = [](size_t i) {
+            std::string value = "value:" + std::to_string(i);
+            value.resize(32, '.');
+            return value;
+        };
+
+        TxnContext seed_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch seed_batch;
+        col.insert(seed_ctx, seed_batch, "hot", value_for(0));
+        col.commit(seed_ctx, seed_batch);
+        TxnContext old_snapshot = col.begin_transaction_context(1, true);
+
+        TxnContext write_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch write_batch;
+        col.insert(write_ctx, write_batch, "hot", value_for(1));
+
+        // A pinned reader must keep a superseded version intact, even though
+        // the writer unlinks it from the chain straight away.
+        {
+            EpochGuard pin = col.get_critbit_tree().pin_epoch(1);
+            auto pinned = col.get(write_ctx, "hot");
+            for (size_t i = 2; i < 3000; ++i) {
+                col.insert(write_ctx, write_batch, "hot", value_for(i));
+            }
+            if (!pinned || pinned->value_view() != value_for(1)) {
+                std::cerr << "FAIL: A version pinned by a reader was recycled." << std::endl;
+                test_passed = false;
+            }
+        }
+
+        std::atomic<bool> stop_reader = false;
+        std::atomic<bool> reader_ok = true;
+        std::thread reader([&]() {
+            while (!stop_reader.load()) {
+                auto res = col.get(old_snapshot, "hot");
+                if (!res || res->value_view() != value_for(0)) {
+                    reader_ok = false;
+                }
+            }
+        });
+
+        FileHeader* header = db->get_active_generation()->file_header;
+        const uint64_t alloc_before = header->global_alloc_offset.load();
+        const size_t num_updates = 50000;
+        for (size_t i = 0; i < num_updates; ++i) {
+            col.insert(write_ctx, write_batch, "hot", value_for(3000 + i));
+        }
+        const uint64_t alloc_growth = header->global_alloc_offset.load() - alloc_before;
+        stop_reader = true;
+        reader.join();
+
+        if (!reader_ok) {
+            std::cerr << "FAIL: Old snapshot lost its version while the key was rewritten." << std::endl;
+            test_passed = false;
+        }
+        const uint64_t unreclaimed_size = num_updates * CollectionRecordAllocator::get_allocated_record_size(3, 32);
+        if (alloc_growth >= 2 * RECORD_ALLOCATOR_CHUNK_SIZE || alloc_growth >= unreclaimed_size / 2) {
+            std::cerr << "FAIL: Rewriting one key grew the arena by " << alloc_growth << " bytes." << std::endl;
+            test_passed = false;
+        }
+
+        auto own_view = col.get(write_ctx, "hot");
+        if (!own_view || own_view->value_view() != value_for(3000 + num_updates - 1)) {
+            std::cerr << "FAIL: Writer does not see its latest version." << std::endl;
+            test_passed = false;
+        }
+        col.commit(write_ctx, write_batch);
+
+        TxnContext new_snapshot = col.begin_transaction_context(1, true);
+        auto latest = col.get(new_snapshot, "hot");
+        auto old = col.get(old_snapshot, "hot");
+        if (!latest || latest->value_view() != value_for(3000 + num_updates - 1) || !old || old->value_view() != value_for(0)) {
+            std::cerr << "FAIL: Wrong versions visible after commit." << std::endl;
+            test_passed = false;
+        }
+        size_t visible_keys = 0;
+        for (auto cursor = col.seek_first(new_snapshot); cursor->is_valid(); cursor->next()) {
+            ++visible_keys;
+        }
+        if (visible_keys != 1) {
+            std::cerr << "FAIL: Scan saw " << visible_keys << " keys instead of 1." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Epoch Reclamation");
+}
+
+inline void run_sorted_batch_insert_test() {
+    std::cout << "\n--- Running Sorted Batch Insert Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_sorted_batch");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        const size_t num_threads = 4;
+        auto db = Database::create_new(db_dir, num_threads);
+        Collection& col = db->get_collection_by_idx(db->get_collection("sorted_batch"));
+        col.enable_order_statistics();
+
+        // A seed key keeps the tree non-empty so batches take the incremental path.
+        TxnContext seed_ctx = col.begin_transaction_context(0, false);
+        TransactionBatch seed_batch;
+        col.insert(seed_ctx, seed_batch, "seed", "0");
+        col.commit(seed_ctx, seed_batch);
+
+        std::map<std::string, std::string> expected;
+        expected["seed"] = "0";
+        std::mutex expected_mutex;
+
+        // Each thread writes an interleaved, shuffled slice with repeated keys,
+        // so batches race on shared subtrees and resumed paths go stale.
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                std::vector<std::string> keys;
+                std::vector<std::string> values;
+                for (size_t i = t; i < 20000; i += num_threads) {
+                    char key[32];
+                    snprintf(key, sizeof(key), "batch:%05zu:%zu", (i * 7919) % 20000, i % 3);
+                    keys.emplace_back(key);
+                    values.emplace_back("v" + std::to_string(i));
+                }
+                keys.push_back(keys.front());
+                values.push_back("repeated");
+
+                std::vector<CoreKVPair> pairs(keys.size());
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    pairs[i] = {keys[i], values[i]};
+                }
+                TxnContext ctx = col.begin_transaction_context(t, false);
+                TransactionBatch batch;
+                col.insert_batch(ctx, batch, pairs.data(), pairs.size());
+                col.commit(ctx, batch);
+
+                std::lock_guard<std::mutex> lock(expected_mutex);
+                for (size_t i = 0; i < keys.size(); ++i) {
+                    expected[keys[i]] = values[i];
+                }
+            });
+        }
+        for (auto& writer : writers) writer.join();
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        auto expected_it = expected.begin();
+        for (auto cursor = col.seek_first(read_ctx); cursor->is_valid() && test_passed; cursor->next(), ++expected_it) {
+            if (expected_it == expected.end() || cursor->key() != expected_it->first || static_cast<std::string_view>(cursor->value()) != expected_it->second) {
+                std::cerr << "FAIL: Batch-inserted contents diverge at key '" << std::string(cursor->key()) << "'." << std::endl;
+                test_passed = false;
+            }
+        }
+        if (test_passed && expected_it != expected.end()) {
+            std::cerr << "FAIL: Scan ended before all batch-inserted keys were visited." << std::endl;
+            test_passed = false;
+        }
+        if (col.get_critbit_tree().count_prefix("") != expected.size()) {
+            std::cerr << "FAIL: Order-statistic count " << col.get_critbit_tree().count_prefix("")
+                      << " does not match " << expected.size() << " keys." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Sorted Batch Insert");
+}
+
+inline void run_append_hint_test() {
+    std::cout << "\n--- Running Append Hint Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_append_hint");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        const size_t num_threads = 4;
+        const size_t appends_per_thread = 20000;
+        auto db = Database::create_new(db_dir, num_threads);
+        Collection& plain_col = db->get_collection_by_idx(db->get_collection("append_plain"));
+        Collection& counted_col = db->get_collection_by_idx(db->get_collection("append_counted"));
+        counted_col.enable_order_statistics();
+
+        // Threads append to a shared ascending sequence and to their own
+        // ascending ranges, so hints keep going stale under other appenders.
+        // Every 64th write overwrites an older key and breaks the pattern.
+        std::atomic<size_t> sequence = 0;
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                for (Collection* col : {&plain_col, &counted_col}) {
+                    TxnContext ctx = col->begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    char key[32];
+                    for (size_t i = 0; i < appends_per_thread; ++i) {
+                        snprintf(key, sizeof(key), "seq:%010zu", sequence.fetch_add(1));
+                        col->insert(ctx, batch, key, "s");
+                        snprintf(key, sizeof(key), "own:%zu:%08zu", t, i);
+                        col->insert(ctx, batch, key, "o");
+                        if (i % 64 == 63) {
+                            snprintf(key, sizeof(key), "own:%zu:%08zu", t, i / 2);
+                            col->insert(ctx, batch, key, "r");
+                        }
+                    }
+                    col->commit(ctx, batch);
+                }
+            });
+        }
+        for (auto& writer : writers) writer.join();
+
+        const size_t expected_keys = num_threads * appends_per_thread * 2;
+        for (Collection* col : {&plain_col, &counted_col}) {
+            TxnContext read_ctx = col->begin_transaction_context(0, true);
+            size_t seen = 0;
+            std::string previous_key;
+            for (auto cursor = col->seek_first(read_ctx); cursor->is_valid(); cursor->next()) {
+                std::string current_key(cursor->key());
+                if (seen > 0 && current_key <= previous_key) {
+                    std::cerr << "FAIL: Scan out of order at '" << current_key << "'." << std::endl;
+                    test_passed = false;
+                    break;
+                }
+                previous_key = std::move(current_key);
+                ++seen;
+            }
+            if (seen != expected_keys) {
+                std::cerr << "FAIL: Scan saw " << seen << " keys, expected " << expected_keys << "." << std::endl;
+                test_passed = false;
+            }
+            for (size_t t = 0; t < num_threads; ++t) {
+                char key[32];
+                snprintf(key, sizeof(key), "own:%zu:%08zu", t, appends_per_thread - 1);
+                auto last = col->get(read_ctx, key);
+                snprintf(key, sizeof(key), "own:%zu:%08zu", t, size_t(31));
+                auto rewritten = col->get(read_ctx, key);
+                if (!last || last->value_view() != "o" || !rewritten || rewritten->value_view() != "r") {
+                    std::cerr << "FAIL: Wrong value for appended keys of thread " << t << "." << std::endl;
+                    test_passed = false;
+                }
+            }
+        }
+        if (counted_col.get_critbit_tree().count_prefix("seq:") != num_threads * appends_per_thread ||
+            counted_col.get_critbit_tree().count_prefix("") != expected_keys) {
+            std::cerr << "FAIL: Order-statistic counts drifted under hinted appends." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Append Hint");
+}
+
+inline void run_hash_index_test() {
+    std::cout << "\n--- Running Hash Index Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_hash_index");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    const size_t num_threads = 4;
+    const size_t keys_per_thread = 10000;
+    auto key_for = [](size_t t, size_t i) {
+        char key[32];
+        snprintf(key, sizeof(key), "k:%zu:%07zu", t, i);
+        return std::string(key);
+    };
+    auto value_for = [](size_t t, size_t i, size_t round) {
+        return "v" + std::to_string(t) + ":" + std::to_string(i) + ":" + std::to_string(round);
+    };
+    auto check_all = [&](Collection& col, size_t round, const char* stage) {
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        for (size_t t = 0; t < num_threads; ++t) {
+            for (size_t i = 0; i < keys_per_thread; ++i) {
+                auto record = col.get(read_ctx, key_for(t, i));
+                const bool removed = round > 0 && i % 10 == 0;
+                if (removed ? (record && !record->is_deleted) : (!record || record->is_deleted || record->value_view() != value_for(t, i, round))) {
+                    std::cerr << "FAIL: Wrong result for '" << key_for(t, i) << "' " << stage << "." << std::endl;
+                    test_passed = false;
+                    return;
+                }
+            }
+            if (col.get(read_ctx, key_for(t, keys_per_thread + 1)) || col.get(read_ctx, "k:" + std::to_string(t))) {
+                std::cerr << "FAIL: Absent key found " << stage << "." << std::endl;
+                test_passed = false;
+                return;
+            }
+        }
+    };
+
+    uint32_t col_idx;
+    {
+        auto db = Database::create_new(db_dir, num_threads);
+        col_idx = db->get_collection("hash_index");
+        Collection& col = db->get_collection_by_idx(col_idx);
+
+        // Half the keys are indexed when the index is built; the rest are
+        // indexed as they are inserted and split their way into the tree.
+        auto write_round = [&](size_t first, size_t last, size_t round) {
+            std::vector<std::thread> writers;
+            for (size_t t = 0; t < num_threads; ++t) {
+                writers.emplace_back([&, t]() {
+                    TxnContext ctx = col.begin_transaction_context(t, false);
+                    TransactionBatch batch;
+                    for (size_t i = first; i < last; ++i) {
+                        if (round > 0 && i % 10 == 0) {
+                            col.remove(ctx, batch, key_for(t, i));
+                        } else {
+                            col.insert(ctx, batch, key_for(t, i), value_for(t, i, round));
+                        }
+                    }
+                    col.commit(ctx, batch);
+                });
+            }
+            for (auto& writer : writers) writer.join();
+        };
+
+        write_round(0, keys_per_thread / 2, 0);
+        col.enable_hash_index();
+        if (!col.get_critbit_tree().has_hash_index()) {
+            std::cerr << "FAIL: Hash index not attached after enable_hash_index." << std::endl;
+            test_passed = false;
+        }
+        write_round(keys_per_thread / 2, keys_per_thread, 0);
+        check_all(col, 0, "after inserts");
+        write_round(0, keys_per_thread, 1);
+        check_all(col, 1, "after updates and removes");
+    }
+
+    {
+        auto db = Database::open_existing(db_dir, num_threads);
+        Collection& col = db->get_collection_by_idx(col_idx);
+        if (!col.get_critbit_tree().has_hash_index()) {
+            std::cerr << "FAIL: Hash index not restored on reopen." << std::endl;
+            test_passed = false;
+        }
+        check_all(col, 1, "after reopen");
+    }
+
+    Database::compact(db_dir, num_threads, false);
+    {
+        auto db = Database::open_existing(db_dir, num_threads);
+        Collection& col = db->get_collection_by_idx(col_idx);
+        if (!col.get_critbit_tree().has_hash_index()) {
+            std::cerr << "FAIL: Hash index not carried over by compaction." << std::endl;
+            test_passed = false;
+        }
+        check_all(col, 1, "after compaction");
+    }
+
+    finish_test(test_passed, "Hash Index");
+}
+
+inline void run_jump_table_test() {
+    std::cout << "\n--- Running Jump Table Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_jump_table");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        const size_t num_threads = 4;
+        auto db = Database::create_new(db_dir, num_threads + 1);
+        Collection& col = db->get_collection_by_idx(db->get_collection("jump_table"));
+        StaxTree& tree = col.get_critbit_tree();
+
+        // The first keys share a handful of leading bytes, so the table fills
+        // with entries deep in their subtrees. Later keys spread over every
+        // leading byte (and include one-byte keys), splitting the top levels
+        // the filled entries skip. Keys avoid zero bytes, since keys that
+        // differ only in trailing zero bytes are not told apart.
+        std::mt19937_64 rng(1234);
+        auto random_key = [&](bool narrow_prefix) {
+            std::string key(1 + rng() % 12, '\0');
+            for (char& c : key) c = static_cast<char>(1 + rng() % 255);
+            if (narrow_prefix) key[0] = static_cast<char>('a' + rng() % 3);
+            return key;
+        };
+        std::vector<std::string> early_keys, late_keys;
+        for (size_t i = 0; i < 20000; ++i) early_keys.push_back(random_key(true));
+        for (size_t i = 0; i < 40000; ++i) late_keys.push_back(random_key(false));
+        for (int c = 1; c < 256; c += 17) late_keys.push_back(std::string(1, static_cast<char>(c)));
+
+        {
+            TxnContext ctx = col.begin_transaction_context(0, false);
+            TransactionBatch batch;
+            for (const auto& key : early_keys) col.insert(ctx, batch, key, "early");
+            col.commit(ctx, batch);
+        }
+
+        // Readers keep finding the early keys while writers split the levels
+        // their jump entries start below.
+        std::atomic<bool> writers_done = false;
+        std::atomic<size_t> missed_reads = 0;
+        std::thread reader([&]() {
+            TxnContext read_ctx = col.begin_transaction_context(num_threads, true);
+            size_t i = 0;
+            while (!writers_done.load()) {
+                const std::string& key = early_keys[i++ % early_keys.size()];
+                if (!col.get(read_ctx, key)) missed_reads.fetch_add(1);
+            }
+        });
+        std::vector<std::thread> writers;
+        for (size_t t = 0; t < num_threads; ++t) {
+            writers.emplace_back([&, t]() {
+                TxnContext ctx = col.begin_transaction_context(t, false);
+                TransactionBatch batch;
+                for (size_t i = t; i < late_keys.size(); i += num_threads) col.insert(ctx, batch, late_keys[i], "late");
+                col.commit(ctx, batch);
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        writers_done = true;
+        reader.join();
+        if (missed_reads.load() != 0) {
+            std::cerr << "FAIL: " << missed_reads.load() << " reads missed existing keys during top-level splits." << std::endl;
+            test_passed = false;
+        }
+
+        std::map<std::string, std::string> expected;
+        for (const auto& key : early_keys) expected[key] = "early";
+        for (const auto& key : late_keys) expected[key] = "late";
+
+        TxnContext read_ctx = col.begin_transaction_context(0, true);
+        std::vector<std::string_view> lookup_keys;
+        for (const auto& [key, value] : expected) {
+            auto record = col.get(read_ctx, key);
+            if (!record || record->value_view() != value) {
+                std::cerr << "FAIL: get lost a key after top-level splits." << std::endl;
+                test_passed = false;
+                break;
+            }
+            lookup_keys.push_back(key);
+        }
+        std::vector<std::string> absent_keys;
+        for (size_t i = 0; i < 2000; ++i) {
+            std::string key = random_key(i % 2 == 0);
+            if (!expected.count(key)) absent_keys.push_back(key);
+        }
+        for (const auto& key : absent_keys) lookup_keys.push_back(key);
+
+        std::vector<std::optional<RecordData>> results;
+        tree.multi_get_simd(read_ctx, lookup_keys, results);
+        for (size_t i = 0; i < lookup_keys.size(); ++i) {
+            auto it = expected.find(std::string(lookup_keys[i]));
+            if ((it != expected.end()) != results[i].has_value() || (results[i] && results[i]->value_view() != it->second)) {
+                std::cerr << "FAIL: multi_get disagrees for lookup " << i << "." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+
+        for (const auto& probe : absent_keys) {
+            auto want = expected.lower_bound(probe);
+            auto cursor = col.seek(read_ctx, probe);
+            if ((want == expected.end()) != !cursor->is_valid() || (cursor->is_valid() && cursor->key() != want->first)) {
+                std::cerr << "FAIL: seek did not land on the first key >= probe." << std::endl;
+                test_passed = false;
+                break;
+            }
+            auto prev_cursor = col.seek_for_prev(read_ctx, probe);
+            if ((want == expected.begin()) != !prev_cursor->is_valid() || (prev_cursor->is_valid() && prev_cursor->key() != std::prev(want)->first)) {
+                std::cerr << "FAIL: seek_for_prev did not land on the last key <= probe." << std::endl;
+                test_passed = false;
+                break;
+            }
+        }
+    }
+
+    finish_test(test_passed, "Jump Table");
+}
+
+inline void run_version_pruning_test() {
+    std::cout << "\n--- Running Version Pruning Test ---" << std::endl;
+    bool test_passed = true;
+    TestDbDir test_dir("./db_data_version_pruning");
+    const std::filesystem::path& db_dir = test_dir.path();
+
+    {
+        auto db = Database::create_new(db_dir, 3);
+        Collection& col = db->get_collection_by_idx(db->get_collection("pruning"));
+        auto value_for = [](size_t i) {
+            std::string value = "value:" + std::to_string(i);
+            value.resize(32, '.');
+            return value;
+        };
+        auto write_one = [&](std::string_view key, std::optional<std::string> value) {
+            TxnContext ctx = col.begin_transaction_context(0, false);
+            TransactionBatch batch;
+            if (value) {
+                col.insert(ctx, batch, key, *value);
+            } else {
+                col.remove(ctx, batch, key);
+            }
+            col.commit(ctx, batch);
+        };
+
+        write_one("hot", value_for(0));
+        write_one("gone", value_for(0));
+        write_one("gone", std::nullopt);
+        TxnContext old_snapshot = col.begin_transaction_context(1, true);
+
+        // Short-lived readers keep checking that whatever they read is a
+        // complete version while the writer prunes behind them.
+        std::atomic<bool> stop_reader = false;
+        std::atomic<bool> reader_ok = true;
+        std::thread reader([&]() {
+            while (!stop_reader.load()) {
+                TxnContext read_ctx = col.begin_transaction_context(2, true);
+                auto res = col.get(read_ctx, "hot");
+                if (!res || !res->value_view().starts_with("value:") || res->value_view().size() != 32) {
+                    reader_ok = false;
+                }
+                col.abort(read_ctx);
+            }
+        });
+
+        FileHeader* header = db->get_active_generation()->file_header;
+        const size_t num_updates = 20000;
+        for (size_t i = 1; i <= num_updates; ++i) {
+            write_one("hot", value_for(i));
+            if (i % 4000 == 0) {
+                auto pinned = col.get(old_snapshot, "hot");
+                if (!pinned || pinned->value_view() != value_for(0) || col.get(old_snapshot, "gone")) {
+                    std::cerr << "FAIL: An open snapshot lost the version it reads." << std::endl;
+                    test_passed = false;
+                }
+            }
+        }
+
+        // Once the old snapshot ends, the chain is cut down to the versions
+        // still readable and rewriting the key recycles its records.
+        col.abort(old_snapshot);
+        const uint64_t alloc_before = header->global_alloc_offset.load();
+        for (size_t i = num_updates + 1; i <= 3 * num_updates; ++i) {
+            write_one("hot", value_for(i));
+        }
+        const uint64_t alloc_growth = header->global_alloc_offset.load() - alloc_before;
+        stop_reader = true;
+        reader.join();
+
+        if (!reader_ok) {
+            std::cerr << "FAIL: A reader saw a torn or missing version during pruning." << std::endl;
+            test_passed = false;
+        }
+        const uint64_t unpruned_size = 2 * num_updates * CollectionRecordAllocator::get_allocated_record_size(3, 32);
+        if (alloc_growth >= unpruned_size / 2) {
+            std::cerr << "FAIL: Rewriting one key grew the arena by " << alloc_growth << " bytes." << std::endl;
+            test_passed = false;
+        }
+
+        // A snapshot taken while the key was deleted keeps reading the
+        // tombstone until it ends; after that the tombstone can be cut.
+        TxnContext deleted_snapshot = col.begin_transaction_context(1, true);
+        write_one("gone", value_for(1));
+        write_one("gone", value_for(2));
+        TxnContext read_ctx = col.begin_transaction_context(2, true);
+        auto revived = col.get(read_ctx, "gone");
+        if (col.get(deleted_snapshot, "gone") || !revived || revived->value_view() != value_for(2)) {
+            std::cerr << "FAIL: Wrong view of a deleted and rewritten key." << std::endl;
+            test_passed = false;
+        }
+        col.abort(deleted_snapshot);
+        write_one("gone", value_for(3));
+        write_one("gone", value_for(4));
+        auto latest = col.get(read_ctx, "gone");
+        if (!latest || latest->value_view() != value_for(2)) {
+            std::cerr << "FAIL: Pruning cut a version an open snapshot reads." << std::endl;
+            test_passed = false;
+        }
+        col.abort(read_ctx);
+    }
+
+    // Floors beyond a slot's entries spill over, and the watermark moves
+    // past them again once they are unregistered.
+    {
+        SnapshotRegistry registry;
+        std::vector<uint64_t> tickets;
+        for (TxnID floor = 10; floor < 10 + 3 * SNAPSHOT_REGISTRY_ENTRIES_PER_SLOT; ++floor) {
+            tickets.push_back(registry.register_floor(0, floor));
+        }
+        registry.refresh_watermark(1000, 1);
+        if (registry.get_watermark() != 10) {
+            std::cerr << "FAIL: Watermark " << registry.get_watermark() << " is not the lowest open floor." << std::endl;
+            test_passed = false;
+        }
+        for (size_t i = 0; i + 1 < tickets.size(); ++i) {
+            registry.unregister(0, tickets[i]);
+            registry.unregister(0, tickets[i]);
+        }
+        registry.refresh_watermark(1000, 1);
+        if (registry.get_watermark() != 10 + tickets.size() - 1) {
+            std::cerr << "FAIL: Watermark " << registry.get_watermark() << " did not move up to the last spilled floor." << std::endl;
+            test_passed = false;
+        }
+        registry.unregister(0, tickets.back());
+        registry.refresh_watermark(1000, 1);
+        if (registry.get_watermark() != 1000) {
+            std::cerr << "FAIL: Spilled floors kept the watermark at " << registry.get_watermark() << "." << std::endl;
+            test_passed = false;
+        }
+    }
+
+    finish_test(test_passed, "Version Pruning");
+}
+
+}
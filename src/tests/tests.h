@@ -35,6 +35,9 @@
 #include "tests/basic_correctness_tests.h"
 #include "tests/compaction_tests.h"
 #include "tests/init_test.h" 
+#include "tests/stax_tree_tests.h"
+#include "tests/durability_tests.h"
+#include "tests/concurrency_tests.h"
 
 
 namespace Tests { 
@@ -53,6 +56,31 @@ void run_all_tests() {
     run_basic_correctness_test();
     run_durability_test();
     run_concurrent_init_close_test(); 
+    run_multi_get_correctness_test();
+    run_bulk_load_correctness_test();
+    run_span_node_correctness_test();
+    run_leaf_fingerprint_test();
+    run_order_statistics_test();
+    run_seek_lower_bound_test();
+    run_reverse_iteration_test();
+    run_parallel_scan_test();
+    run_fixed_width_key_test();
+    run_epoch_reclamation_test();
+    run_sorted_batch_insert_test();
+    run_append_hint_test();
+    run_hash_index_test();
+    run_jump_table_test();
+    run_version_pruning_test();
+    run_dirty_range_sync_test();
+    run_group_commit_test();
+    run_write_ahead_log_test();
+    run_librarian_test();
+    run_commit_watermark_test();
+    run_thread_slot_leasing_test();
+    run_multi_collection_commit_test();
+    run_online_compaction_test();
+    run_parallel_compaction_test();
+    run_flatten_compaction_test();
    
     //run_hot_compaction_stress_test(); 
     //run_compaction_effectiveness_test(); 
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <thread>
+#include <mutex>
 #include <algorithm>
 #include <variant>
 #include <iostream>
@@ -58,7 +59,9 @@ DatabaseWrap::DatabaseWrap(const Napi::CallbackInfo& info) : Napi::ObjectWrap<Da
         return;
     }
     std::string path_str = info[0].As<Napi::String>();
-    const size_t num_threads = 4;
+    // Slots are leased per OS thread: the main thread, the libuv pool and
+    // the batch insert threads each take their own.
+    const size_t num_threads = 16;
     db_handle_ = staxdb_init_path(path_str.c_str(), num_threads, StaxDurability_NoSync);
     if (!db_handle_) {
         Napi::Error::New(env, std::string("Failed to open database: ") + staxdb_get_last_error()).ThrowAsJavaScriptException();
@@ -145,7 +148,7 @@ void DatabaseWrap::ExecuteBatch(const Napi::CallbackInfo& info) {
 
     try {
         Collection& col = db_instance_->get_collection_by_idx(col_idx);
-        TxnContext ctx = col.begin_transaction_context(0, false);
+        TxnContext ctx = col.begin_transaction_context(db_instance_->get_thread_slot(), false);
         TransactionBatch batch;
 
         for (uint32_t i = 0; i < num_ops; ++i) {
@@ -583,7 +586,7 @@ Napi::Object TransactionWrap::NewInstance(Napi::Env env, DatabaseWrap* db_wrap,
     TransactionWrap* txn_wrap = Unwrap(obj);
     txn_wrap->db_instance_ = db_wrap->db_instance_;
     txn_wrap->col_idx_ = col_idx;
-    txn_wrap->ctx_ = db_wrap->db_instance_->begin_transaction_context(0, is_read_only);
+    txn_wrap->ctx_ = db_wrap->db_instance_->begin_transaction_context(db_wrap->db_instance_->get_thread_slot(), is_read_only);
     return obj;
 }
 
@@ -638,25 +641,33 @@ protected:
         if (!cpp_db) { SetError("Failed to get DB instance in worker thread."); return; }
         size_t num_pairs = kv_data_.size();
         if (num_pairs == 0) return;
-        size_t num_threads = cpp_db->get_num_configured_threads();
+        // Each insert thread leases a slot of its own, so leave the rest
+        // for the JS thread and the other pool workers.
+        size_t num_threads = std::max<size_t>(1, std::min(cpp_db->get_num_configured_threads() / 4, num_pairs));
         std::vector<std::thread> threads;
+        std::mutex error_mutex;
+        std::string first_error;
         size_t items_per_thread = (num_pairs + num_threads - 1) / num_threads;
         for (size_t t = 0; t < num_threads; ++t) {
             threads.emplace_back([&, t]() {
-                Collection& col = cpp_db->get_collection_by_idx(col_);
-                TxnContext ctx = col.begin_transaction_context(t, false);
-                TransactionBatch batch;
-                size_t start = t * items_per_thread;
-                size_t end = std::min(start + items_per_thread, num_pairs);
-                for (size_t i = start; i < end; ++i) {
-                    col.insert(ctx, batch, kv_data_[i].first, kv_data_[i].second);
+                try {
+                    Collection& col = cpp_db->get_collection_by_idx(col_);
+                    TxnContext ctx = col.begin_transaction_context(cpp_db->get_thread_slot(), false);
+                    TransactionBatch batch;
+                    size_t start = t * items_per_thread;
+                    size_t end = std::min(start + items_per_thread, num_pairs);
+                    for (size_t i = start; i < end; ++i) {
+                        col.insert(ctx, batch, kv_data_[i].first, kv_data_[i].second);
+                    }
+                    col.commit(ctx, batch);
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (first_error.empty()) first_error = e.what();
                 }
-                col.commit(ctx, batch);
             });
         }
         for (auto& th : threads) th.join();
-        const char* err = staxdb_get_last_error();
-        if (err && strlen(err) > 0) SetError(err);
+        if (!first_error.empty()) SetError(first_error);
     }
     void OnOK() override {
         Napi::HandleScope scope(Env());
@@ -697,7 +708,7 @@ protected:
         if (!cpp_db) { SetError("Failed to get DB instance in worker thread."); return; }
         
         Collection& col = cpp_db->get_collection_by_idx(col_);
-        TxnContext ctx = col.begin_transaction_context(0, true);
+        TxnContext ctx = col.begin_transaction_context(cpp_db->get_thread_slot(), true);
 
         std::vector<std::string_view> key_views;
         key_views.reserve(keys_to_get_.size());
@@ -705,7 +716,18 @@ protected:
             key_views.push_back(k);
         }
 
-        col.get_critbit_tree().multi_get_simd(ctx, key_views, results_);
+        std::vector<std::optional<RecordData>> records;
+        col.get_critbit_tree().multi_get_simd(ctx, key_views, records);
+        // Copied out before the snapshot ends and its versions can be reclaimed.
+        results_.reserve(records.size());
+        for (const auto& record : records) {
+            if (record.has_value()) {
+                results_.emplace_back(std::in_place, record->value_ptr, record->value_len);
+            } else {
+                results_.emplace_back(std::nullopt);
+            }
+        }
+        col.abort(ctx);
     }
 
     void OnOK() override {
@@ -714,7 +736,7 @@ protected:
         Napi::Array js_results = Napi::Array::New(env, results_.size());
         for (size_t i = 0; i < results_.size(); ++i) {
             if (results_[i].has_value()) {
-                js_results[i] = Napi::Buffer<char>::Copy(env, results_[i]->value_ptr, results_[i]->value_len);
+                js_results[i] = Napi::Buffer<char>::Copy(env, results_[i]->data(), results_[i]->size());
             } else {
                 js_results[i] = env.Null();
             }
@@ -731,7 +753,7 @@ private:
     StaxDB db_handle_;
     StaxCollection col_;
     std::vector<std::string> keys_to_get_;
-    std::vector<std::optional<RecordData>> results_;
+    std::vector<std::optional<std::string>> results_;
 };
 
 void DatabaseWrap::MultiGetAsync(const Napi::CallbackInfo& info) {
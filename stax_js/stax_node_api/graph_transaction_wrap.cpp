@@ -66,7 +66,7 @@ Napi::Object GraphTransactionWrap::NewInstance(Napi::Env env, DatabaseWrap* db_w
     Napi::Object obj = constructor.New({});
     GraphTransactionWrap* gtxn_wrap = Unwrap(obj);
     gtxn_wrap->db_instance_ = db_wrap->db_instance_;
-    gtxn_wrap->txn_ = std::make_unique<GraphTransaction>(db_wrap->db_instance_, 0);
+    gtxn_wrap->txn_ = std::make_unique<GraphTransaction>(db_wrap->db_instance_, db_wrap->db_instance_->get_thread_slot());
     return obj;
 }
 
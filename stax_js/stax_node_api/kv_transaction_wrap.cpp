@@ -23,7 +23,7 @@ Napi::Object KVTransactionWrap::NewInstance(Napi::Env env, DatabaseWrap* db_wrap
     txn_wrap->col_idx_ = col_idx;
     
     Collection& col = txn_wrap->db_instance_->get_collection_by_idx(col_idx);
-    txn_wrap->ctx_ = col.begin_transaction_context(0, false); 
+    txn_wrap->ctx_ = col.begin_transaction_context(txn_wrap->db_instance_->get_thread_slot(), false);
     return obj;
 }
 